@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/atomic.hpp {{{
+ * \file stm32xx/atomic.hpp
+ * @brief Memory access policies with atomic read-modify-write.
+ *
+ * A plain read-modify-write (e.g. bits::ct::modify) loses the change of an
+ * ISR which modifies the same word between the read and the write. The
+ * policies defined here make the read-modify-write atomic and are picked
+ * per call site, without masking interrupts where it is not needed:
+ *
+ * - bits::exclusive_access retries the modification with exclusive
+ *   load/store (@c LDREX / @c STREX) until no other access intervened,
+ * - bits::critical_access does it with interrupts masked by PRIMASK, or
+ *   by BASEPRI up to a given priority,
+ * - bits::atomic_access chooses between the two by address: exclusives on
+ *   SRAM, where they are guaranteed to work, a critical section elsewhere
+ *   (peripheral registers). For addresses known at compile time the
+ *   choice is made at compile time.
+ *
+ * @code
+ * using namespace stm32xx::bits;
+ * using leds = ct::masked<GPIO_Pin_5, GPIO_Pin_5|GPIO_Pin_6>;
+ * ct::modify<leds>::in<atomic_access<> >(GPIOA->ODR);        // PRIMASK
+ * ct::modify<leds>::at<GPIOA_BASE + 0x0C, atomic_access<4> >(); // BASEPRI
+ * ct::modify<flags>::in<exclusive_access>(shared_flags);     // LDREX/STREX
+ * @endcode
+ *
+ * A single-bit modification at a bit-band address is a bit-band store,
+ * which is atomic by itself, so the policy is not used for it.
+ *
+ * On host (any non-ARM build) all the policies are compare-exchange loops,
+ * the same as @c std::atomic, so the code using them can be tested with
+ * threads. Words may then also be given as @c std::atomic<uint32_t>.
+ */ // }}}
+#ifndef STM32XX_ATOMIC_HPP_INCLUDED
+#define STM32XX_ATOMIC_HPP_INCLUDED
+
+#include <stm32xx/bits.hpp>
+#if defined(__arm__)
+# include <stm32xx/core_cmx.h>
+#else
+# include <atomic>
+#endif
+
+namespace stm32xx {
+namespace bits {
+
+/** // doc: bits::is_exclusive_address() {{{
+ * @brief Return @c true if exclusive load/store may be used at @c addr.
+ *
+ * That is the SRAM region of the Cortex-M3/M4 memory map (0x20000000 -
+ * 0x3FFFFFFF), which is normal memory. For the peripheral region (device
+ * memory) the behaviour of exclusives is implementation defined.
+ */ // }}}
+constexpr bool
+is_exclusive_address(uint64_t addr)
+{
+  return addr >= 0x20000000ull && addr < 0x40000000ull;
+}
+
+#if defined(__arm__)
+/** // doc: bits::exclusive_modify() {{{
+ * @brief Replace bits @c mask of word @c x with @c bits, using exclusive
+ *        load/store, and return the old value of @c x.
+ *
+ * The store fails, and the modification is retried, if an exception was
+ * taken (e.g. an ISR modified @c x) since the load.
+ */ // }}}
+inline uint32_t
+exclusive_modify(volatile uint32_t& x, uint32_t mask, uint32_t bits)
+{
+  uint32_t old;
+  do
+    {
+      old = __LDREXW(&x);
+    }
+  while(__STREXW((old & ~mask) | bits, &x) != 0ul);
+  return old;
+}
+
+/** // doc: bits::critical_modify() {{{
+ * @brief Replace bits @c mask of word @c x with @c bits with interrupts
+ *        masked, and return the old value of @c x.
+ *
+ * With @c _priority equal to 0 all the interrupts are masked (PRIMASK).
+ * Otherwise only the interrupts with priority @c _priority or lower
+ * (numerically greater or equal) are masked (BASEPRI), so that more urgent
+ * ones are not delayed. The previous mask is restored afterwards.
+ */ // }}}
+template <uint8_t _priority>
+inline uint32_t
+critical_modify(volatile uint32_t& x, uint32_t mask, uint32_t bits)
+{
+  constexpr uint32_t level = (uint32_t)_priority << (8u - __NVIC_PRIO_BITS);
+  static_assert(_priority < (1u << __NVIC_PRIO_BITS), "invalid priority");
+  uint32_t old;
+  if(_priority == 0u)
+    {
+      const uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      old = x;
+      x = (old & ~mask) | bits;
+      __set_PRIMASK(primask);
+    }
+  else
+    {
+      const uint32_t basepri = __get_BASEPRI();
+      if(basepri == 0ul || basepri > level)
+        __set_BASEPRI(level);
+      old = x;
+      x = (old & ~mask) | bits;
+      __set_BASEPRI(basepri);
+    }
+  return old;
+}
+#else
+/* Host stand-in of exclusive_modify() and critical_modify() */
+inline uint32_t
+host_modify(std::atomic<uint32_t>& x, uint32_t mask, uint32_t bits)
+{
+  uint32_t old = x.load(std::memory_order_relaxed);
+  while(!x.compare_exchange_weak(old, (old & ~mask) | bits))
+    {
+    }
+  return old;
+}
+
+/* Host stand-in for plain words, with the builtins std::atomic uses */
+inline uint32_t
+host_modify(volatile uint32_t& x, uint32_t mask, uint32_t bits)
+{
+  uint32_t* p = const_cast<uint32_t*>(&x);
+  uint32_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  while(!__atomic_compare_exchange_n(p, &old, (old & ~mask) | bits, true,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+    }
+  return old;
+}
+
+inline uint32_t
+exclusive_modify(std::atomic<uint32_t>& x, uint32_t mask, uint32_t bits)
+{
+  return host_modify(x, mask, bits);
+}
+
+inline uint32_t
+exclusive_modify(volatile uint32_t& x, uint32_t mask, uint32_t bits)
+{
+  return host_modify(x, mask, bits);
+}
+
+template <uint8_t _priority, typename T>
+inline uint32_t
+critical_modify(T& x, uint32_t mask, uint32_t bits)
+{
+  return host_modify(x, mask, bits);
+}
+#endif
+
+/** // doc: bits::exclusive_access {{{
+ * @brief Memory access policy with read-modify-write by exclusive
+ *        load/store (LDREX/STREX), see stm32xx/atomic.hpp.
+ *
+ * Use for words in SRAM only.
+ */ // }}}
+struct exclusive_access
+  : volatile_access
+{
+  /** // doc: modify() {{{
+   * @brief Atomically replace bits @c mask of word at @c addr with
+   *        @c bits and return the old value.
+   */ // }}}
+  static uint32_t modify(uint32_t addr, uint32_t mask, uint32_t bits)
+  {
+    return exclusive_modify(*reinterpret_cast<volatile uint32_t*>(addr),
+                            mask, bits);
+  }
+  /** // doc: modify_in() {{{
+   * @brief Atomically replace bits @c mask of word @c x with @c bits and
+   *        return the old value.
+   */ // }}}
+  template <typename T>
+  static uint32_t modify_in(T& x, uint32_t mask, uint32_t bits)
+  {
+    return exclusive_modify(x, mask, bits);
+  }
+};
+
+/** // doc: bits::critical_access {{{
+ * @brief Memory access policy with read-modify-write in a critical
+ *        section, see stm32xx/atomic.hpp.
+ *
+ * With @c _priority equal to 0 all the interrupts are masked during the
+ * read-modify-write (PRIMASK), otherwise only those with priority
+ * @c _priority or lower (BASEPRI).
+ */ // }}}
+template <uint8_t _priority = 0u>
+struct critical_access
+  : volatile_access
+{
+  /** // doc: modify() {{{
+   * @brief Atomically replace bits @c mask of word at @c addr with
+   *        @c bits and return the old value.
+   */ // }}}
+  static uint32_t modify(uint32_t addr, uint32_t mask, uint32_t bits)
+  {
+    return critical_modify<_priority>(*reinterpret_cast<volatile uint32_t*>(addr),
+                                      mask, bits);
+  }
+  /** // doc: modify_in() {{{
+   * @brief Atomically replace bits @c mask of word @c x with @c bits and
+   *        return the old value.
+   */ // }}}
+  template <typename T>
+  static uint32_t modify_in(T& x, uint32_t mask, uint32_t bits)
+  {
+    return critical_modify<_priority>(x, mask, bits);
+  }
+};
+
+/** // doc: bits::atomic_access {{{
+ * @brief Memory access policy using exclusive_access on SRAM and
+ *        critical_access<_priority> elsewhere, see stm32xx/atomic.hpp.
+ */ // }}}
+template <uint8_t _priority = 0u>
+struct atomic_access
+  : volatile_access
+{
+  /** // doc: modify() {{{
+   * @brief Atomically replace bits @c mask of word at @c addr with
+   *        @c bits and return the old value.
+   */ // }}}
+  static uint32_t modify(uint32_t addr, uint32_t mask, uint32_t bits)
+  {
+    return is_exclusive_address(addr)
+         ? exclusive_access::modify(addr, mask, bits)
+         : critical_access<_priority>::modify(addr, mask, bits);
+  }
+  /** // doc: modify_in() {{{
+   * @brief Atomically replace bits @c mask of word @c x with @c bits and
+   *        return the old value.
+   */ // }}}
+  template <typename T>
+  static uint32_t modify_in(T& x, uint32_t mask, uint32_t bits)
+  {
+    return is_exclusive_address(address_of(x))
+         ? exclusive_access::modify_in(x, mask, bits)
+         : critical_access<_priority>::modify_in(x, mask, bits);
+  }
+};
+
+} /* namespace bits */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_ATOMIC_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
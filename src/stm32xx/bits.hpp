@@ -27,13 +27,327 @@
 #ifndef STM32XX_BITS_HPP_INCLUDED
 #define STM32XX_BITS_HPP_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#if !defined(STM32XX_ASSERT)
+# include <cassert>
+#endif
 
 namespace stm32xx {
 /** // doc: namespace bits {{{
  * @brief Some basic operations on bits. 
  */ // }}}
 namespace bits {
+
+/* One shift-and-mask step of spread2() and spread4(). */
+constexpr uint32_t
+spread_step(uint32_t x, unsigned shift, uint32_t mask)
+{
+  return (x | (x << shift)) & mask;
+}
+
+/** // doc: bits::spread4() {{{
+ * @brief Spread 8 least significant bits of @c x over 8 nibbles.
+ *
+ * Bit @c n of @c x is moved to bit @c 4n of the result, all other bits of
+ * the result are zero. Multiplying the result by a 4-bit value @c v puts
+ * @c v into every selected nibble, which is how per-pin 4-bit register
+ * fields are computed from a pin mask (see gpio::detail). The computation
+ * is branch-free (three shift-and-mask steps) and @c constexpr.
+ *
+ * <b>Usage example</b>:
+ *
+ * @code
+ * spread4(0x83);          // 0x10000011
+ * spread4(0x83) * 0x0B;   // 0xB00000BB
+ * @endcode
+ */ // }}}
+constexpr uint32_t
+spread4(uint32_t x)
+{
+  return spread_step(spread_step(spread_step(x & 0xFFul,
+                                             12, 0x000F000Ful),
+                                 6, 0x03030303ul),
+                     3, 0x11111111ul);
+}
+
+/** // doc: bits::spread2() {{{
+ * @brief Spread 16 least significant bits of @c x over 16 2-bit fields.
+ *
+ * Bit @c n of @c x is moved to bit @c 2n of the result, all other bits of
+ * the result are zero. This is the 2-bit counterpart of spread4(), suitable
+ * for registers with 2-bit per-pin fields (such as STM32F4 GPIOx_MODER).
+ * The computation is branch-free (four shift-and-mask steps) and
+ * @c constexpr.
+ *
+ * <b>Usage example</b>:
+ *
+ * @code
+ * spread2(0x8003);        // 0x40000005
+ * spread2(0x8003) * 0x03; // 0xC000000F
+ * @endcode
+ */ // }}}
+constexpr uint32_t
+spread2(uint32_t x)
+{
+  return spread_step(spread_step(spread_step(spread_step(x & 0xFFFFul,
+                                                         8, 0x00FF00FFul),
+                                             4, 0x0F0F0F0Ful),
+                                 2, 0x33333333ul),
+                     1, 0x55555555ul);
+}
+
+/** // doc: bits::volatile_access {{{
+ * @brief Default memory access policy: plain volatile loads and stores.
+ *
+ * Operations that take a memory address as a template argument (e.g.
+ * @ref ct::modify "ct::modify<>::at<>()") access memory through a policy
+ * with this interface. Host-side tests substitute their own policy to
+ * simulate the MCU address space.
+ */ // }}}
+struct volatile_access
+{
+  /** // doc: read() {{{
+   * @brief Load 32-bit word from address @c addr.
+   */ // }}}
+  static uint32_t read(uint32_t addr)
+  {
+    return *reinterpret_cast<volatile uint32_t*>(addr);
+  }
+  /** // doc: write() {{{
+   * @brief Store 32-bit @c value at address @c addr.
+   */ // }}}
+  static void write(uint32_t addr, uint32_t value)
+  {
+    *reinterpret_cast<volatile uint32_t*>(addr) = value;
+  }
+};
+
+/** // doc: bits::null_access_hook {{{
+ * @brief Default access hook, does nothing.
+ *
+ * Register accesses performed by the library (bits::ct, bits::rt and the
+ * GPIO helpers) are reported to bits::access_hook, which is this type
+ * unless @c STM32XX_ACCESS_HOOK is defined. All the functions are empty
+ * inlines, so with the default hook the generated code is the same as if
+ * there were no hook at all.
+ */ // }}}
+struct null_access_hook
+{
+  /** // doc: load() {{{
+   * @brief Called after @c value was loaded from @c addr.
+   */ // }}}
+  static void load(uintptr_t, uint32_t)
+  {
+  }
+  /** // doc: store() {{{
+   * @brief Called after @c value was stored at @c addr (no prior read).
+   */ // }}}
+  static void store(uintptr_t, uint32_t)
+  {
+  }
+  /** // doc: modify() {{{
+   * @brief Called after read-modify-write of @c addr from @c old_value to
+   *        @c new_value.
+   */ // }}}
+  static void modify(uintptr_t, uint32_t, uint32_t)
+  {
+  }
+};
+
+/** // doc: bits::access_hook {{{
+ * @brief Access hook used by the library.
+ *
+ * Define @c STM32XX_ACCESS_HOOK to a type with the interface of
+ * bits::null_access_hook to observe register accesses, e.g. to record them
+ * with stm32xx::trace::hook. The macro must be defined (the same way) in
+ * every translation unit, before any stm32xx header is included.
+ */ // }}}
+#if defined(STM32XX_ACCESS_HOOK)
+typedef STM32XX_ACCESS_HOOK access_hook;
+#else
+typedef null_access_hook access_hook;
+#endif
+
+/** // doc: STM32XX_ASSERT {{{
+ * @brief Run-time assertion used by the library in debug builds.
+ *
+ * Defaults to @c assert(), so with @c NDEBUG defined the asserted
+ * expression is not evaluated at all (no register is read). Define
+ * @c STM32XX_ASSERT before any stm32xx header to report failures in
+ * another way, e.g. with a breakpoint. As for @c STM32XX_ACCESS_HOOK, it
+ * must be defined the same way in every translation unit.
+ */ // }}}
+#if !defined(STM32XX_ASSERT)
+# define STM32XX_ASSERT(expr) assert(expr)
+#endif
+
+/** // doc: bits::address_of() {{{
+ * @brief Return address of register @c x as an integer, for access_hook.
+ */ // }}}
+template <typename T>
+inline uintptr_t
+address_of(T const& x)
+{
+  return reinterpret_cast<uintptr_t>(&x);
+}
+
+/** // doc: bits::load() {{{
+ * @brief Load register @c x, reporting the access to bits::access_hook.
+ */ // }}}
+template <typename T>
+inline uint32_t
+load(T& x)
+{
+  const uint32_t value = x;
+  access_hook::load(address_of(x), value);
+  return value;
+}
+
+/** // doc: bits::store() {{{
+ * @brief Store @c value to register @c x, reporting the access to
+ *        bits::access_hook.
+ */ // }}}
+template <typename T>
+inline void
+store(T& x, uint32_t value)
+{
+  x = value;
+  access_hook::store(address_of(x), value);
+}
+
+/** // doc: bits::is_single_bit() {{{
+ * @brief Return @c true if exactly one bit is set in @c mask.
+ */ // }}}
+constexpr bool
+is_single_bit(uint32_t mask)
+{
+  return (mask != 0ul) && ((mask & (mask - 1ul)) == 0ul);
+}
+
+/** // doc: bits::bit_index() {{{
+ * @brief Return index of the least significant bit set in @c mask.
+ *
+ * @note Returns 32 for @c mask equal to 0.
+ */ // }}}
+constexpr unsigned
+bit_index(uint32_t mask)
+{
+  return (mask == 0ul) ? 32u
+       : ((mask & 1ul) ? 0u : 1u + bit_index(mask >> 1));
+}
+
+/** // doc: bits::bitband_base() {{{
+ * @brief Return base of the bit-band region containing @c addr, or 0.
+ *
+ * Cortex-M3/M4 provide two bit-band regions, 1MB of SRAM starting at
+ * @c 0x20000000 and 1MB of peripherals starting at @c 0x40000000.
+ */ // }}}
+constexpr uint32_t
+bitband_base(uint32_t addr)
+{
+  return ((addr >= 0x20000000ul) && (addr < 0x20100000ul)) ? 0x20000000ul
+       : ((addr >= 0x40000000ul) && (addr < 0x40100000ul)) ? 0x40000000ul
+       : 0ul;
+}
+
+/** // doc: bits::is_bitband_address() {{{
+ * @brief Return @c true if @c addr lies in a bit-band region.
+ */ // }}}
+constexpr bool
+is_bitband_address(uint32_t addr)
+{
+  return bitband_base(addr) != 0ul;
+}
+
+/** // doc: bits::bitband_alias() {{{
+ * @brief Return address of the bit-band alias word for bit @c bit of the
+ *        word at @c addr.
+ *
+ * @c addr must lie in a bit-band region (see is_bitband_address()).
+ */ // }}}
+constexpr uint32_t
+bitband_alias(uint32_t addr, unsigned bit)
+{
+  return bitband_base(addr) + 0x02000000ul
+       + ((addr - bitband_base(addr)) << 5) + (bit << 2);
+}
+
+/** // doc: bits::shadowed {{{
+ * @brief Register with a shadow copy kept in SRAM.
+ *
+ * Reads are served from the shadow copy, writes update the copy and are
+ * written through to the register with a plain store. This saves the
+ * (slow) peripheral bus read of each read-modify-write. It's suitable only
+ * for registers which are modified by firmware alone (e.g. GPIOx_CRL,
+ * GPIOx_CRH, RCC enable registers). Use sync() to reload the copy from
+ * hardware.
+ *
+ * The wrapper is accepted by @ref ct::modify "ct::modify<>::in()" and
+ * rt::modify() as any other register.
+ *
+ * <b>Example</b>:
+ *
+ * @code
+ * shadowed<> crl(GPIOB->CRL, 0x44444444ul); // assume reset value, no read
+ * modify<gpio::ct::crl_masked<GPIO_Pin_0, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> >::in(crl);
+ * modify<gpio::ct::crl_masked<GPIO_Pin_1, GPIO_Mode_IPU> >::in(crl);
+ * @endcode
+ */ // }}}
+template <typename _Register = volatile uint32_t>
+  class shadowed
+  {
+  public:
+    /** // doc: shadowed(reg) {{{
+     * @brief Wrap @c reg, initializing the shadow copy from the register.
+     */ // }}}
+    explicit shadowed(_Register& reg)
+      : _reg(reg), _copy(reg)
+    {
+    }
+    /** // doc: shadowed(reg, value) {{{
+     * @brief Wrap @c reg, assuming it holds @c value (no read).
+     */ // }}}
+    shadowed(_Register& reg, uint32_t value)
+      : _reg(reg), _copy(value)
+    {
+    }
+    /** // doc: sync() {{{
+     * @brief Reload the shadow copy from the register.
+     */ // }}}
+    void sync()
+    {
+      _copy = _reg;
+    }
+    /** // doc: value() {{{
+     * @brief Return the shadow copy.
+     */ // }}}
+    uint32_t value() const
+    {
+      return _copy;
+    }
+    /** // doc: operator uint32_t() {{{
+     * @brief Return the shadow copy.
+     */ // }}}
+    operator uint32_t() const
+    {
+      return _copy;
+    }
+    /** // doc: operator=() {{{
+     * @brief Update the shadow copy and store @c value to the register.
+     */ // }}}
+    shadowed& operator=(uint32_t value)
+    {
+      _copy = value;
+      _reg = value;
+      return *this;
+    }
+  private:
+    _Register& _reg;
+    uint32_t _copy;
+  };
+
 /** // doc: namesapce ct {{{
  * @brief Compile-time version of bit operations.
  */ // }}}
@@ -102,9 +416,94 @@ template <uint32_t _bits, uint32_t _mask>
     constexpr static uint32_t mask = _mask;
   };
 
+/* Helpers of mix. They fold over range [lo, hi) of array a. The range is
+ * split in halves, so the constexpr recursion depth is O(log(hi - lo)). */
+
+/* Bitwise OR of a[lo..hi) */
+constexpr uint32_t
+mix_or(const uint32_t* a, std::size_t lo, std::size_t hi)
+{
+  return (hi - lo == 0u) ? 0ul
+       : (hi - lo == 1u) ? a[lo]
+       : mix_or(a, lo, lo + (hi - lo) / 2u) | mix_or(a, lo + (hi - lo) / 2u, hi);
+}
+
+/* Arithmetic sum of a[lo..hi), equal to mix_or() iff a[] do not overlap */
+constexpr uint64_t
+mix_sum(const uint32_t* a, std::size_t lo, std::size_t hi)
+{
+  return (hi - lo == 0u) ? 0ull
+       : (hi - lo == 1u) ? uint64_t(a[lo])
+       : mix_sum(a, lo, lo + (hi - lo) / 2u) + mix_sum(a, lo + (hi - lo) / 2u, hi);
+}
+
+constexpr std::size_t
+mix_first_conflict(const uint32_t* a, std::size_t lo, std::size_t hi,
+                   uint32_t acc);
+
+constexpr std::size_t
+mix_first_conflict_r(const uint32_t* a, std::size_t lo, std::size_t mid,
+                     std::size_t hi, uint32_t acc, std::size_t left)
+{
+  return (left != mid) ? left
+       : mix_first_conflict(a, mid, hi, acc | mix_or(a, lo, mid));
+}
+
+/* Index of the first a[i] in [lo, hi) overlapping with acc or with any
+ * a[lo..i), or hi if there is no such element */
+constexpr std::size_t
+mix_first_conflict(const uint32_t* a, std::size_t lo, std::size_t hi,
+                   uint32_t acc)
+{
+  return (hi - lo == 0u) ? hi
+       : (hi - lo == 1u) ? (((a[lo] & acc) != 0ul) ? lo : hi)
+       : mix_first_conflict_r(a, lo, lo + (hi - lo) / 2u, hi, acc,
+                              mix_first_conflict(a, lo, lo + (hi - lo) / 2u,
+                                                 acc));
+}
+
+constexpr std::size_t
+mix_first_match(const uint32_t* a, std::size_t lo, std::size_t hi,
+                uint32_t mask);
+
+constexpr std::size_t
+mix_first_match_r(const uint32_t* a, std::size_t mid, std::size_t hi,
+                  uint32_t mask, std::size_t left)
+{
+  return (left != mid) ? left : mix_first_match(a, mid, hi, mask);
+}
+
+/* Index of the first a[i] in [lo, hi) overlapping with mask, or hi */
+constexpr std::size_t
+mix_first_match(const uint32_t* a, std::size_t lo, std::size_t hi,
+                uint32_t mask)
+{
+  return (hi - lo == 0u) ? hi
+       : (hi - lo == 1u) ? (((a[lo] & mask) != 0ul) ? lo : hi)
+       : mix_first_match_r(a, lo + (hi - lo) / 2u, hi, mask,
+                           mix_first_match(a, lo, lo + (hi - lo) / 2u, mask));
+}
+
+/* Fails to compile if masks of mix elements _first and _second overlap.
+ * The indices and masks of the offending elements show up in the
+ * compiler's "required from" notes. */
+template <std::size_t _first, std::size_t _second,
+          uint32_t _first_mask, uint32_t _second_mask, bool _ok>
+  struct mix_overlap_check
+  {
+    static_assert(_ok, "masks overlap (see the element indices and masks in "
+                       "mix_overlap_check<first, second, first_mask, "
+                       "second_mask, ...>)");
+    constexpr static bool value = _ok;
+  };
+
 /** // doc: bits::mix {{{
  * @brief Mix bits from several sources.
  *
+ * The elements are folded with @c constexpr functions over arrays of their
+ * bits and masks, so the instantiation depth doesn't grow with the number
+ * of elements and lists of hundreds of elements compile quickly.
+ *
  * <b>Usage examples</b>:
  *
  * The following code returns @c 0x21:
@@ -117,34 +516,46 @@ template <uint32_t _bits, uint32_t _mask>
  * mix< masked<0x0001,0x000F>, masked<0x0020,0x00F0> >::mask;
  * @endcode
  *
- * The following code generates compile-time error (masks overlap):
+ * The following code generates compile-time error (masks overlap). The
+ * error names the first pair of overlapping elements (here 0 and 1, with
+ * their masks) in the instantiation of @c mix_overlap_check:
  *
  * @code
  * mix< masked<0x01,0x1F>, masked<0x10,0xF0> >::value;
  * @endcode
  */ // }}}
-template <typename ... _list> struct mix;
-template <typename _m, typename ... _tail>
-  struct mix<_m,_tail...>
+template <typename ... _list>
+  struct mix
   {
-    constexpr static uint32_t _m_mask = get_mask<_m>::value;
-    constexpr static uint32_t _t_mask = get_mask<mix<_tail...> >::value;
-
-    static_assert((_m_mask^_t_mask)==(_m_mask|_t_mask), "masks overlap");
-
-    constexpr static uint32_t _t_bits = get_bits<mix<_tail...> >::value;
-    constexpr static uint32_t _m_bits = get_bits<_m>::value;
+    constexpr static std::size_t _size = sizeof...(_list);
+    constexpr static uint32_t _masks[_size + 1u] = {
+      get_mask<_list>::value..., 0ul
+    };
+    constexpr static uint32_t _bits[_size + 1u] = {
+      get_bits<_list>::value..., 0ul
+    };
 
     /** // doc: mask {{{
      * The mask of the resultant masked bits.
      * @hideinitializer
      */ // }}}
-    constexpr static uint32_t mask = _t_mask | _m_mask;
+    constexpr static uint32_t mask = mix_or(_masks, 0u, _size);
+
+    constexpr static bool _overlap = (mix_sum(_masks, 0u, _size) != mask);
+    constexpr static std::size_t _second =
+      _overlap ? mix_first_conflict(_masks, 0u, _size, 0ul) : 0u;
+    constexpr static std::size_t _first =
+      _overlap ? mix_first_match(_masks, 0u, _second, _masks[_second]) : 0u;
+
+    static_assert(mix_overlap_check<_first, _second, _masks[_first],
+                                    _masks[_second], !_overlap>::value,
+                  "masks overlap");
+
     /** // doc: bits {{{
      * The bits of the resultant masked bits.
      * @hideinitializer
      */ // }}}
-    constexpr static uint32_t bits = _t_bits | _m_bits;
+    constexpr static uint32_t bits = mix_or(_bits, 0u, _size);
     /** // doc: value {{{
      * Return value (same as bits).
      * @hideinitializer
@@ -152,13 +563,103 @@ template <typename _m, typename ... _tail>
     constexpr static uint32_t value = bits;
   };
 
-/* Specialization of `mix` class to stop compile-time recursion. */
-template <> 
-  struct mix<> 
-  { 
-    constexpr static uint32_t bits = 0;
-    constexpr static uint32_t mask = 0; 
-    constexpr static uint32_t value = 0;
+template <typename ... _list>
+  constexpr uint32_t mix<_list...>::_masks[];
+template <typename ... _list>
+  constexpr uint32_t mix<_list...>::_bits[];
+
+/** // doc: bits::delta {{{
+ * @brief Bits which change when going from @c _from to @c _to.
+ *
+ * Both arguments are masked bits, @c _from describes what is known about
+ * a word and @c _to what it should become. The result selects the bits of
+ * @c _to which are not known to be already there: the bits outside of the
+ * mask of @c _from and the bits which differ. Applied (with modify) to a
+ * word matching @c _from, it gives the same word as @c _to, with no
+ * access at all when nothing changes (the mask is 0).
+ *
+ * <b>Example</b>:
+ *
+ * The following code returns @c 0xF100 (bit 8 differs and bits 12..15
+ * are not known):
+ * @code
+ * delta< masked<0x0211, 0x0FFF>, masked<0x0310, 0xFFF0> >::mask;
+ * @endcode
+ */ // }}}
+template <typename _from, typename _to>
+  struct delta
+    : masked< get_bits<_to>::value
+              & ~(get_mask<_from>::value
+                  & ~(get_bits<_from>::value ^ get_bits<_to>::value)),
+              get_mask<_to>::value
+              & ~(get_mask<_from>::value
+                  & ~(get_bits<_from>::value ^ get_bits<_to>::value)) >
+  {
+  };
+
+/* Read-modify-write of word at addr through _Access, returning the old
+ * value. Policies with modify() (see stm32xx/atomic.hpp) do it atomically,
+ * others with a plain load and store. */
+template <typename _Access>
+inline auto
+access_modify(uint32_t addr, uint32_t mask, uint32_t bits, int)
+  -> decltype(_Access::modify(addr, mask, bits))
+{
+  return _Access::modify(addr, mask, bits);
+}
+
+template <typename _Access>
+inline uint32_t
+access_modify(uint32_t addr, uint32_t mask, uint32_t bits, long)
+{
+  const uint32_t old = _Access::read(addr);
+  _Access::write(addr, (old & ~mask) | bits);
+  return old;
+}
+
+/* Same as access_modify() for register x given by reference, with
+ * _Access::modify_in() */
+template <typename _Access, typename T>
+inline auto
+access_modify_in(T& x, uint32_t mask, uint32_t bits, int)
+  -> decltype(_Access::modify_in(x, mask, bits))
+{
+  return _Access::modify_in(x, mask, bits);
+}
+
+template <typename _Access, typename T>
+inline uint32_t
+access_modify_in(T& x, uint32_t mask, uint32_t bits, long)
+{
+  const uint32_t old = x;
+  x = (old & ~mask) | bits;
+  return old;
+}
+
+/* Implementation of modify<>::at<>(): read-modify-write */
+template <uint32_t _addr, uint32_t _bits, uint32_t _mask,
+          bool _bitband = is_single_bit(_mask) && is_bitband_address(_addr)>
+  struct modify_at_impl
+  {
+    template <typename _Access>
+    static void apply()
+    {
+      const uint32_t old = access_modify<_Access>(_addr, _mask, _bits, 0);
+      access_hook::modify(_addr, old, (old & ~_mask) | _bits);
+    }
+  };
+
+/* Implementation of modify<>::at<>(): single store to bit-band alias */
+template <uint32_t _addr, uint32_t _bits, uint32_t _mask>
+  struct modify_at_impl<_addr, _bits, _mask, true>
+  {
+    template <typename _Access>
+    static void apply()
+    {
+      constexpr uint32_t alias = bitband_alias(_addr, bit_index(_mask));
+      _Access::write(alias, (_bits != 0ul) ? 1ul : 0ul);
+      access_hook::store(alias, (_bits != 0ul) ? 1ul : 0ul);
+    }
   };
 
 /* Implementation of modify<> operation */
@@ -166,10 +667,33 @@ template <uint32_t _bits, uint32_t _mask>
   struct modify_impl
   {
     static_assert((_bits&_mask)==_bits, "bits do not fit to the mask");
-    template<typename T>
+    template<typename _Access = volatile_access, typename T>
     static void in(T& x)
     {
-      x = (x & ~_mask) | _bits;
+      const uint32_t old = access_modify_in<_Access>(x, _mask, _bits, 0);
+      access_hook::modify(address_of(x), old, (old & ~_mask) | _bits);
+    }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static void at()
+    {
+      modify_at_impl<_addr, _bits, _mask>::template apply<_Access>();
+    }
+  };
+
+template <uint32_t _bits>
+  struct modify_impl<_bits, 0xFFFFFFFFul>
+  {
+    template<typename _Access = volatile_access, typename T>
+    static void in(T& x)
+    {
+      /* whole word is overwritten, no need to read it */
+      store(x, _bits);
+    }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static void at()
+    {
+      _Access::write(_addr, _bits);
+      access_hook::store(_addr, _bits);
     }
   };
 
@@ -177,11 +701,16 @@ template <uint32_t _bits>
   struct modify_impl<_bits, 0ul>
   {
     static_assert(_bits==0ul, "bits do not fit to the mask");
-    template<typename T>
+    template<typename _Access = volatile_access, typename T>
     static void in(T&)
     {
       /* no bits to modify (mask is 0) */
     }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static void at()
+    {
+      /* no bits to modify (mask is 0) */
+    }
   };
 
 /** // doc: bits::modify {{{
@@ -195,6 +724,32 @@ template <uint32_t _bits>
  * using bits = masked<0x12340000, 0xFFFF0000ul>;
  * modify<bits>::in(var);
  * @endcode
+ *
+ * The register may also be given by its address, with
+ * <tt>modify<_masked>::at<_addr>()</tt>. In that case, when the mask is a
+ * single bit and @c _addr lies in a Cortex-M3/M4 bit-band region, the
+ * modification is a single store to the bit-band alias word (no read,
+ * atomic). Otherwise it's an ordinary read-modify-write. The choice is made
+ * at compile time. Memory is accessed through the @c _Access policy (see
+ * bits::volatile_access).
+ *
+ * If the mask covers the whole word, the word is just stored (no read).
+ *
+ * @code
+ * using enable = masked<RCC_APB2ENR_IOPBEN, RCC_APB2ENR_IOPBEN>;
+ * modify<enable>::at<RCC_BASE + 0x18>();
+ * @endcode
+ *
+ * A read-modify-write is not atomic: an ISR modifying other bits of the
+ * same word between the read and the write would have its change lost.
+ * With an atomic policy from stm32xx/atomic.hpp, given to at<>() or to
+ * <tt>in<_Access>()</tt>, the read-modify-write is done with exclusive
+ * load/store or in a critical section instead.
+ *
+ * @code
+ * using led = masked<GPIO_Pin_5, GPIO_Pin_5>;
+ * modify<led>::in<atomic_access<> >(GPIOA->ODR);
+ * @endcode
  */ // }}}
 template <typename _masked>
   struct modify
@@ -202,7 +757,494 @@ template <typename _masked>
   {
   };
 
+/* Implementation of from_reset<> */
+template <uint32_t _bits, uint32_t _mask, uint32_t _reset>
+  struct from_reset_impl
+  {
+    static_assert((_bits&_mask)==_bits, "bits do not fit to the mask");
+    constexpr static uint32_t value = (_reset & ~_mask) | _bits;
+    template<typename T>
+    static void in(T& x)
+    {
+      STM32XX_ASSERT(load(x) == _reset);
+      store(x, value);
+    }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static void at()
+    {
+      STM32XX_ASSERT((check_at<_addr, _Access>()));
+      _Access::write(_addr, value);
+      access_hook::store(_addr, value);
+    }
+    template <uint32_t _addr, typename _Access>
+    static bool check_at()
+    {
+      const uint32_t old = _Access::read(_addr);
+      access_hook::load(_addr, old);
+      return old == _reset;
+    }
+  };
+
+template <uint32_t _bits, uint32_t _reset>
+  struct from_reset_impl<_bits, 0ul, _reset>
+  {
+    static_assert(_bits==0ul, "bits do not fit to the mask");
+    constexpr static uint32_t value = _reset;
+    template<typename T>
+    static void in(T&)
+    {
+      /* no bits to modify (mask is 0) */
+    }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static void at()
+    {
+      /* no bits to modify (mask is 0) */
+    }
+  };
+
+/** // doc: bits::from_reset {{{
+ * @brief Modify selected bits of a register which holds its reset value.
+ *
+ * Same as modify, but the register is assumed to hold @c _reset, its
+ * documented reset value. The whole word is then known at compile time
+ * (@c value) and is just stored, without reading the register first. This
+ * halves the bus accesses of early initialization code.
+ *
+ * In debug builds (@c NDEBUG not defined) the register is read before the
+ * store and it is asserted (with STM32XX_ASSERT) that it still holds
+ * @c _reset.
+ *
+ * As with modify, nothing is accessed if the mask is 0.
+ *
+ * <b>Example</b>:
+ *
+ * @code
+ * using m = gpio::ct::crl_masked<GPIO_Pin_0, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+ * from_reset<m, 0x44444444ul>::in(GPIOB->CRL);  // GPIOB->CRL = 0x44444442
+ * @endcode
+ */ // }}}
+template <typename _masked, uint32_t _reset>
+  struct from_reset
+    : from_reset_impl<get_bits<_masked>::value, get_mask<_masked>::value, _reset>
+  {
+  };
+
+/** // doc: bits::test_bit {{{
+ * @brief Test single bit in a register or memory location.
+ *
+ * <b>Example</b>:
+ *
+ * @code
+ * bool a = test_bit<3>::in(var);
+ * bool b = test_bit<3>::at<SRAM_BASE + 0x100>();
+ * @endcode
+ *
+ * When @c _addr lies in a bit-band region, <tt>at<_addr>()</tt> loads the
+ * bit-band alias word of the bit, otherwise it loads the whole word and
+ * extracts the bit.
+ */ // }}}
+template <unsigned _bit>
+  struct test_bit
+  {
+    static_assert(_bit < 32u, "bit index out of range");
+    template<typename T>
+    static bool in(T const& x)
+    {
+      return ((load(x) >> _bit) & 1ul) != 0ul;
+    }
+    template <uint32_t _addr, typename _Access = volatile_access>
+    static bool at()
+    {
+      constexpr uint32_t addr = is_bitband_address(_addr)
+                              ? bitband_alias(_addr, _bit) : _addr;
+      const uint32_t value = _Access::read(addr);
+      access_hook::load(addr, value);
+      return is_bitband_address(_addr)
+           ? (value != 0ul)
+           : (((value >> _bit) & 1ul) != 0ul);
+    }
+  };
+
+/** // doc: bits::op {{{
+ * @brief Modification of a word at address @c _addr, see transaction.
+ */ // }}}
+template <uint32_t _addr, typename _masked>
+  struct op
+  {
+    constexpr static uint32_t addr = _addr;
+    typedef _masked masked_type;
+  };
+
+/* List of ops, used internally by transaction */
+template <typename ... _ops> struct op_list {};
+
+/* Prepend _op to op_list */
+template <typename _op, typename _list> struct op_list_push;
+template <typename _op, typename ... _ops>
+  struct op_list_push<_op, op_list<_ops...> >
+  {
+    typedef op_list<_op, _ops...> type;
+  };
+
+/* Split _list into ops targeting _addr (mixed together) and the others */
+template <uint32_t _addr, typename _list> struct op_list_split;
+template <uint32_t _addr>
+  struct op_list_split<_addr, op_list<> >
+  {
+    typedef mix<> mixed;
+    typedef op_list<> rest;
+  };
+template <uint32_t _addr, typename _op, typename ... _ops>
+  struct op_list_split<_addr, op_list<_op, _ops...> >
+  {
+    typedef op_list_split<_addr, op_list<_ops...> > _tail;
+    typedef typename _tail::mixed _t_mixed;
+    typedef typename _op::masked_type _m;
+    constexpr static bool _match = (_op::addr == _addr);
+
+    static_assert(!_match || ((get_mask<_m>::value & _t_mixed::mask) == 0ul),
+                  "masks overlap");
+
+    typedef masked< (_match ? get_bits<_m>::value : 0ul) | _t_mixed::bits,
+                    (_match ? get_mask<_m>::value : 0ul) | _t_mixed::mask >
+            mixed;
+    typedef typename std::conditional<
+        _match, typename _tail::rest,
+        typename op_list_push<_op, typename _tail::rest>::type
+      >::type rest;
+  };
+
+/* Implementation of transaction */
+template <typename _list> struct transaction_impl;
+template <>
+  struct transaction_impl<op_list<> >
+  {
+    constexpr static unsigned size = 0;
+    template <typename _Access>
+    static void apply()
+    {
+    }
+  };
+template <typename _op, typename ... _ops>
+  struct transaction_impl<op_list<_op, _ops...> >
+  {
+    typedef op_list_split<_op::addr, op_list<_op, _ops...> > _split;
+    typedef transaction_impl<typename _split::rest> _next;
+    constexpr static unsigned size = 1 + _next::size;
+    template <typename _Access>
+    static void apply()
+    {
+      modify<typename _split::mixed>::template at<_op::addr, _Access>();
+      _next::template apply<_Access>();
+    }
+  };
+
+/** // doc: bits::transaction {{{
+ * @brief Group modifications of several registers into as few accesses as
+ *        possible.
+ *
+ * All the @ref ct::op "op" items targeting the same address are merged
+ * together (as with @ref ct::mix "mix", overlapping masks generate
+ * compile-time error) and applied with a single
+ * @ref ct::modify "modify<>::at<>()", i.e. one read-modify-write per
+ * distinct register, a single store if the merged mask covers the whole
+ * register, or a store to bit-band alias for a single bit. The registers are
+ * modified in the order of their first appearance in @c _ops.
+ *
+ * <b>Example</b>:
+ *
+ * @code
+ * using t = transaction<
+ *   op<GPIOB_BASE + 0x00, gpio::ct::crl_masked<GPIO_Pin_0, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> >,
+ *   op<GPIOC_BASE + 0x04, gpio::ct::crh_masked<GPIO_Pin_8, GPIO_Mode_IPU> >,
+ *   op<GPIOB_BASE + 0x00, gpio::ct::crl_masked<GPIO_Pin_1, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> >
+ * >;
+ * t::apply(); // two read-modify-writes: GPIOB->CRL, then GPIOC->CRH
+ * @endcode
+ */ // }}}
+template <typename ... _ops>
+  struct transaction
+  {
+    typedef transaction_impl<op_list<_ops...> > _impl;
+    /** // doc: size {{{
+     * Number of distinct registers touched by the transaction.
+     * @hideinitializer
+     */ // }}}
+    constexpr static unsigned size = _impl::size;
+    /** // doc: apply() {{{
+     * @brief Perform the transaction.
+     */ // }}}
+    template <typename _Access = volatile_access>
+    static void apply()
+    {
+      _impl::template apply<_Access>();
+    }
+  };
+
+/** // doc: bits::table_entry {{{
+ * @brief Entry of a @ref ct::table "table": modification of one register.
+ *
+ * Bit 0 of @c addr (addresses are word-aligned) is @ref store_flag. When
+ * set, @c bits are just stored, otherwise the register is read and the
+ * bits under @c mask are replaced with @c bits.
+ */ // }}}
+struct table_entry
+{
+  /** // doc: store_flag {{{
+   * Flag in @c addr marking entries which are plain stores.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t store_flag = 0x1ul;
+
+  uint32_t addr;
+  uint32_t mask;
+  uint32_t bits;
+};
+
+/** // doc: bits::apply_table() {{{
+ * @brief Apply @c size entries of a @ref ct::table "table".
+ *
+ * One loop over the table, with a read-modify-write or a store per entry.
+ */ // }}}
+template <typename _Access>
+void
+apply_table(const table_entry* entry, std::size_t size)
+{
+  for(const table_entry* end = entry + size; entry != end; ++entry)
+    {
+      const uint32_t addr = entry->addr & ~table_entry::store_flag;
+      if(entry->addr & table_entry::store_flag)
+        {
+          _Access::write(addr, entry->bits);
+          access_hook::store(addr, entry->bits);
+        }
+      else
+        {
+          const uint32_t old = _Access::read(addr);
+          const uint32_t value = (old & ~entry->mask) | entry->bits;
+          _Access::write(addr, value);
+          access_hook::modify(addr, old, value);
+        }
+    }
+}
+
+/* Helpers of table. They work on arrays a (addresses) and m (masks or
+ * bits) of the ops, duplicates included, and fold over a range [lo, hi)
+ * split in halves, as the helpers of mix. */
+
+/* Smaller of x and y */
+constexpr uint32_t
+table_min(uint32_t x, uint32_t y)
+{
+  return (x < y) ? x : y;
+}
+
+/* Lowest a[i] >= x in [lo, hi), or 0xFFFFFFFF */
+constexpr uint32_t
+table_min_from(const uint32_t* a, std::size_t lo, std::size_t hi, uint32_t x)
+{
+  return (hi - lo == 0u) ? 0xFFFFFFFFul
+       : (hi - lo == 1u) ? ((a[lo] >= x) ? a[lo] : 0xFFFFFFFFul)
+       : table_min(table_min_from(a, lo, lo + (hi - lo) / 2u, x),
+                   table_min_from(a, lo + (hi - lo) / 2u, hi, x));
+}
+
+/* Bitwise OR of m[i] for a[i] == x in [lo, hi) */
+constexpr uint32_t
+table_or_at(const uint32_t* a, const uint32_t* m, std::size_t lo,
+            std::size_t hi, uint32_t x)
+{
+  return (hi - lo == 0u) ? 0ul
+       : (hi - lo == 1u) ? ((a[lo] == x) ? m[lo] : 0ul)
+       : table_or_at(a, m, lo, lo + (hi - lo) / 2u, x)
+       | table_or_at(a, m, lo + (hi - lo) / 2u, hi, x);
+}
+
+/* Arithmetic sum of m[i] for a[i] == x in [lo, hi) */
+constexpr uint64_t
+table_sum_at(const uint32_t* a, const uint32_t* m, std::size_t lo,
+             std::size_t hi, uint32_t x)
+{
+  return (hi - lo == 0u) ? 0ull
+       : (hi - lo == 1u) ? ((a[lo] == x) ? uint64_t(m[lo]) : 0ull)
+       : table_sum_at(a, m, lo, lo + (hi - lo) / 2u, x)
+       + table_sum_at(a, m, lo + (hi - lo) / 2u, hi, x);
+}
+
+/* Fails to compile if masks of the ops on register _addr overlap. The
+ * address shows up in the compiler's "required from" notes. */
+template <uint32_t _addr, bool _ok>
+  struct table_overlap_check
+  {
+    static_assert(_ok, "masks overlap (see the register address in "
+                       "table_overlap_check<addr, ...>)");
+    constexpr static bool value = _ok;
+  };
+
+/* Entry modifying bits under mask at addr: a store to the bit-band alias
+ * for a single bit, a plain store for the whole word, or a
+ * read-modify-write */
+constexpr table_entry
+table_make_entry(uint32_t addr, uint32_t mask, uint32_t bits)
+{
+  return (is_single_bit(mask) && is_bitband_address(addr))
+       ? table_entry{ bitband_alias(addr, bit_index(mask)) | table_entry::store_flag,
+                      0xFFFFFFFFul, (bits != 0ul) ? 1u : 0u }
+       : (mask == 0xFFFFFFFFul)
+       ? table_entry{ addr | table_entry::store_flag, mask, bits }
+       : table_entry{ addr, mask, bits };
+}
+
+/* Entries of _Table, placed in read-only memory. The distinct addresses
+ * of the ops are collected in _addrs in ascending order, one per
+ * instantiation, _next being the lowest address not collected yet
+ * (0xFFFFFFFF when done) */
+template <typename _Table, uint32_t _next, uint32_t... _addrs>
+  struct table_data
+    : table_data<_Table, table_min_from(_Table::_addrs, 0u, _Table::_n, _next + 1ul),
+                 _addrs..., _next>
+  {
+    static_assert(table_overlap_check<_next, _Table::disjoint_at(_next)>::value,
+                  "masks overlap");
+  };
+template <typename _Table, uint32_t... _addrs>
+  struct table_data<_Table, 0xFFFFFFFFul, _addrs...>
+  {
+    constexpr static std::size_t size = sizeof...(_addrs);
+    /* (one unused entry for an empty table) */
+    constexpr static table_entry entries[size ? size : 1u] = {
+      _Table::entry_at(_addrs)...
+    };
+  };
+
+template <typename _Table, uint32_t... _addrs>
+  constexpr table_entry table_data<_Table, 0xFFFFFFFFul, _addrs...>::entries[];
+
+/** // doc: bits::table {{{
+ * @brief Configuration list compiled into a constant table applied by a
+ *        loop.
+ *
+ * Takes the same @ref ct::op "op" items as @ref ct::transaction
+ * "transaction", but instead of generating inline code for each register,
+ * compiles them into a constexpr array of @ref bits::table_entry
+ * "table_entry" (address, mask, bits) placed in read-only memory (flash),
+ * which apply() walks with apply_table(), as the C runtime copies
+ * @c .data at reset. The code does not grow with the number of registers,
+ * only the table does (12 bytes per register).
+ *
+ * The entries are sorted by address. All the ops targeting the same address
+ * are merged into one entry (overlapping masks generate compile-time
+ * error). Entries whose merged mask covers the whole register are marked
+ * as plain stores, and single-bit entries in a bit-band region are turned
+ * into stores to the bit-band alias, so the memory accesses are the same
+ * as with transaction. Only their order differs.
+ *
+ * @note Since the registers are modified in the order of their addresses,
+ *       dependent modifications must be put in separate tables (or
+ *       transactions), e.g. peripheral clocks must be enabled in RCC before
+ *       configuring GPIO ports, which lie below RCC in the memory map.
+ *
+ * <b>Example</b>:
+ *
+ * @code
+ * using t = table<
+ *   op<GPIOC_BASE + 0x04, gpio::ct::crh_masked<GPIO_Pin_8, GPIO_Mode_IPU> >,
+ *   op<GPIOB_BASE + 0x00, gpio::ct::crl_masked<GPIO_Pin_0, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> >,
+ *   op<GPIOB_BASE + 0x00, gpio::ct::crl_masked<GPIO_Pin_1, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> >
+ * >;
+ * t::apply(); // two read-modify-writes: GPIOB->CRL, then GPIOC->CRH
+ * @endcode
+ */ // }}}
+template <typename ... _ops>
+  struct table
+  {
+    constexpr static std::size_t _n = sizeof...(_ops);
+    constexpr static uint32_t _addrs[_n + 1u] = { _ops::addr..., 0ul };
+    constexpr static uint32_t _masks[_n + 1u] = {
+      get_mask<typename _ops::masked_type>::value..., 0ul
+    };
+    constexpr static uint32_t _bits[_n + 1u] = {
+      get_bits<typename _ops::masked_type>::value..., 0ul
+    };
+
+    /* True if masks of the ops on register addr do not overlap */
+    constexpr static bool disjoint_at(uint32_t addr)
+    {
+      return table_sum_at(_addrs, _masks, 0u, _n, addr)
+          == table_or_at(_addrs, _masks, 0u, _n, addr);
+    }
+
+    /* Entry for register at address addr */
+    constexpr static table_entry entry_at(uint32_t addr)
+    {
+      return table_make_entry(addr, table_or_at(_addrs, _masks, 0u, _n, addr),
+                              table_or_at(_addrs, _bits, 0u, _n, addr));
+    }
+
+    typedef table_data<table, table_min_from(_addrs, 0u, _n, 0ul)> _data;
+
+    /** // doc: size {{{
+     * Number of entries (distinct registers).
+     * @hideinitializer
+     */ // }}}
+    constexpr static std::size_t size = _data::size;
+
+    /** // doc: entries() {{{
+     * @brief Return pointer to the first of @ref size entries.
+     */ // }}}
+    constexpr static const table_entry* entries()
+    {
+      return _data::entries;
+    }
+
+    /** // doc: apply() {{{
+     * @brief Apply the table.
+     */ // }}}
+    template <typename _Access = volatile_access>
+    static void apply()
+    {
+      apply_table<_Access>(_data::entries, size);
+    }
+  };
+
+template <typename ... _ops>
+  constexpr uint32_t table<_ops...>::_addrs[];
+template <typename ... _ops>
+  constexpr uint32_t table<_ops...>::_masks[];
+template <typename ... _ops>
+  constexpr uint32_t table<_ops...>::_bits[];
+
 } /* namespace ct */
+
+/** // doc: namesapce rt {{{
+ * @brief Runtime version of bit operations.
+ */ // }}}
+namespace rt {
+
+/** // doc: bits::rt::modify() {{{
+ * @brief Modify selected bits in a register or memory location.
+ *
+ * Runtime counterpart of @ref ct::modify "ct::modify". 
+ *
+ * <b>Example</b>:
+ *
+ * This sets 16 most significant bits in @c var to @c 0x1234.
+ *
+ * @code
+ * modify(var, 0x12340000ul, 0xFFFF0000ul);
+ * @endcode
+ */ // }}}
+template <typename T>
+inline void
+modify(T& x, uint32_t bits, uint32_t mask)
+{
+  const uint32_t old = x;
+  const uint32_t value = (old & ~mask) | bits;
+  x = value;
+  access_hook::modify(address_of(x), old, value);
+}
+
+} /* namespace rt */
 } /* namespace bits */
 } /* namespace stm32xx */
 
@@ -22,15 +22,21 @@
 
 /** // doc: stm32xx/core_cmx.h {{{
  * \file stm32xx/core_cmx.h
- * \todo Write documentation
+ * @brief CMSIS core header (core_cm3.h or core_cm4.h) of the target MCU.
+ *
+ * The device header (see stm32xx/stm32fxxx.h) is included first, as it
+ * configures the core header (e.g. @c __NVIC_PRIO_BITS). Defines
+ * @c CORE_CM3 or @c CORE_CM4.
  */ // }}}
 #ifndef STM32XX_CORE_CMX_H_INCLUDED
 #define STM32XX_CORE_CMX_H_INCLUDED
 
-#include <stm32xx/check.h>
+#include <stm32xx/stm32fxxx.h>
 
-#if defined(STM32F10X)
+#if defined(STM32_FAMILY_STM32F10X)
 # define CORE_CM3
+#elif defined(STM32_FAMILY_STM32F4XX)
+# define CORE_CM4
 #else
 # error "No supported target MCU specified!"
 #endif
@@ -38,6 +44,8 @@
 /* Include appropriate header form CMSIS library */
 #if defined (CORE_CM3)
 # include "core_cm3.h"
+#elif defined (CORE_CM4)
+# include "core_cm4.h"
 #else
 # error "Could not determine MCU core"
 #endif
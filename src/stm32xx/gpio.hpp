@@ -48,6 +48,34 @@ namespace gpio {
  */ // }}}
 namespace detail {
 
+#if defined(STM32_FAMILY_STM32F10X)
+
+/** // doc: gpio::detail::crl_nibbles() {{{
+ * @brief Return @c 0x1 in every GPIOx_CRL nibble that belongs to @c pins.
+ *
+ * All the CRL computations below are built on top of this function by
+ * multiplying its result by a 4-bit value. The computation is branch-free
+ * (see bits::spread4()).
+ */ // }}}
+constexpr uint32_t
+crl_nibbles(pins_t pins)
+{
+  return bits::spread4(pins & 0xFFul);
+}
+
+/** // doc: gpio::detail::crh_nibbles() {{{
+ * @brief Return @c 0x1 in every GPIOx_CRH nibble that belongs to @c pins.
+ *
+ * All the CRH computations below are built on top of this function by
+ * multiplying its result by a 4-bit value. The computation is branch-free
+ * (see bits::spread4()).
+ */ // }}}
+constexpr uint32_t
+crh_nibbles(pins_t pins)
+{
+  return bits::spread4(pins >> 8);
+}
+
 /** // doc: gpio::detail::crl_cnf_bits() {{{
  * @brief Compute CNF bits for GPIOx_CRL register.
  *
@@ -64,14 +92,7 @@ namespace detail {
 constexpr uint32_t
 crl_cnf_bits(pins_t pins, GPIOMode_TypeDef mode)
 {
-  return  ((pins & GPIO_Pin_0) ? ((mode & 0x0Cul) << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_1) ? ((mode & 0x0Cul) << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_2) ? ((mode & 0x0Cul) << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_3) ? ((mode & 0x0Cul) << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_4) ? ((mode & 0x0Cul) << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_5) ? ((mode & 0x0Cul) << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_6) ? ((mode & 0x0Cul) << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_7) ? ((mode & 0x0Cul) << 0x1C) : 0x00);
+  return crl_nibbles(pins) * (mode & 0x0Cul);
 }
 
 /** // doc: gpio::detail::crl_cnf_mask() {{{
@@ -80,14 +101,7 @@ crl_cnf_bits(pins_t pins, GPIOMode_TypeDef mode)
 constexpr uint32_t
 crl_cnf_mask(pins_t pins)
 {
-  return  ((pins & GPIO_Pin_0) ? (0x0Cul << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_1) ? (0x0Cul << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_2) ? (0x0Cul << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_3) ? (0x0Cul << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_4) ? (0x0Cul << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_5) ? (0x0Cul << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_6) ? (0x0Cul << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_7) ? (0x0Cul << 0x1C) : 0x00);
+  return crl_nibbles(pins) * 0x0Cul;
 }
 
 /** // doc: gpio::detail::crh_cnf_bits() {{{
@@ -104,14 +118,7 @@ crl_cnf_mask(pins_t pins)
 constexpr uint32_t
 crh_cnf_bits(pins_t pins, GPIOMode_TypeDef mode)
 {
-  return  ((pins & GPIO_Pin_8 ) ? ((mode & 0x0C) << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_9 ) ? ((mode & 0x0C) << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_10) ? ((mode & 0x0C) << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_11) ? ((mode & 0x0C) << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_12) ? ((mode & 0x0C) << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_13) ? ((mode & 0x0C) << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_14) ? ((mode & 0x0C) << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_15) ? ((mode & 0x0C) << 0x1C) : 0x00);
+  return crh_nibbles(pins) * (mode & 0x0Cul);
 }
 
 /** // doc: gpio::detail::crh_cnf_mask() {{{
@@ -120,14 +127,7 @@ crh_cnf_bits(pins_t pins, GPIOMode_TypeDef mode)
 constexpr uint32_t
 crh_cnf_mask(pins_t pins)
 {
-  return  ((pins & GPIO_Pin_8 ) ? (0x0Cul << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_9 ) ? (0x0Cul << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_10) ? (0x0Cul << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_11) ? (0x0Cul << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_12) ? (0x0Cul << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_13) ? (0x0Cul << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_14) ? (0x0Cul << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_15) ? (0x0Cul << 0x1C) : 0x00);
+  return crh_nibbles(pins) * 0x0Cul;
 }
 
 /** // doc: gpio::detail::crl_mode_bits() {{{
@@ -144,14 +144,7 @@ crh_cnf_mask(pins_t pins)
 constexpr uint32_t
 crl_mode_bits(pins_t pins, GPIOSpeed_TypeDef speed)
 {
-  return  ((pins & GPIO_Pin_0) ? ((speed & 0x03) << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_1) ? ((speed & 0x03) << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_2) ? ((speed & 0x03) << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_3) ? ((speed & 0x03) << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_4) ? ((speed & 0x03) << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_5) ? ((speed & 0x03) << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_6) ? ((speed & 0x03) << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_7) ? ((speed & 0x03) << 0x1C) : 0x00);
+  return crl_nibbles(pins) * (speed & 0x03ul);
 }
 
 /** // doc: gpio::detail::crl_mode_mask() {{{
@@ -160,14 +153,7 @@ crl_mode_bits(pins_t pins, GPIOSpeed_TypeDef speed)
 constexpr uint32_t
 crl_mode_mask(pins_t pins)
 {
-  return  ((pins & GPIO_Pin_0) ? (0x03 << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_1) ? (0x03 << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_2) ? (0x03 << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_3) ? (0x03 << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_4) ? (0x03 << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_5) ? (0x03 << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_6) ? (0x03 << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_7) ? (0x03 << 0x1C) : 0x00);
+  return crl_nibbles(pins) * 0x03ul;
 }
 
 /** // doc: gpio::detail::crh_mode_bits() {{{
@@ -184,14 +170,7 @@ crl_mode_mask(pins_t pins)
 constexpr uint32_t
 crh_mode_bits(pins_t pins, GPIOSpeed_TypeDef speed)
 {
-  return  ((pins & GPIO_Pin_8 ) ? ((speed & 0x03) << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_9 ) ? ((speed & 0x03) << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_10) ? ((speed & 0x03) << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_11) ? ((speed & 0x03) << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_12) ? ((speed & 0x03) << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_13) ? ((speed & 0x03) << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_14) ? ((speed & 0x03) << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_15) ? ((speed & 0x03) << 0x1C) : 0x00);
+  return crh_nibbles(pins) * (speed & 0x03ul);
 }
 
 /** // doc: gpio::detail::crh_mode_mask {{{
@@ -200,18 +179,25 @@ crh_mode_bits(pins_t pins, GPIOSpeed_TypeDef speed)
 constexpr uint32_t
 crh_mode_mask(pins_t pins)
 {
-  return  ((pins & GPIO_Pin_8 ) ? (0x03 << 0x00) : 0x00)
-        | ((pins & GPIO_Pin_9 ) ? (0x03 << 0x04) : 0x00)
-        | ((pins & GPIO_Pin_10) ? (0x03 << 0x08) : 0x00)
-        | ((pins & GPIO_Pin_11) ? (0x03 << 0x0C) : 0x00)
-        | ((pins & GPIO_Pin_12) ? (0x03 << 0x10) : 0x00)
-        | ((pins & GPIO_Pin_13) ? (0x03 << 0x14) : 0x00)
-        | ((pins & GPIO_Pin_14) ? (0x03 << 0x18) : 0x00)
-        | ((pins & GPIO_Pin_15) ? (0x03 << 0x1C) : 0x00);
+  return crh_nibbles(pins) * 0x03ul;
 }
 
-/** // doc: gpio::detail::crh_bits() {{{
- * @brief Compute bits for GPIOx_CRH register.
+/** // doc: gpio::detail::cnf_mode() {{{
+ * @brief Compute the 4-bit (CNF,MODE) field for a single pin.
+ *
+ * As in StdPeriph's @c GPIO_Init(), @c speed is taken into account only for
+ * output modes. The computation is branch-free.
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+constexpr uint32_t
+cnf_mode(GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
+{
+  return (mode & 0x0Cul) | (speed & (((mode & 0x10ul) >> 4) * 0x03ul));
+}
+
+/** // doc: gpio::detail::crl_bits() {{{
+ * @brief Compute bits for GPIOx_CRL register.
  *
  * <b>Usage example</b>:
  *
@@ -220,21 +206,27 @@ crh_mode_mask(pins_t pins)
  * GPIOB->CRL |= crl_bits(PINS,GPIO_mode_Output_PP,GPIO_speed_10MHz);
  * @endcode
  *
+ * @note The computation is branch-free, it's used by both gpio::ct and
+ *       gpio::rt.
+ *
  * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
  */ // }}}
 constexpr uint32_t
 crl_bits(pins_t pins, GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
 {
-  return crl_cnf_bits(pins, mode) | crl_mode_bits(pins, speed);
+  return crl_nibbles(pins) * cnf_mode(mode, speed);
 }
 
 /** // doc: gpio::detail::crl_mask() {{{
- * @todo Write documentation for crl_mask().
+ * @brief Compute mask for GPIOx_CRL register.
+ *
+ * The mask covers the (CNF,MODE) nibbles of pins @c 0 to @c 7 found in
+ * @c pins.
  */ // }}}
 constexpr uint32_t
 crl_mask(pins_t pins)
 {
-  return crl_cnf_mask(pins) | crl_mode_mask(pins);
+  return crl_nibbles(pins) * 0x0Ful;
 }
 
 /** // doc: gpio::detail::crh_bits() {{{
@@ -247,24 +239,384 @@ crl_mask(pins_t pins)
  * GPIOB->CRH |= crh_bits(PINS,GPIO_mode_Output_PP,GPIO_speed_10MHz);
  * @endcode
  *
+ * @note The computation is branch-free, it's used by both gpio::ct and
+ *       gpio::rt.
+ *
  * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
  */ // }}}
 constexpr uint32_t
 crh_bits(pins_t pins, GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
 {
-  return crh_cnf_bits(pins, mode) | crh_mode_bits(pins, speed);
+  return crh_nibbles(pins) * cnf_mode(mode, speed);
 }
 
 /** // doc: gpio::detail::crh_mask() {{{
- * @todo Write documentation for crh_mask().
+ * @brief Compute mask for GPIOx_CRH register.
+ *
+ * The mask covers the (CNF,MODE) nibbles of pins @c 8 to @c 15 found in
+ * @c pins.
  */ // }}}
 constexpr uint32_t
 crh_mask(pins_t pins)
 {
-  return crh_cnf_mask(pins) | crh_mode_mask(pins);
+  return crh_nibbles(pins) * 0x0Ful;
 }
 
-} /* namespace rt */
+/** // doc: gpio::detail::pull_bsrr() {{{
+ * @brief Compute GPIOx_BSRR value which selects the pull of input pins.
+ *
+ * An input with pull-up/pull-down pulls towards the level of its GPIOx_ODR
+ * bit. As in StdPeriph's @c GPIO_Init(), the value sets @c pins for
+ * @c GPIO_Mode_IPU and resets them for @c GPIO_Mode_IPD. It is zero for
+ * other modes. The computation is branch-free.
+ */ // }}}
+constexpr uint32_t
+pull_bsrr(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return ((uint32_t)pins * (mode == GPIO_Mode_IPU))
+       | (((uint32_t)pins * (mode == GPIO_Mode_IPD)) << 16);
+}
+
+#elif defined(STM32_FAMILY_STM32F4XX)
+
+/** // doc: gpio::detail::pin_pairs() {{{
+ * @brief Return @c 0x1 in every 2-bit field that belongs to @c pins.
+ *
+ * GPIOx_MODER, GPIOx_OSPEEDR and GPIOx_PUPDR have one 2-bit field per pin.
+ * Their bits and masks are computed by multiplying the result of this
+ * function by a 2-bit value. The computation is branch-free (see
+ * bits::spread2()).
+ */ // }}}
+constexpr uint32_t
+pin_pairs(pins_t pins)
+{
+  return bits::spread2(pins);
+}
+
+/** // doc: gpio::detail::afrl_nibbles() {{{
+ * @brief Return @c 0x1 in every GPIOx_AFRL nibble that belongs to @c pins.
+ */ // }}}
+constexpr uint32_t
+afrl_nibbles(pins_t pins)
+{
+  return bits::spread4(pins & 0xFFul);
+}
+
+/** // doc: gpio::detail::afrh_nibbles() {{{
+ * @brief Return @c 0x1 in every GPIOx_AFRH nibble that belongs to @c pins.
+ */ // }}}
+constexpr uint32_t
+afrh_nibbles(pins_t pins)
+{
+  return bits::spread4(pins >> 8);
+}
+
+/** // doc: gpio::detail::is_output() {{{
+ * @brief Return 1 for @c GPIO_Mode_OUT and @c GPIO_Mode_AF, 0 otherwise.
+ *
+ * As in StdPeriph's @c GPIO_Init(), output type and speed are set only for
+ * these modes. The computation is branch-free.
+ */ // }}}
+constexpr uint32_t
+is_output(GPIOMode_TypeDef mode)
+{
+  return ((mode + 1ul) >> 1) & 0x01ul;
+}
+
+/** // doc: gpio::detail::is_af() {{{
+ * @brief Return 1 for @c GPIO_Mode_AF, 0 otherwise (branch-free).
+ */ // }}}
+constexpr uint32_t
+is_af(GPIOMode_TypeDef mode)
+{
+  return (mode >> 1) & ~mode & 0x01ul;
+}
+
+/** // doc: gpio::detail::moder_bits() {{{
+ * @brief Compute bits for GPIOx_MODER register.
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+constexpr uint32_t
+moder_bits(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return pin_pairs(pins) * (mode & 0x03ul);
+}
+
+/** // doc: gpio::detail::moder_mask() {{{
+ * @brief Compute mask for GPIOx_MODER register.
+ */ // }}}
+constexpr uint32_t
+moder_mask(pins_t pins)
+{
+  return pin_pairs(pins) * 0x03ul;
+}
+
+/** // doc: gpio::detail::otyper_bits() {{{
+ * @brief Compute bits for GPIOx_OTYPER register.
+ *
+ * The bits are zero unless @c mode is an output mode (see is_output()).
+ */ // }}}
+constexpr uint32_t
+otyper_bits(pins_t pins, GPIOMode_TypeDef mode, GPIOOType_TypeDef otype)
+{
+  return pins * ((otype & 0x01ul) & is_output(mode));
+}
+
+/** // doc: gpio::detail::otyper_mask() {{{
+ * @brief Compute mask for GPIOx_OTYPER register.
+ *
+ * The mask is zero unless @c mode is an output mode (see is_output()), so
+ * the register is left untouched when configuring inputs.
+ */ // }}}
+constexpr uint32_t
+otyper_mask(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return pins * is_output(mode);
+}
+
+/** // doc: gpio::detail::ospeedr_bits() {{{
+ * @brief Compute bits for GPIOx_OSPEEDR register.
+ *
+ * The bits are zero unless @c mode is an output mode (see is_output()).
+ */ // }}}
+constexpr uint32_t
+ospeedr_bits(pins_t pins, GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
+{
+  return pin_pairs(pins) * ((speed & 0x03ul) * is_output(mode));
+}
+
+/** // doc: gpio::detail::ospeedr_mask() {{{
+ * @brief Compute mask for GPIOx_OSPEEDR register.
+ *
+ * The mask is zero unless @c mode is an output mode (see is_output()).
+ */ // }}}
+constexpr uint32_t
+ospeedr_mask(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return pin_pairs(pins) * (0x03ul * is_output(mode));
+}
+
+/** // doc: gpio::detail::pupdr_bits() {{{
+ * @brief Compute bits for GPIOx_PUPDR register.
+ */ // }}}
+constexpr uint32_t
+pupdr_bits(pins_t pins, GPIOPuPd_TypeDef pupd)
+{
+  return pin_pairs(pins) * (pupd & 0x03ul);
+}
+
+/** // doc: gpio::detail::pupdr_mask() {{{
+ * @brief Compute mask for GPIOx_PUPDR register.
+ */ // }}}
+constexpr uint32_t
+pupdr_mask(pins_t pins)
+{
+  return pin_pairs(pins) * 0x03ul;
+}
+
+/** // doc: gpio::detail::afrl_bits() {{{
+ * @brief Compute bits for GPIOx_AFRL (@c AFR[0]) register.
+ *
+ * The bits are zero unless @c mode is @c GPIO_Mode_AF (see is_af()).
+ */ // }}}
+constexpr uint32_t
+afrl_bits(pins_t pins, GPIOMode_TypeDef mode, uint8_t af)
+{
+  return afrl_nibbles(pins) * ((af & 0x0Ful) * is_af(mode));
+}
+
+/** // doc: gpio::detail::afrl_mask() {{{
+ * @brief Compute mask for GPIOx_AFRL (@c AFR[0]) register.
+ *
+ * The mask is zero unless @c mode is @c GPIO_Mode_AF (see is_af()).
+ */ // }}}
+constexpr uint32_t
+afrl_mask(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return afrl_nibbles(pins) * (0x0Ful * is_af(mode));
+}
+
+/** // doc: gpio::detail::afrh_bits() {{{
+ * @brief Compute bits for GPIOx_AFRH (@c AFR[1]) register.
+ *
+ * The bits are zero unless @c mode is @c GPIO_Mode_AF (see is_af()).
+ */ // }}}
+constexpr uint32_t
+afrh_bits(pins_t pins, GPIOMode_TypeDef mode, uint8_t af)
+{
+  return afrh_nibbles(pins) * ((af & 0x0Ful) * is_af(mode));
+}
+
+/** // doc: gpio::detail::afrh_mask() {{{
+ * @brief Compute mask for GPIOx_AFRH (@c AFR[1]) register.
+ *
+ * The mask is zero unless @c mode is @c GPIO_Mode_AF (see is_af()).
+ */ // }}}
+constexpr uint32_t
+afrh_mask(pins_t pins, GPIOMode_TypeDef mode)
+{
+  return afrh_nibbles(pins) * (0x0Ful * is_af(mode));
+}
+
+#endif /* STM32_FAMILY_STM32F4XX */
+
+/* GPIOx_BSRR of a port with 32-bit BSRR member (STM32F10x) */
+template <typename _Port>
+inline auto
+bsrr(_Port& port, int) -> decltype((port.BSRR))
+{
+  return port.BSRR;
+}
+
+/* GPIOx_BSRR of a port with BSRRL/BSRRH halves (STM32F4xx StdPeriph),
+ * accessed as a single 32-bit register */
+template <typename _Port>
+inline volatile uint32_t&
+bsrr(_Port& port, long)
+{
+  return *reinterpret_cast<volatile uint32_t*>(&port.BSRRL);
+}
+
+/** // doc: gpio::detail::bsrr() {{{
+ * @brief Return GPIOx_BSRR register of @c port as a 32-bit register.
+ *
+ * StdPeriph for STM32F4xx declares BSRR as two 16-bit halves (@c BSRRL and
+ * @c BSRRH). Both are written at once with a single 32-bit store, as on
+ * STM32F10x.
+ */ // }}}
+template <typename _Port>
+inline auto
+bsrr(_Port& port) -> decltype(bsrr(port, 0))
+{
+  return bsrr(port, 0);
+}
+
+/** // doc: gpio::detail::idr_offset {{{
+ * @brief Offset of GPIOx_IDR register from the GPIO port base address.
+ */ // }}}
+constexpr uint32_t idr_offset = offsetof(GPIO_TypeDef, IDR);
+
+/** // doc: gpio::detail::odr_offset {{{
+ * @brief Offset of GPIOx_ODR register from the GPIO port base address.
+ */ // }}}
+constexpr uint32_t odr_offset = offsetof(GPIO_TypeDef, ODR);
+
+/** // doc: gpio::detail::bsrr_offset {{{
+ * @brief Offset of (32-bit) GPIOx_BSRR register from the GPIO port base
+ *        address.
+ *
+ * @see bsrr()
+ */ // }}}
+#if defined(STM32_FAMILY_STM32F4XX)
+constexpr uint32_t bsrr_offset = offsetof(GPIO_TypeDef, BSRRL);
+#else
+constexpr uint32_t bsrr_offset = offsetof(GPIO_TypeDef, BSRR);
+#endif
+
+#if defined(STM32_FAMILY_STM32F10X)
+/** // doc: gpio::detail::crl_reset {{{
+ * @brief Reset value of GPIOx_CRL register (all pins floating inputs).
+ *
+ * @see ST RM0008 Reference manual (STM32F10x), section 9.2.1.
+ */ // }}}
+constexpr uint32_t crl_reset = 0x44444444ul;
+
+/** // doc: gpio::detail::crh_reset {{{
+ * @brief Reset value of GPIOx_CRH register (all pins floating inputs).
+ *
+ * @see ST RM0008 Reference manual (STM32F10x), section 9.2.2.
+ */ // }}}
+constexpr uint32_t crh_reset = 0x44444444ul;
+#elif defined(STM32_FAMILY_STM32F4XX)
+/** // doc: gpio::detail::moder_reset() {{{
+ * @brief Reset value of GPIOx_MODER register of GPIO @c port.
+ *
+ * Debug pins (JTAG/SWD) on GPIOA and GPIOB are in alternate function mode
+ * after reset, all other pins are inputs.
+ *
+ * @param port base address of the port, e.g. @c GPIOA_BASE.
+ * @see ST RM0090 Reference manual (STM32F4xx), section 8.4.1.
+ */ // }}}
+constexpr uint32_t
+moder_reset(uint32_t port)
+{
+  return (port == GPIOA_BASE) ? 0xA8000000ul
+       : (port == GPIOB_BASE) ? 0x00000280ul
+       : 0ul;
+}
+
+/** // doc: gpio::detail::ospeedr_reset() {{{
+ * @brief Reset value of GPIOx_OSPEEDR register of GPIO @c port.
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx), section 8.4.3.
+ */ // }}}
+constexpr uint32_t
+ospeedr_reset(uint32_t port)
+{
+  return (port == GPIOA_BASE) ? 0x0C000000ul
+       : (port == GPIOB_BASE) ? 0x000000C0ul
+       : 0ul;
+}
+
+/** // doc: gpio::detail::pupdr_reset() {{{
+ * @brief Reset value of GPIOx_PUPDR register of GPIO @c port.
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx), section 8.4.4.
+ */ // }}}
+constexpr uint32_t
+pupdr_reset(uint32_t port)
+{
+  return (port == GPIOA_BASE) ? 0x64000000ul
+       : (port == GPIOB_BASE) ? 0x00000100ul
+       : 0ul;
+}
+
+/* GPIOx_OTYPER, GPIOx_AFRL and GPIOx_AFRH reset to 0 on all ports */
+#endif
+
+/* True if all of a[lo..hi) equal x, split in halves as bits::ct::mix_or() */
+constexpr bool
+all_equal(const uint32_t* a, std::size_t lo, std::size_t hi, uint32_t x)
+{
+  return (hi - lo == 0u) ? true
+       : (hi - lo == 1u) ? (a[lo] == x)
+       : all_equal(a, lo, lo + (hi - lo) / 2u, x)
+         && all_equal(a, lo + (hi - lo) / 2u, hi, x);
+}
+
+/* Pins of pin_conf entries _confs configured in mode _mode */
+template <GPIOMode_TypeDef _mode, typename... _confs>
+struct mode_pins
+{
+  constexpr static pins_t value = 0;
+};
+
+template <GPIOMode_TypeDef _mode, typename _Head, typename... _Tail>
+struct mode_pins<_mode, _Head, _Tail...>
+{
+  constexpr static pins_t value = ((_Head::mode == _mode) ? _Head::pins : 0)
+                                | mode_pins<_mode, _Tail...>::value;
+};
+
+#if defined(STM32_FAMILY_STM32F4XX)
+/* Pins of pin_conf entries _confs configured as inputs with pull _pupd */
+template <GPIOPuPd_TypeDef _pupd, typename... _confs>
+struct input_pull_pins
+{
+  constexpr static pins_t value = 0;
+};
+
+template <GPIOPuPd_TypeDef _pupd, typename _Head, typename... _Tail>
+struct input_pull_pins<_pupd, _Head, _Tail...>
+{
+  constexpr static pins_t value =
+      ((_Head::mode == GPIO_Mode_IN && _Head::pupd == _pupd) ? _Head::pins : 0)
+    | input_pull_pins<_pupd, _Tail...>::value;
+};
+#endif
+
+} /* namespace detail */
 } /* namespace gpio */
 } /* namespace stm32xx */
 
@@ -276,6 +628,8 @@ namespace gpio {
  */ // }}}
 namespace ct {
 
+#if defined(STM32_FAMILY_STM32F10X)
+
 /** // doc: gpio::ct::pin_conf {{{
  * @brief Configuration for GPIO pins.
  *
@@ -525,11 +879,24 @@ struct crh_mask
   constexpr static uint32_t value = detail::crh_mask(_pins);
 };
 
+/** // doc: gpio::ct::crl_masked {{{
+ * @brief Bits and mask for GPIOx_CRL register as bits::ct::masked.
+ *
+ * <b>Usage example</b>:
+ *
+ * @code
+ * #define PINS (GPIO_Pin_0|GPIO_Pin_1)
+ * using m = crl_masked<PINS, GPIO_Mode_Out_PP, GPIO_Speed_10MHz>;
+ * bits::ct::modify<m>::in(GPIOB->CRL);
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
 template <pins_t _pins, GPIOMode_TypeDef _mode,
           GPIOSpeed_TypeDef _speed=(GPIOSpeed_TypeDef)0>
 struct crl_masked
   : bits::ct::masked< crl_bits<_pins,_mode,_speed>::value,
-                      crl_mask<_pins,_mode,_speed>::value >
+                      crl_mask<_pins>::value >
 {
   static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
   static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
@@ -538,11 +905,24 @@ struct crl_masked
                 "invalid speed specifier for selected mode");
 };
 
+/** // doc: gpio::ct::crh_masked {{{
+ * @brief Bits and mask for GPIOx_CRH register as bits::ct::masked.
+ *
+ * <b>Usage example</b>:
+ *
+ * @code
+ * #define PINS (GPIO_Pin_8|GPIO_Pin_9)
+ * using m = crh_masked<PINS, GPIO_Mode_Out_PP, GPIO_Speed_10MHz>;
+ * bits::ct::modify<m>::in(GPIOB->CRH);
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
 template <pins_t _pins, GPIOMode_TypeDef _mode,
           GPIOSpeed_TypeDef _speed=(GPIOSpeed_TypeDef)0>
 struct crh_masked
   : bits::ct::masked< crh_bits<_pins,_mode,_speed>::value,
-                      crh_mask<_pins,_mode,_speed>::value >
+                      crh_mask<_pins>::value >
 {
   static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
   static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
@@ -551,7 +931,1280 @@ struct crh_masked
                 "invalid speed specifier for selected mode");
 };
 
-} /* namespace ct */
+/** // doc: gpio::ct::port_conf {{{
+ * @brief Configuration of several groups of pins on a single GPIO port.
+ *
+ * This struct folds any number of @ref ct::pin_conf "pin_conf" entries into
+ * one @ref ct::crl_masked "crl_masked" and one @ref ct::crh_masked
+ * "crh_masked" value (using bits::ct::mix). The whole port is then
+ * configured with at most two read-modify-write operations, one on
+ * GPIOx_CRL and one on GPIOx_CRH. A register which is not touched by any of
+ * the entries is not accessed at all.
+ *
+ * It is asserted at compile-time that no pin is configured twice (the masks
+ * of the entries must not overlap).
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * using leds    = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+ * using buttons = pin_conf<GPIO_Pin_8|GPIO_Pin_9, GPIO_Mode_IPU>;
+ * using usart   = pin_conf<GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+ * port_conf<leds, buttons, usart>::in(*GPIOB);
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+template <typename ... _confs>
+struct port_conf
+{
+  /** // doc: crl {{{
+   * Bits and mask for GPIOx_CRL register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< crl_masked<_confs::pins, _confs::mode,
+                                    _confs::speed>... > crl;
+  /** // doc: crh {{{
+   * Bits and mask for GPIOx_CRH register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< crh_masked<_confs::pins, _confs::mode,
+                                    _confs::speed>... > crh;
+
+  /** // doc: in() {{{
+   * @brief Apply the configuration to GPIO @c port.
+   *
+   * @param port the GPIO port to be configured, e.g. @c *GPIOB.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    bits::ct::modify<crl>::in(port.CRL);
+    bits::ct::modify<crh>::in(port.CRH);
+  }
+
+  /** // doc: init() {{{
+   * @brief Apply the configuration to GPIO @c port just after reset.
+   *
+   * Same as in(), but GPIOx_CRL and GPIOx_CRH are assumed to hold their
+   * reset values (detail::crl_reset, detail::crh_reset), so each touched
+   * register is written with a single store computed at compile time and
+   * is not read (see bits::ct::from_reset). In debug builds it is asserted
+   * that the registers were not modified since reset.
+   *
+   * @param port the GPIO port to be configured, e.g. @c *GPIOB.
+   */ // }}}
+  template <typename _Port>
+  static void init(_Port& port)
+  {
+    bits::ct::from_reset<crl, detail::crl_reset>::in(port.CRL);
+    bits::ct::from_reset<crh, detail::crh_reset>::in(port.CRH);
+  }
+
+  /** // doc: init_at() {{{
+   * @brief Apply the configuration to GPIO port at address @c _port just
+   *        after reset, see init().
+   *
+   * @tparam _port base address of the port, e.g. @c GPIOB_BASE.
+   * @tparam _Access memory access policy, see bits::volatile_access.
+   */ // }}}
+  template <uint32_t _port, typename _Access = bits::volatile_access>
+  static void init_at()
+  {
+    bits::ct::from_reset<crl, detail::crl_reset>::template
+      at<_port + offsetof(GPIO_TypeDef, CRL), _Access>();
+    bits::ct::from_reset<crh, detail::crh_reset>::template
+      at<_port + offsetof(GPIO_TypeDef, CRH), _Access>();
+  }
+};
+
+/* port_conf of a pin_conf, or the port_conf itself */
+template <typename _Conf>
+struct as_port_conf
+{
+  typedef _Conf type;
+};
+
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOSpeed_TypeDef _speed>
+struct as_port_conf< pin_conf<_pins, _mode, _speed> >
+{
+  typedef port_conf< pin_conf<_pins, _mode, _speed> > type;
+};
+
+/* GPIOx_BSRR value selecting the pulls of the inputs of a port_conf */
+template <typename _Conf>
+struct pull_bsrr_of;
+
+template <typename ... _confs>
+struct pull_bsrr_of< port_conf<_confs...> >
+{
+  constexpr static uint32_t value =
+      detail::pull_bsrr(detail::mode_pins<GPIO_Mode_IPU, _confs...>::value, GPIO_Mode_IPU)
+    | detail::pull_bsrr(detail::mode_pins<GPIO_Mode_IPD, _confs...>::value, GPIO_Mode_IPD);
+};
+
+/* Implementation of transition<> */
+template <typename _From, typename _To>
+struct transition_impl;
+
+template <typename ... _from, typename ... _to>
+struct transition_impl< port_conf<_from...>, port_conf<_to...> >
+{
+  typedef port_conf<_from...> from;
+  typedef port_conf<_to...> to;
+
+  /** // doc: crl {{{
+   * Bits of GPIOx_CRL which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::crl, typename to::crl> crl;
+  /** // doc: crh {{{
+   * Bits of GPIOx_CRH which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::crh, typename to::crh> crh;
+
+  /** // doc: set {{{
+   * Pins set in GPIOx_ODR before the mode change (pull-ups of @c _To).
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t set = detail::mode_pins<GPIO_Mode_IPU, _to...>::value;
+  /** // doc: reset {{{
+   * Pins reset in GPIOx_ODR before the mode change (pull-downs of @c _To).
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t reset = detail::mode_pins<GPIO_Mode_IPD, _to...>::value;
+  /** // doc: bsrr {{{
+   * Value stored to GPIOx_BSRR, the mask is 0 if there is nothing to store.
+   */ // }}}
+  typedef bits::ct::masked< (uint32_t)set | ((uint32_t)reset << 16),
+                            ((set | reset) != 0) ? 0xFFFFFFFFul : 0ul > bsrr;
+
+  /** // doc: in() {{{
+   * @brief Reconfigure GPIO @c port from @c _From to @c _To.
+   *
+   * @param port the GPIO port, e.g. @c *GPIOB.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    bits::ct::modify<bsrr>::in(detail::bsrr(port));
+    bits::ct::modify<crl>::in(port.CRL);
+    bits::ct::modify<crh>::in(port.CRH);
+  }
+
+  /** // doc: at() {{{
+   * @brief Reconfigure GPIO port at address @c _port from @c _From to
+   *        @c _To.
+   *
+   * @tparam _port base address of the port, e.g. @c GPIOB_BASE.
+   * @tparam _Access memory access policy, see bits::volatile_access.
+   */ // }}}
+  template <uint32_t _port, typename _Access = bits::volatile_access>
+  static void at()
+  {
+    bits::ct::modify<bsrr>::template at<_port + detail::bsrr_offset, _Access>();
+    bits::ct::modify<crl>::template at<_port + offsetof(GPIO_TypeDef, CRL), _Access>();
+    bits::ct::modify<crh>::template at<_port + offsetof(GPIO_TypeDef, CRH), _Access>();
+  }
+};
+
+/** // doc: gpio::ct::transition {{{
+ * @brief Reconfiguration of GPIO pins from a known configuration to
+ *        another one, writing only what changes.
+ *
+ * @c _From and @c _To are @ref ct::pin_conf "pin_conf" or
+ * @ref ct::port_conf "port_conf" types. @c _From is the configuration the
+ * port is known to be in, @c _To the new one. The bits of GPIOx_CRL and
+ * GPIOx_CRH which differ (or belong to pins not in @c _From) are computed
+ * at compile time (@ref crl, @ref crh, see bits::ct::delta), and only
+ * those are modified; a register without changes is not accessed at all.
+ * Pins of @c _From which are not in @c _To are left as they are.
+ *
+ * The pull of an input is selected by its bit in GPIOx_ODR. All the
+ * pulled-up (@c GPIO_Mode_IPU) and pulled-down (@c GPIO_Mode_IPD) inputs of
+ * @c _To have their GPIOx_ODR bits written first, with a single store to
+ * GPIOx_BSRR, so the pull is right as soon as the mode changes. This
+ * includes pins which already have the same pull in @c _From: their
+ * GPIOx_ODR bits are not known, as writes to GPIOx_ODR (e.g. ct::write)
+ * also change the pull of inputs. An input with a pull which becomes an
+ * output keeps its level, since GPIOx_ODR holds it.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // USART1 TX on PA9, released as a pulled-up input in low-power mode
+ * using tx  = pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+ * using idle = pin_conf<GPIO_Pin_9, GPIO_Mode_IPU>;
+ * transition<tx, idle>::in(*GPIOA);  // GPIOA->BSRR = GPIO_Pin_9, one RMW of CRH
+ * transition<idle, tx>::in(*GPIOA);  // one RMW of CRH
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+template <typename _From, typename _To>
+struct transition
+  : transition_impl< typename as_port_conf<_From>::type,
+                     typename as_port_conf<_To>::type >
+{
+};
+
+/** // doc: gpio::ct::config_set {{{
+ * @brief Set of configurations of the same pins, one of them chosen at run
+ *        time.
+ *
+ * Each of @c _confs is a @ref ct::pin_conf "pin_conf" or
+ * @ref ct::port_conf "port_conf" type, all of them covering the same pins
+ * (checked at compile time). Their GPIOx_CRL and GPIOx_CRH bits and masks
+ * (@ref ct::crl_masked "crl_masked", @ref ct::crh_masked "crh_masked") and
+ * the GPIOx_BSRR value which selects the pulls of their
+ * @c GPIO_Mode_IPU/@c GPIO_Mode_IPD inputs are computed at compile time
+ * into @ref table, a constant array placed in read-only memory (flash),
+ * with 20 bytes per configuration. in() looks the configuration up by
+ * index, stores the pulls to GPIOx_BSRR (only if some configuration has a
+ * pull) and then does one read-modify-write per register, without
+ * branches. A register with none of the pins is not accessed.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // USART1 TX on PA9, as USART, as GPIO or released
+ * typedef config_set< pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>,
+ *                     pin_conf<GPIO_Pin_9, GPIO_Mode_Out_PP, GPIO_Speed_50MHz>,
+ *                     pin_conf<GPIO_Pin_9, GPIO_Mode_IN_FLOATING> > tx_roles;
+ * enum { tx_usart, tx_gpio, tx_hiz };
+ * tx_roles::in(*GPIOA, tx_hiz);  // one read-modify-write of GPIOA->CRH
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+template <typename ... _confs>
+struct config_set
+{
+  /** // doc: entry {{{
+   * Bits and masks of one configuration.
+   */ // }}}
+  struct entry
+  {
+    uint32_t bsrr;
+    uint32_t crl_bits;
+    uint32_t crl_mask;
+    uint32_t crh_bits;
+    uint32_t crh_mask;
+  };
+
+  /** // doc: size {{{
+   * Number of configurations.
+   * @hideinitializer
+   */ // }}}
+  constexpr static std::size_t size = sizeof...(_confs);
+
+  static_assert(size > 0u, "no configurations");
+
+  /** // doc: table {{{
+   * Bits and masks of the configurations, in the order of @c _confs.
+   * @hideinitializer
+   */ // }}}
+  constexpr static entry table[size] = {
+    { pull_bsrr_of<typename as_port_conf<_confs>::type>::value,
+      as_port_conf<_confs>::type::crl::bits, as_port_conf<_confs>::type::crl::mask,
+      as_port_conf<_confs>::type::crh::bits, as_port_conf<_confs>::type::crh::mask }...
+  };
+
+  /** // doc: in() {{{
+   * @brief Apply configuration number @c index to GPIO @c port.
+   *
+   * @param port the GPIO port to be configured, e.g. @c *GPIOB,
+   * @param index index of the configuration in @c _confs (less than
+   *        @ref size, asserted in debug builds).
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port, std::size_t index)
+  {
+    STM32XX_ASSERT(index < size);
+    const entry& e = table[index];
+    if(_bsrr_used)
+      bits::store(detail::bsrr(port), e.bsrr);
+    if(_crl_used)
+      bits::rt::modify(port.CRL, e.crl_bits, e.crl_mask);
+    if(_crh_used)
+      bits::rt::modify(port.CRH, e.crh_bits, e.crh_mask);
+  }
+
+  /* Masks and pulls of all the configurations. The masks are the same for
+   * all of them, a register with none of the pins is not accessed. A zero
+   * GPIOx_BSRR value is still stored if another configuration has a pull,
+   * which has no effect. */
+  constexpr static uint32_t _crl_masks[size] = {
+    as_port_conf<_confs>::type::crl::mask...
+  };
+  constexpr static uint32_t _crh_masks[size] = {
+    as_port_conf<_confs>::type::crh::mask...
+  };
+  constexpr static uint32_t _bsrrs[size] = {
+    pull_bsrr_of<typename as_port_conf<_confs>::type>::value...
+  };
+  static_assert(detail::all_equal(_crl_masks, 0u, size, _crl_masks[0])
+             && detail::all_equal(_crh_masks, 0u, size, _crh_masks[0]),
+                "configurations of different pins");
+  constexpr static bool _crl_used = _crl_masks[0] != 0ul;
+  constexpr static bool _crh_used = _crh_masks[0] != 0ul;
+  constexpr static bool _bsrr_used = bits::ct::mix_or(_bsrrs, 0u, size) != 0ul;
+};
+
+template <typename ... _confs>
+constexpr typename config_set<_confs...>::entry config_set<_confs...>::table[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_crl_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_crh_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_bsrrs[];
+
+#elif defined(STM32_FAMILY_STM32F4XX)
+
+/** // doc: gpio::ct::pin_conf {{{
+ * @brief Configuration for GPIO pins (STM32F4xx).
+ *
+ * This stuct provides convienient way to represent configuration of one or
+ * more GPIO pins. The parameters correspond to the fields of StdPeriph's
+ * @c GPIO_InitTypeDef, plus the alternate function number (@c _af) which
+ * StdPeriph sets separately with @c GPIO_PinAFConfig().
+ *
+ * As in @c GPIO_Init(), output type and speed apply only to
+ * @c GPIO_Mode_OUT and @c GPIO_Mode_AF (for other modes they must be left
+ * at their defaults), and @c _af applies only to @c GPIO_Mode_AF.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * using led = pin_conf<GPIO_Pin_0, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_25MHz>;
+ * using btn = pin_conf<GPIO_Pin_1, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP>;
+ * using tx  = pin_conf<GPIO_Pin_9, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz, GPIO_PuPd_NOPULL, GPIO_AF_USART1>;
+ * @endcode
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode,
+          GPIOOType_TypeDef _otype=GPIO_OType_PP,
+          GPIOSpeed_TypeDef _speed=GPIO_Speed_2MHz,
+          GPIOPuPd_TypeDef _pupd=GPIO_PuPd_NOPULL,
+          uint8_t _af=0>
+struct pin_conf
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  static_assert(IS_GPIO_OTYPE(_otype), "invalid output type specifier");
+  static_assert(IS_GPIO_SPEED(_speed), "invalid speed specifier");
+  static_assert(IS_GPIO_PUPD(_pupd), "invalid pull-up/pull-down specifier");
+  static_assert(IS_GPIO_AF(_af), "invalid alternate function specifier");
+  static_assert(detail::is_output(_mode) || (_otype == 0 && _speed == 0),
+                "output type and speed apply to output modes only");
+  static_assert(detail::is_af(_mode) || (_af == 0),
+                "alternate function applies to GPIO_Mode_AF only");
+  constexpr static pins_t pins = _pins;
+  constexpr static GPIOMode_TypeDef mode = _mode;
+  constexpr static GPIOOType_TypeDef otype = _otype;
+  constexpr static GPIOSpeed_TypeDef speed = _speed;
+  constexpr static GPIOPuPd_TypeDef pupd = _pupd;
+  constexpr static uint8_t af = _af;
+};
+
+/** // doc: gpio::ct::moder_bits {{{
+ * @brief Compute bits for GPIOx_MODER register.
+ *
+ * @see detail::moder_bits()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct moder_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  constexpr static uint32_t value = detail::moder_bits(_pins, _mode);
+};
+
+/** // doc: gpio::ct::moder_mask {{{
+ * @brief Compute mask for GPIOx_MODER register.
+ *
+ * @see detail::moder_mask()
+ */ // }}}
+template <pins_t _pins>
+struct moder_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  constexpr static uint32_t value = detail::moder_mask(_pins);
+};
+
+/** // doc: gpio::ct::moder_masked {{{
+ * @brief Bits and mask for GPIOx_MODER register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct moder_masked
+  : bits::ct::masked< moder_bits<_pins, _mode>::value,
+                      moder_mask<_pins>::value >
+{
+};
+
+/** // doc: gpio::ct::otyper_bits {{{
+ * @brief Compute bits for GPIOx_OTYPER register.
+ *
+ * @see detail::otyper_bits()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOOType_TypeDef _otype>
+struct otyper_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  static_assert(IS_GPIO_OTYPE(_otype), "invalid output type specifier");
+  constexpr static uint32_t value = detail::otyper_bits(_pins, _mode, _otype);
+};
+
+/** // doc: gpio::ct::otyper_mask {{{
+ * @brief Compute mask for GPIOx_OTYPER register.
+ *
+ * @see detail::otyper_mask()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct otyper_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  constexpr static uint32_t value = detail::otyper_mask(_pins, _mode);
+};
+
+/** // doc: gpio::ct::otyper_masked {{{
+ * @brief Bits and mask for GPIOx_OTYPER register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOOType_TypeDef _otype>
+struct otyper_masked
+  : bits::ct::masked< otyper_bits<_pins, _mode, _otype>::value,
+                      otyper_mask<_pins, _mode>::value >
+{
+};
+
+/** // doc: gpio::ct::ospeedr_bits {{{
+ * @brief Compute bits for GPIOx_OSPEEDR register.
+ *
+ * @see detail::ospeedr_bits()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOSpeed_TypeDef _speed>
+struct ospeedr_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  static_assert(IS_GPIO_SPEED(_speed), "invalid speed specifier");
+  constexpr static uint32_t value = detail::ospeedr_bits(_pins, _mode, _speed);
+};
+
+/** // doc: gpio::ct::ospeedr_mask {{{
+ * @brief Compute mask for GPIOx_OSPEEDR register.
+ *
+ * @see detail::ospeedr_mask()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct ospeedr_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  constexpr static uint32_t value = detail::ospeedr_mask(_pins, _mode);
+};
+
+/** // doc: gpio::ct::ospeedr_masked {{{
+ * @brief Bits and mask for GPIOx_OSPEEDR register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOSpeed_TypeDef _speed>
+struct ospeedr_masked
+  : bits::ct::masked< ospeedr_bits<_pins, _mode, _speed>::value,
+                      ospeedr_mask<_pins, _mode>::value >
+{
+};
+
+/** // doc: gpio::ct::pupdr_bits {{{
+ * @brief Compute bits for GPIOx_PUPDR register.
+ *
+ * @see detail::pupdr_bits()
+ */ // }}}
+template <pins_t _pins, GPIOPuPd_TypeDef _pupd>
+struct pupdr_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_PUPD(_pupd), "invalid pull-up/pull-down specifier");
+  constexpr static uint32_t value = detail::pupdr_bits(_pins, _pupd);
+};
+
+/** // doc: gpio::ct::pupdr_mask {{{
+ * @brief Compute mask for GPIOx_PUPDR register.
+ *
+ * @see detail::pupdr_mask()
+ */ // }}}
+template <pins_t _pins>
+struct pupdr_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  constexpr static uint32_t value = detail::pupdr_mask(_pins);
+};
+
+/** // doc: gpio::ct::pupdr_masked {{{
+ * @brief Bits and mask for GPIOx_PUPDR register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOPuPd_TypeDef _pupd>
+struct pupdr_masked
+  : bits::ct::masked< pupdr_bits<_pins, _pupd>::value,
+                      pupdr_mask<_pins>::value >
+{
+};
+
+/** // doc: gpio::ct::afrl_bits {{{
+ * @brief Compute bits for GPIOx_AFRL (<tt>AFR[0]</tt>) register.
+ *
+ * @see detail::afrl_bits()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, uint8_t _af>
+struct afrl_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  static_assert(IS_GPIO_AF(_af), "invalid alternate function specifier");
+  constexpr static uint32_t value = detail::afrl_bits(_pins, _mode, _af);
+};
+
+/** // doc: gpio::ct::afrl_mask {{{
+ * @brief Compute mask for GPIOx_AFRL (<tt>AFR[0]</tt>) register.
+ *
+ * @see detail::afrl_mask()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct afrl_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  constexpr static uint32_t value = detail::afrl_mask(_pins, _mode);
+};
+
+/** // doc: gpio::ct::afrl_masked {{{
+ * @brief Bits and mask for GPIOx_AFRL (<tt>AFR[0]</tt>) register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, uint8_t _af>
+struct afrl_masked
+  : bits::ct::masked< afrl_bits<_pins, _mode, _af>::value,
+                      afrl_mask<_pins, _mode>::value >
+{
+};
+
+/** // doc: gpio::ct::afrh_bits {{{
+ * @brief Compute bits for GPIOx_AFRH (<tt>AFR[1]</tt>) register.
+ *
+ * @see detail::afrh_bits()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, uint8_t _af>
+struct afrh_bits
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  static_assert(IS_GPIO_AF(_af), "invalid alternate function specifier");
+  constexpr static uint32_t value = detail::afrh_bits(_pins, _mode, _af);
+};
+
+/** // doc: gpio::ct::afrh_mask {{{
+ * @brief Compute mask for GPIOx_AFRH (<tt>AFR[1]</tt>) register.
+ *
+ * @see detail::afrh_mask()
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode>
+struct afrh_mask
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+  static_assert(IS_GPIO_MODE(_mode), "invalid mode specifier");
+  constexpr static uint32_t value = detail::afrh_mask(_pins, _mode);
+};
+
+/** // doc: gpio::ct::afrh_masked {{{
+ * @brief Bits and mask for GPIOx_AFRH (<tt>AFR[1]</tt>) register as bits::ct::masked.
+ */ // }}}
+template <pins_t _pins, GPIOMode_TypeDef _mode, uint8_t _af>
+struct afrh_masked
+  : bits::ct::masked< afrh_bits<_pins, _mode, _af>::value,
+                      afrh_mask<_pins, _mode>::value >
+{
+};
+
+/** // doc: gpio::ct::port_conf {{{
+ * @brief Configuration of several groups of pins on a single GPIO port
+ *        (STM32F4xx).
+ *
+ * This struct folds any number of @ref ct::pin_conf "pin_conf" entries into
+ * one bits::ct::masked value per GPIO configuration register (using
+ * bits::ct::mix). The whole port is then configured with at most one
+ * read-modify-write per register: GPIOx_MODER, GPIOx_OTYPER,
+ * GPIOx_OSPEEDR, GPIOx_PUPDR, GPIOx_AFRL and GPIOx_AFRH. A register which
+ * is not touched by any of the entries is not accessed at all (e.g.
+ * OTYPER and OSPEEDR when configuring inputs only, AFRL/AFRH when there
+ * are no alternate function pins), and a register whose all 32 bits are
+ * given is just stored.
+ *
+ * It is asserted at compile-time that no pin is configured twice.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * using leds = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_OUT>;
+ * using btns = pin_conf<GPIO_Pin_2, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP>;
+ * using usart = pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz, GPIO_PuPd_NOPULL, GPIO_AF_USART1>;
+ * port_conf<leds, btns, usart>::in(*GPIOA);
+ * @endcode
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+template <typename ... _confs>
+struct port_conf
+{
+  /** // doc: moder {{{
+   * Bits and mask for GPIOx_MODER register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< moder_masked<_confs::pins, _confs::mode>... > moder;
+  /** // doc: otyper {{{
+   * Bits and mask for GPIOx_OTYPER register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< otyper_masked<_confs::pins, _confs::mode,
+                                       _confs::otype>... > otyper;
+  /** // doc: ospeedr {{{
+   * Bits and mask for GPIOx_OSPEEDR register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< ospeedr_masked<_confs::pins, _confs::mode,
+                                        _confs::speed>... > ospeedr;
+  /** // doc: pupdr {{{
+   * Bits and mask for GPIOx_PUPDR register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< pupdr_masked<_confs::pins, _confs::pupd>... > pupdr;
+  /** // doc: afrl {{{
+   * Bits and mask for GPIOx_AFRL register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< afrl_masked<_confs::pins, _confs::mode,
+                                     _confs::af>... > afrl;
+  /** // doc: afrh {{{
+   * Bits and mask for GPIOx_AFRH register (bits::ct::mix).
+   */ // }}}
+  typedef bits::ct::mix< afrh_masked<_confs::pins, _confs::mode,
+                                     _confs::af>... > afrh;
+
+  /** // doc: in() {{{
+   * @brief Apply the configuration to GPIO @c port.
+   *
+   * @param port the GPIO port to be configured, e.g. @c *GPIOA.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    bits::ct::modify<moder>::in(port.MODER);
+    bits::ct::modify<otyper>::in(port.OTYPER);
+    bits::ct::modify<ospeedr>::in(port.OSPEEDR);
+    bits::ct::modify<pupdr>::in(port.PUPDR);
+    bits::ct::modify<afrl>::in(port.AFR[0]);
+    bits::ct::modify<afrh>::in(port.AFR[1]);
+  }
+
+  /** // doc: init_at() {{{
+   * @brief Apply the configuration to GPIO port at address @c _port just
+   *        after reset.
+   *
+   * Same as in(), but the configuration registers are assumed to hold
+   * their reset values, so each touched register is written with a single
+   * store computed at compile time and is not read (see
+   * bits::ct::from_reset). The reset values of GPIOA and GPIOB differ from
+   * the other ports (see detail::moder_reset()), hence the port is given
+   * by its address. In debug builds it is asserted that the registers were
+   * not modified since reset.
+   *
+   * @tparam _port base address of the port, e.g. @c GPIOA_BASE.
+   * @tparam _Access memory access policy, see bits::volatile_access.
+   */ // }}}
+  template <uint32_t _port, typename _Access = bits::volatile_access>
+  static void init_at()
+  {
+    bits::ct::from_reset<moder, detail::moder_reset(_port)>::template
+      at<_port + offsetof(GPIO_TypeDef, MODER), _Access>();
+    bits::ct::from_reset<otyper, 0ul>::template
+      at<_port + offsetof(GPIO_TypeDef, OTYPER), _Access>();
+    bits::ct::from_reset<ospeedr, detail::ospeedr_reset(_port)>::template
+      at<_port + offsetof(GPIO_TypeDef, OSPEEDR), _Access>();
+    bits::ct::from_reset<pupdr, detail::pupdr_reset(_port)>::template
+      at<_port + offsetof(GPIO_TypeDef, PUPDR), _Access>();
+    bits::ct::from_reset<afrl, 0ul>::template
+      at<_port + offsetof(GPIO_TypeDef, AFR), _Access>();
+    bits::ct::from_reset<afrh, 0ul>::template
+      at<_port + offsetof(GPIO_TypeDef, AFR) + 4u, _Access>();
+  }
+};
+
+/* port_conf of a pin_conf, or the port_conf itself */
+template <typename _Conf>
+struct as_port_conf
+{
+  typedef _Conf type;
+};
+
+template <pins_t _pins, GPIOMode_TypeDef _mode, GPIOOType_TypeDef _otype,
+          GPIOSpeed_TypeDef _speed, GPIOPuPd_TypeDef _pupd, uint8_t _af>
+struct as_port_conf< pin_conf<_pins, _mode, _otype, _speed, _pupd, _af> >
+{
+  typedef port_conf< pin_conf<_pins, _mode, _otype, _speed, _pupd, _af> > type;
+};
+
+/* Implementation of transition<> */
+template <typename _From, typename _To>
+struct transition_impl;
+
+template <typename ... _from, typename ... _to>
+struct transition_impl< port_conf<_from...>, port_conf<_to...> >
+{
+  typedef port_conf<_from...> from;
+  typedef port_conf<_to...> to;
+
+  /** // doc: moder {{{
+   * Bits of GPIOx_MODER which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::moder, typename to::moder> moder;
+  /** // doc: otyper {{{
+   * Bits of GPIOx_OTYPER which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::otyper, typename to::otyper> otyper;
+  /** // doc: ospeedr {{{
+   * Bits of GPIOx_OSPEEDR which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::ospeedr, typename to::ospeedr> ospeedr;
+  /** // doc: pupdr {{{
+   * Bits of GPIOx_PUPDR which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::pupdr, typename to::pupdr> pupdr;
+  /** // doc: afrl {{{
+   * Bits of GPIOx_AFRL which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::afrl, typename to::afrl> afrl;
+  /** // doc: afrh {{{
+   * Bits of GPIOx_AFRH which change (bits::ct::delta).
+   */ // }}}
+  typedef bits::ct::delta<typename from::afrh, typename to::afrh> afrh;
+
+  /** // doc: set {{{
+   * Pins set in GPIOx_ODR before the mode change (pulled-up inputs which
+   * become outputs).
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t set = detail::mode_pins<GPIO_Mode_OUT, _to...>::value
+                              & detail::input_pull_pins<GPIO_PuPd_UP, _from...>::value;
+  /** // doc: reset {{{
+   * Pins reset in GPIOx_ODR before the mode change (pulled-down inputs
+   * which become outputs).
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t reset = detail::mode_pins<GPIO_Mode_OUT, _to...>::value
+                                & detail::input_pull_pins<GPIO_PuPd_DOWN, _from...>::value;
+  /** // doc: bsrr {{{
+   * Value stored to GPIOx_BSRR, the mask is 0 if there is nothing to store.
+   */ // }}}
+  typedef bits::ct::masked< (uint32_t)set | ((uint32_t)reset << 16),
+                            ((set | reset) != 0) ? 0xFFFFFFFFul : 0ul > bsrr;
+
+  /** // doc: in() {{{
+   * @brief Reconfigure GPIO @c port from @c _From to @c _To.
+   *
+   * @param port the GPIO port, e.g. @c *GPIOA.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    bits::ct::modify<bsrr>::in(detail::bsrr(port));
+    bits::ct::modify<otyper>::in(port.OTYPER);
+    bits::ct::modify<ospeedr>::in(port.OSPEEDR);
+    bits::ct::modify<pupdr>::in(port.PUPDR);
+    bits::ct::modify<afrl>::in(port.AFR[0]);
+    bits::ct::modify<afrh>::in(port.AFR[1]);
+    bits::ct::modify<moder>::in(port.MODER);
+  }
+
+  /** // doc: at() {{{
+   * @brief Reconfigure GPIO port at address @c _port from @c _From to
+   *        @c _To.
+   *
+   * @tparam _port base address of the port, e.g. @c GPIOA_BASE.
+   * @tparam _Access memory access policy, see bits::volatile_access.
+   */ // }}}
+  template <uint32_t _port, typename _Access = bits::volatile_access>
+  static void at()
+  {
+    bits::ct::modify<bsrr>::template at<_port + detail::bsrr_offset, _Access>();
+    bits::ct::modify<otyper>::template at<_port + offsetof(GPIO_TypeDef, OTYPER), _Access>();
+    bits::ct::modify<ospeedr>::template at<_port + offsetof(GPIO_TypeDef, OSPEEDR), _Access>();
+    bits::ct::modify<pupdr>::template at<_port + offsetof(GPIO_TypeDef, PUPDR), _Access>();
+    bits::ct::modify<afrl>::template at<_port + offsetof(GPIO_TypeDef, AFR), _Access>();
+    bits::ct::modify<afrh>::template at<_port + offsetof(GPIO_TypeDef, AFR) + 4u, _Access>();
+    bits::ct::modify<moder>::template at<_port + offsetof(GPIO_TypeDef, MODER), _Access>();
+  }
+};
+
+/** // doc: gpio::ct::transition {{{
+ * @brief Reconfiguration of GPIO pins from a known configuration to
+ *        another one, writing only what changes (STM32F4xx).
+ *
+ * @c _From and @c _To are @ref ct::pin_conf "pin_conf" or
+ * @ref ct::port_conf "port_conf" types. @c _From is the configuration the
+ * port is known to be in, @c _To the new one. For each configuration
+ * register the bits which differ (or belong to pins not in @c _From) are
+ * computed at compile time (see bits::ct::delta), and only those are
+ * modified; a register without changes is not accessed at all. Pins of
+ * @c _From which are not in @c _To are left as they are.
+ *
+ * GPIOx_MODER is written last, so a pin gets its new output type, speed,
+ * pull and alternate function before it switches to the new mode. Inputs
+ * with a pull which become outputs have their GPIOx_ODR bits set to the
+ * level of the pull first (one store to GPIOx_BSRR), so the line does not
+ * glitch when the output driver is enabled.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // a shared line, input with pull-up, or open-drain output
+ * using listen = pin_conf<GPIO_Pin_3, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP>;
+ * using drive  = pin_conf<GPIO_Pin_3, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_2MHz, GPIO_PuPd_UP>;
+ * transition<listen, drive>::in(*GPIOB);  // BSRR, OTYPER, OSPEEDR, MODER
+ * transition<drive, listen>::in(*GPIOB);  // MODER only
+ * @endcode
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+template <typename _From, typename _To>
+struct transition
+  : transition_impl< typename as_port_conf<_From>::type,
+                     typename as_port_conf<_To>::type >
+{
+};
+
+/** // doc: gpio::ct::config_set {{{
+ * @brief Set of configurations of the same pins, one of them chosen at run
+ *        time (STM32F4xx).
+ *
+ * Each of @c _confs is a @ref ct::pin_conf "pin_conf" or
+ * @ref ct::port_conf "port_conf" type, all of them covering the same pins
+ * (checked at compile time). Their bits and masks for
+ * GPIOx_MODER, GPIOx_OTYPER, GPIOx_OSPEEDR, GPIOx_PUPDR, GPIOx_AFRL and
+ * GPIOx_AFRH are computed at compile time into @ref table, a constant
+ * array placed in read-only memory (flash), with 48 bytes per
+ * configuration. in() looks the configuration up by index and does one
+ * read-modify-write per register, in the order of port_conf::in(), without
+ * branches. A register with none of the pins is not accessed.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // USART2 TX on PA2, as USART, as GPIO or released
+ * typedef config_set< pin_conf<GPIO_Pin_2, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz, GPIO_PuPd_NOPULL, GPIO_AF_USART2>,
+ *                     pin_conf<GPIO_Pin_2, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz>,
+ *                     pin_conf<GPIO_Pin_2, GPIO_Mode_IN> > tx_roles;
+ * enum { tx_usart, tx_gpio, tx_hiz };
+ * tx_roles::in(*GPIOA, tx_hiz);
+ * @endcode
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+template <typename ... _confs>
+struct config_set
+{
+  /** // doc: entry {{{
+   * Bits and masks of one configuration.
+   */ // }}}
+  struct entry
+  {
+    uint32_t moder_bits;
+    uint32_t moder_mask;
+    uint32_t otyper_bits;
+    uint32_t otyper_mask;
+    uint32_t ospeedr_bits;
+    uint32_t ospeedr_mask;
+    uint32_t pupdr_bits;
+    uint32_t pupdr_mask;
+    uint32_t afrl_bits;
+    uint32_t afrl_mask;
+    uint32_t afrh_bits;
+    uint32_t afrh_mask;
+  };
+
+  /** // doc: size {{{
+   * Number of configurations.
+   * @hideinitializer
+   */ // }}}
+  constexpr static std::size_t size = sizeof...(_confs);
+
+  static_assert(size > 0u, "no configurations");
+
+  /** // doc: table {{{
+   * Bits and masks of the configurations, in the order of @c _confs.
+   * @hideinitializer
+   */ // }}}
+  constexpr static entry table[size] = {
+    { as_port_conf<_confs>::type::moder::bits, as_port_conf<_confs>::type::moder::mask,
+      as_port_conf<_confs>::type::otyper::bits, as_port_conf<_confs>::type::otyper::mask,
+      as_port_conf<_confs>::type::ospeedr::bits, as_port_conf<_confs>::type::ospeedr::mask,
+      as_port_conf<_confs>::type::pupdr::bits, as_port_conf<_confs>::type::pupdr::mask,
+      as_port_conf<_confs>::type::afrl::bits, as_port_conf<_confs>::type::afrl::mask,
+      as_port_conf<_confs>::type::afrh::bits, as_port_conf<_confs>::type::afrh::mask }...
+  };
+
+  /** // doc: in() {{{
+   * @brief Apply configuration number @c index to GPIO @c port.
+   *
+   * @param port the GPIO port to be configured, e.g. @c *GPIOA,
+   * @param index index of the configuration in @c _confs (less than
+   *        @ref size, asserted in debug builds).
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port, std::size_t index)
+  {
+    STM32XX_ASSERT(index < size);
+    const entry& e = table[index];
+    if(_moder_used)
+      bits::rt::modify(port.MODER, e.moder_bits, e.moder_mask);
+    if(_otyper_used)
+      bits::rt::modify(port.OTYPER, e.otyper_bits, e.otyper_mask);
+    if(_ospeedr_used)
+      bits::rt::modify(port.OSPEEDR, e.ospeedr_bits, e.ospeedr_mask);
+    if(_pupdr_used)
+      bits::rt::modify(port.PUPDR, e.pupdr_bits, e.pupdr_mask);
+    if(_afrl_used)
+      bits::rt::modify(port.AFR[0], e.afrl_bits, e.afrl_mask);
+    if(_afrh_used)
+      bits::rt::modify(port.AFR[1], e.afrh_bits, e.afrh_mask);
+  }
+
+  /* Masks of all the configurations, a register which none of them
+   * touches is not accessed. GPIOx_MODER and GPIOx_PUPDR cover all the
+   * pins, their masks are the same for all the configurations. */
+  constexpr static uint32_t _moder_masks[size] = {
+    as_port_conf<_confs>::type::moder::mask...
+  };
+  constexpr static uint32_t _otyper_masks[size] = {
+    as_port_conf<_confs>::type::otyper::mask...
+  };
+  constexpr static uint32_t _ospeedr_masks[size] = {
+    as_port_conf<_confs>::type::ospeedr::mask...
+  };
+  constexpr static uint32_t _pupdr_masks[size] = {
+    as_port_conf<_confs>::type::pupdr::mask...
+  };
+  constexpr static uint32_t _afrl_masks[size] = {
+    as_port_conf<_confs>::type::afrl::mask...
+  };
+  constexpr static uint32_t _afrh_masks[size] = {
+    as_port_conf<_confs>::type::afrh::mask...
+  };
+  static_assert(detail::all_equal(_moder_masks, 0u, size, _moder_masks[0])
+             && detail::all_equal(_pupdr_masks, 0u, size, _pupdr_masks[0]),
+                "configurations of different pins");
+  constexpr static bool _moder_used = bits::ct::mix_or(_moder_masks, 0u, size) != 0ul;
+  constexpr static bool _otyper_used = bits::ct::mix_or(_otyper_masks, 0u, size) != 0ul;
+  constexpr static bool _ospeedr_used = bits::ct::mix_or(_ospeedr_masks, 0u, size) != 0ul;
+  constexpr static bool _pupdr_used = bits::ct::mix_or(_pupdr_masks, 0u, size) != 0ul;
+  constexpr static bool _afrl_used = bits::ct::mix_or(_afrl_masks, 0u, size) != 0ul;
+  constexpr static bool _afrh_used = bits::ct::mix_or(_afrh_masks, 0u, size) != 0ul;
+};
+
+template <typename ... _confs>
+constexpr typename config_set<_confs...>::entry config_set<_confs...>::table[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_moder_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_otyper_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_ospeedr_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_pupdr_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_afrl_masks[];
+template <typename ... _confs>
+constexpr uint32_t config_set<_confs...>::_afrh_masks[];
+
+#endif /* STM32_FAMILY_STM32F4XX */
+
+/** // doc: gpio::ct::bsrr_masked {{{
+ * @brief Value for GPIOx_BSRR register as bits::ct::masked.
+ *
+ * Pins in @c _set are set, pins in @c _reset are reset and all other pins are
+ * left untouched by a single write of @c bits to GPIOx_BSRR. The mask covers
+ * the whole register, as BSRR is write-only (there is nothing to preserve).
+ *
+ * It is asserted at compile-time that @c _set and @c _reset do not overlap.
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+template <pins_t _set, pins_t _reset=0>
+struct bsrr_masked
+  : bits::ct::masked< (uint32_t)_set | ((uint32_t)_reset << 16),
+                      0xFFFFFFFFul >
+{
+  static_assert(IS_GPIO_PIN(_set|_reset), "invalid pin specifier");
+  static_assert((_set & _reset) == 0, "pins to set and reset overlap");
+};
+
+/** // doc: gpio::ct::write {{{
+ * @brief Set and reset GPIO output pins with a single store.
+ *
+ * This writes @ref ct::bsrr_masked "bsrr_masked<_set,_reset>" to GPIOx_BSRR.
+ * It compiles to exactly one 32-bit store, there is no read of GPIOx_ODR, so
+ * the operation is atomic and safe to use from ISRs without masking
+ * interrupts.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * write<GPIO_Pin_0, GPIO_Pin_1|GPIO_Pin_2>::in(*GPIOB);
+ * @endcode
+ */ // }}}
+template <pins_t _set, pins_t _reset=0>
+struct write
+{
+  /** // doc: value {{{
+   * Value written to GPIOx_BSRR.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t value = bsrr_masked<_set,_reset>::bits;
+
+  /** // doc: in() {{{
+   * @brief Perform the write on GPIO @c port.
+   *
+   * @param port the GPIO port, e.g. @c *GPIOB.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    bits::store(detail::bsrr(port), value);
+  }
+};
+
+/** // doc: gpio::ct::set {{{
+ * @brief Set GPIO output pins with a single store to GPIOx_BSRR.
+ *
+ * <b>Example</b>:
+ * @code
+ * set<GPIO_Pin_0|GPIO_Pin_1>::in(*GPIOB);
+ * @endcode
+ */ // }}}
+template <pins_t _pins>
+struct set
+  : write<_pins, 0>
+{
+};
+
+/** // doc: gpio::ct::reset {{{
+ * @brief Reset GPIO output pins with a single store to GPIOx_BSRR.
+ *
+ * <b>Example</b>:
+ * @code
+ * reset<GPIO_Pin_0|GPIO_Pin_1>::in(*GPIOB);
+ * @endcode
+ */ // }}}
+template <pins_t _pins>
+struct reset
+  : write<0, _pins>
+{
+};
+
+/** // doc: gpio::ct::toggle {{{
+ * @brief Toggle GPIO output pins.
+ *
+ * The current output state is read from GPIOx_ODR and the new state is
+ * written with a single store to GPIOx_BSRR. Pins other than @c _pins are
+ * never written, but the toggle itself is not atomic with respect to other
+ * code writing the same @c _pins.
+ *
+ * <b>Example</b>:
+ * @code
+ * toggle<GPIO_Pin_0>::in(*GPIOB);
+ * @endcode
+ */ // }}}
+template <pins_t _pins>
+struct toggle
+{
+  static_assert(IS_GPIO_PIN(_pins), "invalid pin specifier");
+
+  /** // doc: in() {{{
+   * @brief Toggle @c _pins on GPIO @c port.
+   *
+   * @param port the GPIO port, e.g. @c *GPIOB.
+   */ // }}}
+  template <typename _Port>
+  static void in(_Port& port)
+  {
+    const uint32_t odr = bits::load(port.ODR);
+    bits::store(detail::bsrr(port), (~odr & _pins) | ((odr & _pins) << 16));
+  }
+};
+
+} /* namespace ct */
+} /* namespace gpio */
+} /* namesapce stm32xx */
+
+/* GPIO operations with runtime arguments */
+namespace stm32xx {
+namespace gpio {
+/** // doc: namespace rt {{{
+ * Runtime machinery supporting configuration of STM32 GPIOs
+ */ // }}}
+namespace rt {
+
+#if defined(STM32_FAMILY_STM32F10X)
+
+/** // doc: gpio::rt::configure() {{{
+ * @brief Configure GPIO pins with arguments known at runtime.
+ *
+ * This is a runtime replacement for StdPeriph's @c GPIO_Init(). The register
+ * bits and masks are computed by the same branch-free functions which are
+ * used by gpio::ct (@ref detail::crl_bits() "crl_bits()",
+ * @ref detail::crl_mask() "crl_mask()" and their CRH counterparts), so both
+ * APIs always agree. The configuration costs at most one read-modify-write
+ * on GPIOx_CRL and one on GPIOx_CRH, with no per-pin loop. A register with
+ * none of @c pins is not accessed. As in @c GPIO_Init(), pins configured as
+ * @c GPIO_Mode_IPU or @c GPIO_Mode_IPD then get their pull in GPIOx_ODR,
+ * with one more store to GPIOx_BSRR (see
+ * @ref detail::pull_bsrr() "pull_bsrr()").
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio;
+ * rt::configure(GPIOB, pins, GPIO_Mode_Out_PP, GPIO_Speed_10MHz);
+ * @endcode
+ *
+ * @param port GPIO port to be configured, e.g. @c GPIOB,
+ * @param pins pins to be configured,
+ * @param mode GPIO mode for the pins,
+ * @param speed speed for the pins (ignored for input modes).
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for register definitions.
+ */ // }}}
+template <typename _Port>
+inline void
+configure(_Port* port, pins_t pins, GPIOMode_TypeDef mode,
+          GPIOSpeed_TypeDef speed=(GPIOSpeed_TypeDef)0)
+{
+  if(detail::crl_mask(pins))
+    bits::rt::modify(port->CRL, detail::crl_bits(pins, mode, speed),
+                     detail::crl_mask(pins));
+  if(detail::crh_mask(pins))
+    bits::rt::modify(port->CRH, detail::crh_bits(pins, mode, speed),
+                     detail::crh_mask(pins));
+  const uint32_t pull = detail::pull_bsrr(pins, mode);
+  if(pull)
+    bits::store(detail::bsrr(*port), pull);
+}
+
+#elif defined(STM32_FAMILY_STM32F4XX)
+
+/** // doc: gpio::rt::configure() {{{
+ * @brief Configure GPIO pins with arguments known at runtime (STM32F4xx).
+ *
+ * This is a runtime replacement for StdPeriph's @c GPIO_Init() followed by
+ * @c GPIO_PinAFConfig() for each of @c pins. The register bits and masks are
+ * computed by the same branch-free functions which are used by gpio::ct
+ * (see @ref detail::moder_bits() "moder_bits()" and the others), so both
+ * APIs always agree. The configuration costs at most one read-modify-write
+ * per register, with no per-pin loop. Registers not affected by @c mode
+ * (OTYPER and OSPEEDR for input and analog modes, AFRL and AFRH for modes
+ * other than @c GPIO_Mode_AF) are not accessed.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio;
+ * rt::configure(GPIOA, pins, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz,
+ *               GPIO_PuPd_NOPULL, GPIO_AF_USART1);
+ * @endcode
+ *
+ * @param port GPIO port to be configured, e.g. @c GPIOA,
+ * @param pins pins to be configured,
+ * @param mode GPIO mode for the pins,
+ * @param otype output type (used only for output modes),
+ * @param speed speed for the pins (used only for output modes),
+ * @param pupd pull-up/pull-down configuration,
+ * @param af alternate function (used only for @c GPIO_Mode_AF).
+ *
+ * @see ST RM0090 Reference manual (STM32F4xx) for register definitions.
+ */ // }}}
+template <typename _Port>
+inline void
+configure(_Port* port, pins_t pins, GPIOMode_TypeDef mode,
+          GPIOOType_TypeDef otype=GPIO_OType_PP,
+          GPIOSpeed_TypeDef speed=GPIO_Speed_2MHz,
+          GPIOPuPd_TypeDef pupd=GPIO_PuPd_NOPULL,
+          uint8_t af=0)
+{
+  bits::rt::modify(port->MODER, detail::moder_bits(pins, mode),
+                   detail::moder_mask(pins));
+  if(detail::is_output(mode))
+    {
+      bits::rt::modify(port->OTYPER, detail::otyper_bits(pins, mode, otype),
+                       detail::otyper_mask(pins, mode));
+      bits::rt::modify(port->OSPEEDR, detail::ospeedr_bits(pins, mode, speed),
+                       detail::ospeedr_mask(pins, mode));
+    }
+  bits::rt::modify(port->PUPDR, detail::pupdr_bits(pins, pupd),
+                   detail::pupdr_mask(pins));
+  if(detail::is_af(mode) && (pins & 0x00FFu))
+    bits::rt::modify(port->AFR[0], detail::afrl_bits(pins, mode, af),
+                     detail::afrl_mask(pins, mode));
+  if(detail::is_af(mode) && (pins & 0xFF00u))
+    bits::rt::modify(port->AFR[1], detail::afrh_bits(pins, mode, af),
+                     detail::afrh_mask(pins, mode));
+}
+
+#endif /* STM32_FAMILY_STM32F4XX */
+
+/** // doc: gpio::rt::write() {{{
+ * @brief Set and reset GPIO output pins with a single store.
+ *
+ * Runtime counterpart of @ref ct::write "ct::write". Pins in @c set_pins
+ * are set, pins in @c reset_pins are reset (if a pin is in both, it gets
+ * set). This compiles to one 32-bit store to GPIOx_BSRR and is safe to use
+ * from ISRs.
+ *
+ * @param port the GPIO port, e.g. @c GPIOB,
+ * @param set_pins pins to be set,
+ * @param reset_pins pins to be reset.
+ */ // }}}
+template <typename _Port>
+inline void
+write(_Port* port, pins_t set_pins, pins_t reset_pins)
+{
+  bits::store(detail::bsrr(*port), (uint32_t)set_pins | ((uint32_t)reset_pins << 16));
+}
+
+/** // doc: gpio::rt::set() {{{
+ * @brief Set GPIO output pins with a single store to GPIOx_BSRR.
+ */ // }}}
+template <typename _Port>
+inline void
+set(_Port* port, pins_t pins)
+{
+  bits::store(detail::bsrr(*port), (uint32_t)pins);
+}
+
+/** // doc: gpio::rt::reset() {{{
+ * @brief Reset GPIO output pins with a single store to GPIOx_BSRR.
+ */ // }}}
+template <typename _Port>
+inline void
+reset(_Port* port, pins_t pins)
+{
+  bits::store(detail::bsrr(*port), (uint32_t)pins << 16);
+}
+
+/** // doc: gpio::rt::toggle() {{{
+ * @brief Toggle GPIO output pins.
+ *
+ * Runtime counterpart of @ref ct::toggle "ct::toggle": one read of
+ * GPIOx_ODR and one store to GPIOx_BSRR.
+ */ // }}}
+template <typename _Port>
+inline void
+toggle(_Port* port, pins_t pins)
+{
+  const uint32_t odr = bits::load(port->ODR);
+  bits::store(detail::bsrr(*port), (~odr & pins) | ((odr & pins) << 16));
+}
+
+} /* namespace rt */
 } /* namespace gpio */
 } /* namesapce stm32xx */
 
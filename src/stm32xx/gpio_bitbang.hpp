@@ -0,0 +1,557 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/gpio_bitbang.hpp {{{
+ * \file stm32xx/gpio_bitbang.hpp
+ * @brief Bit-banged SPI, I2C and UART (transmitter) on GPIO pins.
+ *
+ * Each clock edge is a single GPIOx_BSRR store computed at compile time
+ * (only the data bit is selected at run time, without a branch), and each
+ * sample is a single GPIOx_IDR load. The loops over the bits of a byte are
+ * unrolled at compile time.
+ *
+ * The bit rate is set by a delay policy, a type with
+ * <tt>static uint32_t start()</tt> returning a time stamp and
+ * <tt>static void wait(uint32_t& stamp)</tt> waiting for the next tick
+ * (half a clock period for SPI and I2C, a bit period for UART) since
+ * @c stamp and updating it. bitbang::no_delay runs at full speed,
+ * bitbang::cycle_delay counts CPU cycles.
+ *
+ * <b>Example</b> (STM32F10x, 1 MHz SPI mode 0 at 72 MHz):
+ * @code
+ * using namespace stm32xx::gpio;
+ * typedef ct::pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> sck;
+ * typedef ct::pin_conf<GPIO_Pin_14, GPIO_Mode_IN_FLOATING> miso;
+ * typedef ct::pin_conf<GPIO_Pin_15, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> mosi;
+ * typedef bitbang::spi<GPIOB_BASE, sck, mosi, miso, 0, 0,
+ *                      bitbang::cycle_delay<36> > flash_spi;
+ *
+ * bitbang::dwt_clock::enable();
+ * ct::port_conf<sck, miso, mosi>::in(*GPIOB);
+ * flash_spi::init();
+ * const uint8_t id = flash_spi::transfer(0x9F);
+ * @endcode
+ */ // }}}
+#ifndef STM32XX_GPIO_BITBANG_HPP_INCLUDED
+#define STM32XX_GPIO_BITBANG_HPP_INCLUDED
+
+#include <stm32xx/gpio_bus.hpp>
+#include <stm32xx/prof.hpp>
+
+namespace stm32xx {
+namespace gpio {
+/** // doc: namespace bitbang {{{
+ * @brief Serial protocols bit-banged on GPIO pins.
+ */ // }}}
+namespace bitbang {
+namespace detail {
+
+/* True if pins is a single pin */
+constexpr bool
+is_single_pin(uint32_t pins)
+{
+  return (pins != 0ul) && ((pins & (pins - 1ul)) == 0ul);
+}
+
+/* Number (0..15) of the single pin in pins */
+constexpr int
+pin_number(uint32_t pins)
+{
+  return (pins <= 1ul) ? 0 : 1 + pin_number(pins >> 1);
+}
+
+/* GPIOx_BSRR value driving pin high if bit 0 of b is set, low otherwise
+ * (branch-free) */
+constexpr uint32_t
+drive(uint32_t pin, uint32_t b)
+{
+  return pin << ((~b & 1ul) << 4);
+}
+
+#if defined(STM32_FAMILY_STM32F10X)
+/* _Conf configures a general purpose (not alternate function) output */
+template <typename _Conf>
+constexpr bool
+is_gpio_output()
+{
+  return (_Conf::mode & 0x18) == 0x10;
+}
+
+/* _Conf configures an open-drain general purpose output */
+template <typename _Conf>
+constexpr bool
+is_open_drain()
+{
+  return _Conf::mode == GPIO_Mode_Out_OD;
+}
+
+/* _Conf configures an input */
+template <typename _Conf>
+constexpr bool
+is_input()
+{
+  return (_Conf::mode & 0x10) == 0;
+}
+#elif defined(STM32_FAMILY_STM32F4XX)
+/* _Conf configures a general purpose (not alternate function) output */
+template <typename _Conf>
+constexpr bool
+is_gpio_output()
+{
+  return _Conf::mode == GPIO_Mode_OUT;
+}
+
+/* _Conf configures an open-drain general purpose output */
+template <typename _Conf>
+constexpr bool
+is_open_drain()
+{
+  return (_Conf::mode == GPIO_Mode_OUT) && (_Conf::otype == GPIO_OType_OD);
+}
+
+/* _Conf configures an input */
+template <typename _Conf>
+constexpr bool
+is_input()
+{
+  return _Conf::mode == GPIO_Mode_IN;
+}
+#endif /* STM32_FAMILY_STM32F4XX */
+
+/* Calls _Engine::bit<_i>(args...) for _i = _first, ..., _end - 1; the
+ * calls are inlined one after another, there is no loop at run time */
+template <typename _Engine, unsigned _first, unsigned _end>
+struct unroll
+{
+  template <typename... _Args>
+  static void apply(_Args&... args)
+  {
+    _Engine::template bit<_first>(args...);
+    unroll<_Engine, _first + 1u, _end>::apply(args...);
+  }
+};
+
+template <typename _Engine, unsigned _end>
+struct unroll<_Engine, _end, _end>
+{
+  template <typename... _Args>
+  static void apply(_Args&...)
+  {
+  }
+};
+
+} /* namespace detail */
+
+/** // doc: gpio::bitbang::no_delay {{{
+ * @brief Delay policy without delays (the fastest bit rate).
+ */ // }}}
+struct no_delay
+{
+  static uint32_t start()
+  {
+    return 0ul;
+  }
+  static void wait(uint32_t&)
+  {
+  }
+};
+
+/** // doc: gpio::bitbang::dwt_clock {{{
+ * @brief Clock policy reading the DWT cycle counter (see prof::dwt_clock).
+ */ // }}}
+typedef prof::dwt_clock dwt_clock;
+
+/** // doc: gpio::bitbang::cycle_delay {{{
+ * @brief Delay policy ticking every @c _cycles of @c _Clock.
+ *
+ * Each wait() returns at least @c _cycles after the previous one, counting
+ * the code executed in between, so the bit rate does not depend on the
+ * speed of that code (as long as it is shorter than @c _cycles). For a SPI
+ * or I2C clock of frequency @c f use <tt>_cycles = f_cpu / (2 * f)</tt>.
+ * The counter may wrap around.
+ */ // }}}
+template <uint32_t _cycles, typename _Clock = dwt_clock>
+struct cycle_delay
+{
+  static uint32_t start()
+  {
+    return _Clock::now();
+  }
+  static void wait(uint32_t& stamp)
+  {
+    uint32_t now;
+    while(((now = _Clock::now()) - stamp) < _cycles)
+      ;
+    stamp = now;
+  }
+};
+
+/** // doc: gpio::bitbang::spi {{{
+ * @brief SPI master on pins @c _Sck, @c _Mosi and @c _Miso of GPIO port
+ *        @c _port (e.g. @c GPIOB_BASE).
+ *
+ * The pins are given as @ref ct::pin_conf "pin_conf" types of single pins;
+ * SCK and MOSI must be general purpose outputs and MISO an input. Clock
+ * polarity @c _cpol and phase @c _cpha are as in the SPI modes 0 to 3.
+ * Data are transferred most significant bit first. Chip select is left to
+ * the caller.
+ *
+ * Each edge of SCK is one GPIOx_BSRR store, which also sets MOSI when the
+ * edge shifts data out, and each bit is sampled with one GPIOx_IDR load.
+ */ // }}}
+template <uint32_t _port, typename _Sck, typename _Mosi, typename _Miso,
+          unsigned _cpol = 0u, unsigned _cpha = 0u,
+          typename _Delay = no_delay,
+          typename _Access = bits::volatile_access>
+struct spi
+{
+  static_assert(detail::is_single_pin(_Sck::pins), "SCK must be a single pin");
+  static_assert(detail::is_single_pin(_Mosi::pins), "MOSI must be a single pin");
+  static_assert(detail::is_single_pin(_Miso::pins), "MISO must be a single pin");
+  static_assert((_Sck::pins & _Mosi::pins) == 0 && (_Sck::pins & _Miso::pins) == 0 &&
+                (_Mosi::pins & _Miso::pins) == 0, "SPI pins must be distinct");
+  static_assert(detail::is_gpio_output<_Sck>(), "SCK must be a GPIO output");
+  static_assert(detail::is_gpio_output<_Mosi>(), "MOSI must be a GPIO output");
+  static_assert(detail::is_input<_Miso>(), "MISO must be an input");
+  static_assert(_cpol <= 1u && _cpha <= 1u, "invalid SPI mode");
+
+  /** // doc: idle {{{
+   * GPIOx_BSRR value driving SCK to its idle level (@c _cpol).
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t idle = detail::drive(_Sck::pins, _cpol);
+  /** // doc: active {{{
+   * GPIOx_BSRR value driving SCK to its active level.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t active = detail::drive(_Sck::pins, _cpol ^ 1u);
+
+  /** // doc: init() {{{
+   * @brief Drive SCK to its idle level.
+   */ // }}}
+  static void init()
+  {
+    gpio::detail::store_at<_Access>(_port + gpio::detail::bsrr_offset, idle);
+  }
+
+  /** // doc: transfer() {{{
+   * @brief Send byte @c out and return the byte received meanwhile.
+   *
+   * SCK must be at its idle level (see init()); it is left there.
+   */ // }}}
+  static uint8_t transfer(uint8_t out)
+  {
+    uint32_t in = 0ul;
+    uint32_t stamp = _Delay::start();
+    const uint32_t o = out;
+    detail::unroll<spi, 0u, 8u>::apply(o, in, stamp);
+    return (uint8_t)in;
+  }
+
+  /** // doc: transfer() {{{
+   * @brief Send @c size bytes from @c out and store the bytes received to
+   *        @c in.
+   */ // }}}
+  static void transfer(const uint8_t* out, uint8_t* in, std::size_t size)
+  {
+    for(std::size_t i = 0u; i < size; ++i)
+      in[i] = transfer(out[i]);
+  }
+
+  /** // doc: write() {{{
+   * @brief Send @c size bytes from @c out, ignoring MISO.
+   */ // }}}
+  static void write(const uint8_t* out, std::size_t size)
+  {
+    for(std::size_t i = 0u; i < size; ++i)
+      transfer(out[i]);
+  }
+
+private:
+  template <typename, unsigned, unsigned> friend struct detail::unroll;
+
+  constexpr static uint32_t bsrr = _port + gpio::detail::bsrr_offset;
+  constexpr static uint32_t idr = _port + gpio::detail::idr_offset;
+
+  /* Bit _i of the transfer (bit 7 - _i of the bytes) */
+  template <unsigned _i>
+  static void bit(const uint32_t& out, uint32_t& in, uint32_t& stamp)
+  {
+    constexpr int b = 7 - (int)_i;
+    constexpr int m = detail::pin_number(_Miso::pins);
+    const uint32_t mosi = detail::drive(_Mosi::pins, out >> b);
+    if(_cpha == 0u)
+      {
+        /* data out before the leading edge, sampled on the leading edge,
+         * next data out on the trailing edge */
+        if(_i == 0u)
+          {
+            gpio::detail::store_at<_Access>(bsrr, idle | mosi);
+            _Delay::wait(stamp);
+          }
+        gpio::detail::store_at<_Access>(bsrr, active);
+        in |= gpio::detail::shift_left(gpio::detail::load_at<_Access>(idr) & _Miso::pins, b - m);
+        _Delay::wait(stamp);
+        const uint32_t next = (b > 0) ? detail::drive(_Mosi::pins, out >> (b > 0 ? b - 1 : 0)) : 0ul;
+        gpio::detail::store_at<_Access>(bsrr, idle | next);
+        _Delay::wait(stamp);
+      }
+    else
+      {
+        /* data out on the leading edge, sampled on the trailing edge */
+        gpio::detail::store_at<_Access>(bsrr, active | mosi);
+        _Delay::wait(stamp);
+        gpio::detail::store_at<_Access>(bsrr, idle);
+        in |= gpio::detail::shift_left(gpio::detail::load_at<_Access>(idr) & _Miso::pins, b - m);
+        _Delay::wait(stamp);
+      }
+  }
+};
+
+/** // doc: gpio::bitbang::i2c {{{
+ * @brief I2C master on pins @c _Scl and @c _Sda of GPIO port @c _port.
+ *
+ * The pins are given as @ref ct::pin_conf "pin_conf" types of single
+ * open-drain outputs (their input data register still reflects the line
+ * level). Driving a pin high releases the line. Each SCL edge and each
+ * SDA change is one GPIOx_BSRR store.
+ *
+ * After SCL is released, GPIOx_IDR is loaded until SCL reads high, which
+ * supports clock stretching by the slaves; the same load samples SDA. There
+ * is no timeout, a slave holding SCL low blocks the master.
+ *
+ * The bytes and the acknowledge bit are transferred with the same unrolled
+ * 9-bit sequence: a byte read sends 1s (SDA released), a byte write ignores
+ * what it samples.
+ */ // }}}
+template <uint32_t _port, typename _Scl, typename _Sda,
+          typename _Delay = no_delay,
+          typename _Access = bits::volatile_access>
+struct i2c
+{
+  static_assert(detail::is_single_pin(_Scl::pins), "SCL must be a single pin");
+  static_assert(detail::is_single_pin(_Sda::pins), "SDA must be a single pin");
+  static_assert((_Scl::pins & _Sda::pins) == 0, "I2C pins must be distinct");
+  static_assert(detail::is_open_drain<_Scl>(), "SCL must be an open-drain output");
+  static_assert(detail::is_open_drain<_Sda>(), "SDA must be an open-drain output");
+
+  /** // doc: init() {{{
+   * @brief Release SCL and SDA (bus idle).
+   */ // }}}
+  static void init()
+  {
+    store(_Scl::pins | _Sda::pins);
+  }
+
+  /** // doc: start() {{{
+   * @brief Send a START condition, or a repeated START after a byte.
+   */ // }}}
+  static void start()
+  {
+    uint32_t stamp = _Delay::start();
+    store(_Sda::pins);
+    _Delay::wait(stamp);
+    store(_Scl::pins);
+    wait_scl(stamp);
+    _Delay::wait(stamp);
+    store(_Sda::pins << 16);
+    _Delay::wait(stamp);
+    store(_Scl::pins << 16);
+  }
+
+  /** // doc: stop() {{{
+   * @brief Send a STOP condition.
+   */ // }}}
+  static void stop()
+  {
+    uint32_t stamp = _Delay::start();
+    store(_Sda::pins << 16);
+    _Delay::wait(stamp);
+    store(_Scl::pins);
+    wait_scl(stamp);
+    _Delay::wait(stamp);
+    store(_Sda::pins);
+    _Delay::wait(stamp);
+  }
+
+  /** // doc: write() {{{
+   * @brief Send @c byte.
+   *
+   * @return @c true if the slave acknowledged it.
+   */ // }}}
+  static bool write(uint8_t byte)
+  {
+    return (transfer9(((uint32_t)byte << 1) | 0x01ul) & 0x01ul) == 0ul;
+  }
+
+  /** // doc: read() {{{
+   * @brief Receive a byte and acknowledge it if @c ack is @c true (all but
+   *        the last byte of a read).
+   */ // }}}
+  static uint8_t read(bool ack)
+  {
+    return (uint8_t)(transfer9(0x1FEul | (ack ? 0ul : 1ul)) >> 1);
+  }
+
+  /** // doc: write() {{{
+   * @brief Write @c size bytes from @c data to slave @c address (7-bit),
+   *        from START to STOP.
+   *
+   * @return @c false if the address or a byte was not acknowledged.
+   */ // }}}
+  static bool write(uint8_t address, const uint8_t* data, std::size_t size)
+  {
+    start();
+    bool ok = write((uint8_t)(address << 1));
+    for(std::size_t i = 0u; ok && i < size; ++i)
+      ok = write(data[i]);
+    stop();
+    return ok;
+  }
+
+  /** // doc: read() {{{
+   * @brief Read @c size bytes from slave @c address (7-bit) to @c data,
+   *        from START to STOP.
+   *
+   * @return @c false if the address was not acknowledged.
+   */ // }}}
+  static bool read(uint8_t address, uint8_t* data, std::size_t size)
+  {
+    start();
+    const bool ok = write((uint8_t)((address << 1) | 0x01u));
+    for(std::size_t i = 0u; ok && i < size; ++i)
+      data[i] = read(i + 1u < size);
+    stop();
+    return ok;
+  }
+
+private:
+  template <typename, unsigned, unsigned> friend struct detail::unroll;
+
+  constexpr static uint32_t bsrr = _port + gpio::detail::bsrr_offset;
+  constexpr static uint32_t idr = _port + gpio::detail::idr_offset;
+
+  static void store(uint32_t value)
+  {
+    gpio::detail::store_at<_Access>(bsrr, value);
+  }
+
+  /* Load GPIOx_IDR until SCL is high (clock stretching); the SCL high
+   * time is counted from there */
+  static uint32_t wait_scl(uint32_t& stamp)
+  {
+    uint32_t x;
+    while(((x = gpio::detail::load_at<_Access>(idr)) & _Scl::pins) == 0ul)
+      ;
+    stamp = _Delay::start();
+    return x;
+  }
+
+  /* Send 9 bits of out, most significant first, and return the bits
+   * sampled on SDA; SCL is low on entry and on exit */
+  static uint32_t transfer9(uint32_t out)
+  {
+    uint32_t in = 0ul;
+    uint32_t stamp = _Delay::start();
+    detail::unroll<i2c, 0u, 9u>::apply(out, in, stamp);
+    return in;
+  }
+
+  /* Bit _i of transfer9() (bit 8 - _i of the words) */
+  template <unsigned _i>
+  static void bit(const uint32_t& out, uint32_t& in, uint32_t& stamp)
+  {
+    constexpr int b = 8 - (int)_i;
+    constexpr int d = detail::pin_number(_Sda::pins);
+    store(detail::drive(_Sda::pins, out >> b));
+    _Delay::wait(stamp);
+    store(_Scl::pins);
+    in |= gpio::detail::shift_left(wait_scl(stamp) & _Sda::pins, b - d);
+    _Delay::wait(stamp);
+    store(_Scl::pins << 16);
+  }
+};
+
+/** // doc: gpio::bitbang::uart_tx {{{
+ * @brief UART transmitter (8N1) on pin @c _Tx of GPIO port @c _port.
+ *
+ * @c _Tx is a @ref ct::pin_conf "pin_conf" of a single general purpose
+ * output. The delay policy ticks once per bit, e.g.
+ * <tt>cycle_delay<f_cpu / baud_rate></tt>. Each bit is one GPIOx_BSRR
+ * store.
+ */ // }}}
+template <uint32_t _port, typename _Tx, typename _Delay,
+          typename _Access = bits::volatile_access>
+struct uart_tx
+{
+  static_assert(detail::is_single_pin(_Tx::pins), "TX must be a single pin");
+  static_assert(detail::is_gpio_output<_Tx>(), "TX must be a GPIO output");
+
+  /** // doc: init() {{{
+   * @brief Drive TX high (line idle).
+   */ // }}}
+  static void init()
+  {
+    gpio::detail::store_at<_Access>(bsrr, _Tx::pins);
+  }
+
+  /** // doc: write() {{{
+   * @brief Send @c byte: start bit, 8 data bits (least significant first)
+   *        and stop bit.
+   */ // }}}
+  static void write(uint8_t byte)
+  {
+    uint32_t stamp = _Delay::start();
+    const uint32_t frame = ((uint32_t)byte << 1) | 0x200ul;
+    detail::unroll<uart_tx, 0u, 10u>::apply(frame, stamp);
+  }
+
+  /** // doc: write() {{{
+   * @brief Send @c size bytes from @c data.
+   */ // }}}
+  static void write(const uint8_t* data, std::size_t size)
+  {
+    for(std::size_t i = 0u; i < size; ++i)
+      write(data[i]);
+  }
+
+private:
+  template <typename, unsigned, unsigned> friend struct detail::unroll;
+
+  constexpr static uint32_t bsrr = _port + gpio::detail::bsrr_offset;
+
+  /* Bit _i of the frame */
+  template <unsigned _i>
+  static void bit(const uint32_t& frame, uint32_t& stamp)
+  {
+    gpio::detail::store_at<_Access>(bsrr, detail::drive(_Tx::pins, frame >> _i));
+    _Delay::wait(stamp);
+  }
+};
+
+} /* namespace bitbang */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_BITBANG_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/gpio_board.hpp {{{
+ * \file stm32xx/gpio_board.hpp
+ * @brief Compile-time map of all the GPIO pins used by a board.
+ */ // }}}
+#ifndef STM32XX_GPIO_BOARD_HPP_INCLUDED
+#define STM32XX_GPIO_BOARD_HPP_INCLUDED
+
+#include <stm32xx/gpio_bus.hpp>
+
+/* Board details */
+namespace stm32xx {
+namespace gpio {
+namespace detail {
+
+#if defined(STM32_FAMILY_STM32F10X)
+/* Address of RCC register with GPIO port clock enable bits */
+constexpr uint32_t gpio_clock_enable_address = RCC_BASE + offsetof(RCC_TypeDef, APB2ENR);
+
+/* RCC_APB2ENR bit enabling the clock of GPIO port at address port */
+constexpr uint32_t
+gpio_clock_enable_bit(uint32_t port)
+{
+  return RCC_APB2ENR_IOPAEN << ((port - GPIOA_BASE) >> 10);
+}
+#elif defined(STM32_FAMILY_STM32F4XX)
+/* Address of RCC register with GPIO port clock enable bits */
+constexpr uint32_t gpio_clock_enable_address = RCC_BASE + offsetof(RCC_TypeDef, AHB1ENR);
+
+/* RCC_AHB1ENR bit enabling the clock of GPIO port at address port */
+constexpr uint32_t
+gpio_clock_enable_bit(uint32_t port)
+{
+  return RCC_AHB1ENR_GPIOAEN << ((port - GPIOA_BASE) >> 10);
+}
+#endif
+
+/* True if port is the base address of a GPIO port (GPIOA, GPIOB, ...) */
+constexpr bool
+is_gpio_port(uint32_t port)
+{
+  return port >= GPIOA_BASE && ((port - GPIOA_BASE) & 0x3FFul) == 0ul
+      && ((port - GPIOA_BASE) >> 10) < 9ul;
+}
+
+/* List of board entries */
+template <typename... _Entries>
+struct board_list
+{
+};
+
+/* True if any of _Entries is on port _port */
+template <uint32_t _port, typename... _Entries>
+struct board_port_in
+{
+  constexpr static bool value = false;
+};
+
+template <uint32_t _port, typename _Head, typename... _Tail>
+struct board_port_in<_port, _Head, _Tail...>
+{
+  constexpr static bool value = (_Head::port == _port)
+                             || board_port_in<_port, _Tail...>::value;
+};
+
+/* ct::port_conf<> of the pin configurations of _Entries on port _port,
+ * collected in _Confs */
+template <uint32_t _port, typename _Confs, typename... _Entries>
+struct board_port_conf;
+
+template <uint32_t _port, typename... _Confs>
+struct board_port_conf<_port, board_list<_Confs...> >
+{
+  typedef ct::port_conf<_Confs...> type;
+  /* bits::ct::mix of the pins fails to compile if a pin is configured
+   * twice on the port, naming the conflicting entries */
+  typedef bits::ct::mix< bits::ct::masked<_Confs::pins, _Confs::pins>... > pins;
+};
+
+template <uint32_t _port, typename... _Confs, typename _Head, typename... _Tail>
+struct board_port_conf<_port, board_list<_Confs...>, _Head, _Tail...>
+  : board_port_conf<_port, typename std::conditional<
+                             _Head::port == _port,
+                             board_list<_Confs..., typename _Head::conf>,
+                             board_list<_Confs...> >::type, _Tail...>
+{
+};
+
+/* Apply ct::port_conf<> _Conf to the port at address _port */
+#if defined(STM32_FAMILY_STM32F10X)
+template <uint32_t _port, typename _Conf, typename _Access>
+inline void
+board_port_init()
+{
+  bits::ct::modify<typename _Conf::crl>::template
+    at<_port + offsetof(GPIO_TypeDef, CRL), _Access>();
+  bits::ct::modify<typename _Conf::crh>::template
+    at<_port + offsetof(GPIO_TypeDef, CRH), _Access>();
+}
+#elif defined(STM32_FAMILY_STM32F4XX)
+template <uint32_t _port, typename _Conf, typename _Access>
+inline void
+board_port_init()
+{
+  bits::ct::modify<typename _Conf::moder>::template
+    at<_port + offsetof(GPIO_TypeDef, MODER), _Access>();
+  bits::ct::modify<typename _Conf::otyper>::template
+    at<_port + offsetof(GPIO_TypeDef, OTYPER), _Access>();
+  bits::ct::modify<typename _Conf::ospeedr>::template
+    at<_port + offsetof(GPIO_TypeDef, OSPEEDR), _Access>();
+  bits::ct::modify<typename _Conf::pupdr>::template
+    at<_port + offsetof(GPIO_TypeDef, PUPDR), _Access>();
+  bits::ct::modify<typename _Conf::afrl>::template
+    at<_port + offsetof(GPIO_TypeDef, AFR), _Access>();
+  bits::ct::modify<typename _Conf::afrh>::template
+    at<_port + offsetof(GPIO_TypeDef, AFR) + 4u, _Access>();
+}
+#endif
+
+/* Per-port operations of a board: the first entry on each port configures
+ * all the entries on that port */
+template <typename _All, typename _Seen, typename... _Rest>
+struct board_ports
+{
+  constexpr static bool disjoint = true;
+  constexpr static unsigned count = 0u;
+  constexpr static uint32_t clocks = 0ul;
+  template <typename _Access, bool _from_reset>
+  static void init() { }
+};
+
+template <typename... _All, typename... _Seen, typename _Head, typename... _Tail>
+struct board_ports<board_list<_All...>, board_list<_Seen...>, _Head, _Tail...>
+{
+  typedef board_port_conf<_Head::port, board_list<>, _All...> conf;
+  typedef board_ports<board_list<_All...>, board_list<_Seen..., _Head>, _Tail...> tail;
+  constexpr static bool first = !board_port_in<_Head::port, _Seen...>::value;
+  constexpr static unsigned count = (first ? 1u : 0u) + tail::count;
+  constexpr static uint32_t clocks = gpio_clock_enable_bit(_Head::port)
+                                   | tail::clocks;
+
+  constexpr static bool disjoint = (!first || conf::pins::mask != 0ul)
+                                && tail::disjoint;
+
+  template <typename _Access, bool _from_reset>
+  static void init()
+  {
+    if(first && _from_reset)
+      conf::type::template init_at<_Head::port, _Access>();
+    else if(first)
+      board_port_init<_Head::port, typename conf::type, _Access>();
+    tail::template init<_Access, _from_reset>();
+  }
+};
+
+} /* namespace detail */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+namespace stm32xx {
+namespace gpio {
+namespace ct {
+
+/** // doc: gpio::ct::pin_conf_on_port {{{
+ * @brief @ref ct::pin_conf "pin_conf" bound to a GPIO port, an entry of
+ *        @ref ct::board "board".
+ *
+ * The port is given by its base address (e.g. @c GPIOB_BASE).
+ */ // }}}
+template <uint32_t _port, typename _Conf>
+struct pin_conf_on_port
+{
+  static_assert(detail::is_gpio_port(_port), "invalid GPIO port address");
+
+  /** // doc: port {{{
+   * Base address of the GPIO port.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t port = _port;
+  /** // doc: pins {{{
+   * Mask of GPIO pins configured by the entry.
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t pins = _Conf::pins;
+  /** // doc: conf {{{
+   * The @ref ct::pin_conf "pin_conf" of the pins.
+   */ // }}}
+  typedef _Conf conf;
+};
+
+/** // doc: gpio::ct::board {{{
+ * @brief All the GPIO pins used by a firmware, configured at once.
+ *
+ * Each entry is a @ref ct::pin_conf_on_port "pin_conf_on_port", typically
+ * one or more per driver module. The board gathers them, so that:
+ *
+ * - it is asserted at compile-time that no pin is assigned twice (a
+ *   bits::ct::mix of the pins of each port, whose overlap check names the
+ *   conflicting entries),
+ * - the clocks of all the used ports are enabled with one modification of
+ *   RCC_APB2ENR (STM32F10x) or RCC_AHB1ENR (STM32F4xx), a single store to
+ *   the bit-band alias when only one port is used,
+ * - init() configures each port with @ref ct::port_conf "port_conf", so
+ *   every configuration register of a port is accessed at most once, and
+ *   registers not touched by any entry are not accessed at all.
+ *
+ * Registers are given by addresses and accessed through @c _Access policy,
+ * as in @ref bits::ct::modify "modify<>::at<>()".
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * using led   = pin_conf_on_port<GPIOC_BASE, pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> >;
+ * using usart = pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> >;
+ * using spi   = pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_5|GPIO_Pin_7, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> >;
+ * board<led, usart, spi>::init(); // RCC_APB2ENR, GPIOA_CRL, GPIOA_CRH, GPIOC_CRH
+ * @endcode
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) and RM0090 Reference manual
+ *      (STM32F4xx) for register definitions.
+ */ // }}}
+template <typename... _Entries>
+struct board
+{
+  typedef detail::board_ports<detail::board_list<_Entries...>,
+                              detail::board_list<>, _Entries...> ports;
+
+  static_assert(ports::disjoint, "pin assigned twice");
+
+  /** // doc: port_count {{{
+   * Number of distinct GPIO ports used by the board.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned port_count = ports::count;
+  /** // doc: clocks {{{
+   * GPIO clock enable bits of the used ports, in RCC_APB2ENR (STM32F10x)
+   * or RCC_AHB1ENR (STM32F4xx).
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t clocks = ports::clocks;
+
+  /** // doc: enable_clocks() {{{
+   * @brief Enable the clocks of all the GPIO ports used by the board.
+   *
+   * Clock bits of other peripherals are preserved, so this is a
+   * read-modify-write (or a single bit-band store for one port).
+   *
+   * On STM32F4xx the register is read back afterwards, as ST's errata
+   * require a delay between enabling a peripheral clock and accessing the
+   * peripheral.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static void enable_clocks()
+  {
+    bits::ct::modify< bits::ct::masked<clocks, clocks> >::template
+      at<detail::gpio_clock_enable_address, _Access>();
+#if defined(STM32_FAMILY_STM32F4XX)
+    detail::load_at<_Access>(detail::gpio_clock_enable_address);
+#endif
+  }
+
+  /** // doc: init() {{{
+   * @brief Enable the GPIO clocks and configure all the pins of the board.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static void init()
+  {
+    enable_clocks<_Access>();
+    ports::template init<_Access, false>();
+  }
+
+  /** // doc: init_from_reset() {{{
+   * @brief Same as init(), for GPIO ports which were not touched since
+   *        reset.
+   *
+   * Each touched GPIO configuration register is written with a single
+   * store and is not read (see ct::port_conf::init_at()), which halves
+   * the bus accesses of init(). In debug builds it is asserted that the
+   * registers still hold their reset values. The clock enable register is
+   * still read-modify-written, as other code may have enabled other
+   * peripherals.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static void init_from_reset()
+  {
+    enable_clocks<_Access>();
+    ports::template init<_Access, true>();
+  }
+};
+
+} /* namespace ct */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_BOARD_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/gpio_bus.hpp {{{
+ * \file stm32xx/gpio_bus.hpp
+ * @brief Parallel buses made of arbitrary GPIO pins.
+ */ // }}}
+#ifndef STM32XX_GPIO_BUS_HPP_INCLUDED
+#define STM32XX_GPIO_BUS_HPP_INCLUDED
+
+#include <stm32xx/gpio.hpp>
+
+/* Parallel bus details */
+namespace stm32xx {
+namespace gpio {
+namespace detail {
+
+/* Shift x left by shift bits (right, if shift is negative) */
+constexpr uint32_t
+shift_left(uint32_t x, int shift)
+{
+  return (shift >= 0) ? (x << shift) : (x >> -shift);
+}
+
+/* True if all pins[i], i in [i, n) are valid pin numbers (0..15) */
+constexpr bool
+bus_valid(const unsigned* pins, unsigned i, unsigned n)
+{
+  return (i == n) || ((pins[i] < 16u) && bus_valid(pins, i + 1u, n));
+}
+
+/* GPIO pin mask of pins[i], i in [i, n) */
+constexpr uint32_t
+bus_pins(const unsigned* pins, unsigned i, unsigned n)
+{
+  return (i == n) ? 0ul
+       : (((pins[i] < 16u) ? (1ul << pins[i]) : 0ul) | bus_pins(pins, i + 1u, n));
+}
+
+/* Sum of GPIO pin masks of pins[i], i in [i, n); differs from bus_pins() if
+ * a pin occurs twice */
+constexpr uint32_t
+bus_pins_sum(const unsigned* pins, unsigned i, unsigned n)
+{
+  return (i == n) ? 0ul
+       : (((pins[i] < 16u) ? (1ul << pins[i]) : 0ul) + bus_pins_sum(pins, i + 1u, n));
+}
+
+/* Mask of value bits i, i in [i, n), which are shifted by shift to get to
+ * their pin (pins[i] - i == shift) */
+constexpr uint32_t
+bus_run_mask(const unsigned* pins, unsigned i, unsigned n, int shift)
+{
+  return (i == n) ? 0ul
+       : ((((int)pins[i] - (int)i == shift) ? (1ul << i) : 0ul)
+          | bus_run_mask(pins, i + 1u, n, shift));
+}
+
+/* Number of distinct shifts in [shift, 16) with non-empty bus_run_mask() */
+constexpr unsigned
+bus_steps(const unsigned* pins, unsigned n, int shift)
+{
+  return (shift == 16) ? 0u
+       : ((bus_run_mask(pins, 0u, n, shift) != 0ul) ? 1u : 0u)
+         + bus_steps(pins, n, shift + 1);
+}
+
+/** // doc: gpio::detail::bus_map {{{
+ * @brief Mapping of bus value bits onto GPIO pins of a single port.
+ *
+ * Bit @c i of bus value goes to pin number <tt>pins[i]</tt>.
+ */ // }}}
+template <unsigned... _pins>
+struct bus_map
+{
+  constexpr static unsigned width = sizeof...(_pins);
+  constexpr static unsigned pins[width + 1u] = { _pins..., 0u };
+
+  /* Mask of value bits to be shifted by shift to get to their pins */
+  constexpr static uint32_t run_mask(int shift)
+  {
+    return bus_run_mask(pins, 0u, width, shift);
+  }
+};
+
+template <unsigned... _pins>
+constexpr unsigned bus_map<_pins...>::pins[];
+
+/** // doc: gpio::detail::bus_scatter {{{
+ * @brief Scatter network of a parallel bus.
+ *
+ * Value bits that have to be shifted by the same amount to get to their
+ * pins (e.g. a run of bits going to contiguous pins) are moved with a
+ * single mask-and-shift step. Shifts with no bits generate no code, so
+ * apply() is an OR of bus_map::steps mask-and-shift terms.
+ */ // }}}
+template <typename _Map, int _shift = -15,
+          uint32_t _mask = _Map::run_mask(_shift)>
+struct bus_scatter
+{
+  constexpr static uint32_t apply(uint32_t value)
+  {
+    return shift_left(value & _mask, _shift)
+         | bus_scatter<_Map, _shift + 1>::apply(value);
+  }
+};
+
+template <typename _Map, int _shift>
+struct bus_scatter<_Map, _shift, 0ul>
+{
+  constexpr static uint32_t apply(uint32_t value)
+  {
+    return bus_scatter<_Map, _shift + 1>::apply(value);
+  }
+};
+
+template <typename _Map>
+struct bus_scatter<_Map, 16, 0ul>
+{
+  constexpr static uint32_t apply(uint32_t)
+  {
+    return 0ul;
+  }
+};
+
+/** // doc: gpio::detail::bus_gather {{{
+ * @brief Gather network of a parallel bus (the reverse of bus_scatter).
+ *
+ * Pins which are at the same distance from their value bits (e.g. a run of
+ * contiguous pins) are moved to the value with a single mask-and-shift
+ * step.
+ */ // }}}
+template <typename _Map, int _shift = -15,
+          uint32_t _mask = _Map::run_mask(_shift)>
+struct bus_gather
+{
+  constexpr static uint32_t apply(uint32_t idr)
+  {
+    return shift_left(idr & shift_left(_mask, _shift), -_shift)
+         | bus_gather<_Map, _shift + 1>::apply(idr);
+  }
+};
+
+template <typename _Map, int _shift>
+struct bus_gather<_Map, _shift, 0ul>
+{
+  constexpr static uint32_t apply(uint32_t idr)
+  {
+    return bus_gather<_Map, _shift + 1>::apply(idr);
+  }
+};
+
+template <typename _Map>
+struct bus_gather<_Map, 16, 0ul>
+{
+  constexpr static uint32_t apply(uint32_t)
+  {
+    return 0ul;
+  }
+};
+
+/* GPIOx_BSRR value setting pins in set and resetting other pins */
+constexpr uint32_t
+bus_bsrr(uint32_t set, uint32_t pins)
+{
+  return set | ((pins ^ set) << 16);
+}
+
+/* Load 32-bit word at addr through _Access, reporting it to the hook */
+template <typename _Access>
+inline uint32_t
+load_at(uint32_t addr)
+{
+  const uint32_t value = _Access::read(addr);
+  bits::access_hook::load(addr, value);
+  return value;
+}
+
+/* Store 32-bit word at addr through _Access, reporting it to the hook */
+template <typename _Access>
+inline void
+store_at(uint32_t addr, uint32_t value)
+{
+  _Access::write(addr, value);
+  bits::access_hook::store(addr, value);
+}
+
+/* List of buses (parts of a multi_bus) */
+template <typename... _Buses>
+struct bus_list
+{
+};
+
+/* True if any of _Buses is on port _port */
+template <uint32_t _port, typename... _Buses>
+struct bus_port_in
+{
+  constexpr static bool value = false;
+};
+
+template <uint32_t _port, typename _Head, typename... _Tail>
+struct bus_port_in<_port, _Head, _Tail...>
+{
+  constexpr static bool value = (_Head::port == _port)
+                             || bus_port_in<_port, _Tail...>::value;
+};
+
+/* Parts of a multi-bus on port _port: value bits from their pins (gather)
+ * or pins set for the value bits (scatter) and all their pins */
+template <uint32_t _port, unsigned _offset, typename... _Buses>
+struct bus_port_parts
+{
+  constexpr static uint32_t pins = 0ul;
+  constexpr static uint32_t pins_sum = 0ul;
+  constexpr static uint32_t gather(uint32_t) { return 0ul; }
+  constexpr static uint32_t scatter(uint32_t) { return 0ul; }
+};
+
+template <uint32_t _port, unsigned _offset, typename _Head, typename... _Tail>
+struct bus_port_parts<_port, _offset, _Head, _Tail...>
+{
+  typedef bus_port_parts<_port, _offset + _Head::width, _Tail...> tail;
+  constexpr static bool here = (_Head::port == _port);
+  constexpr static uint32_t pins = (here ? _Head::pins : 0ul) | tail::pins;
+  constexpr static uint32_t pins_sum = (here ? _Head::pins : 0ul) + tail::pins_sum;
+  constexpr static uint32_t gather(uint32_t idr)
+  {
+    return (here ? (_Head::gather(idr) << _offset) : 0ul) | tail::gather(idr);
+  }
+  constexpr static uint32_t scatter(uint32_t value)
+  {
+    return (here ? _Head::scatter(value >> _offset) : 0ul) | tail::scatter(value);
+  }
+};
+
+/* Per-port operations of a multi-bus: the first part on each port does
+ * the access for all the parts on that port */
+template <typename _All, typename _Seen, typename... _Rest>
+struct bus_ports
+{
+  constexpr static bool disjoint = true;
+  template <typename _Access>
+  static uint32_t read() { return 0ul; }
+  template <typename _Access>
+  static void write(uint32_t) { }
+};
+
+template <typename... _All, typename... _Seen, typename _Head, typename... _Tail>
+struct bus_ports<bus_list<_All...>, bus_list<_Seen...>, _Head, _Tail...>
+{
+  typedef bus_port_parts<_Head::port, 0u, _All...> parts;
+  typedef bus_ports<bus_list<_All...>, bus_list<_Seen..., _Head>, _Tail...> tail;
+  constexpr static bool first = !bus_port_in<_Head::port, _Seen...>::value;
+  constexpr static bool disjoint = (parts::pins == parts::pins_sum)
+                                && tail::disjoint;
+
+  template <typename _Access>
+  static uint32_t read()
+  {
+    const uint32_t value = first
+      ? parts::gather(load_at<_Access>(_Head::port + idr_offset)) : 0ul;
+    return value | tail::template read<_Access>();
+  }
+
+  template <typename _Access>
+  static void write(uint32_t value)
+  {
+    if(first)
+      store_at<_Access>(_Head::port + bsrr_offset,
+                        bus_bsrr(parts::scatter(value), parts::pins));
+    tail::template write<_Access>(value);
+  }
+};
+
+/* Sum of widths of _Buses */
+template <typename... _Buses>
+struct bus_width
+{
+  constexpr static unsigned value = 0u;
+};
+
+template <typename _Head, typename... _Tail>
+struct bus_width<_Head, _Tail...>
+{
+  constexpr static unsigned value = _Head::width + bus_width<_Tail...>::value;
+};
+
+} /* namespace detail */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+namespace stm32xx {
+namespace gpio {
+namespace ct {
+
+/** // doc: gpio::ct::bus {{{
+ * @brief Parallel bus made of arbitrary pins of a single GPIO port.
+ *
+ * Bit @c i of bus value is mapped onto the @c i-th pin number in @c _pins
+ * (e.g. @c 3 or @c GPIO_PinSource3). The pins need not be contiguous, nor
+ * in any particular order.
+ *
+ * write() scatters the value to the pins with a compile-time generated
+ * network (see detail::bus_scatter), builds both the set and the reset
+ * halves of GPIOx_BSRR and writes them with a single store. The network
+ * has one mask-and-shift step per distinct (pin - bit) distance
+ * (@ref steps), so a bus made of a few contiguous runs of pins costs a few
+ * instructions, regardless of its width.
+ *
+ * The port is given by its base address, and accessed through @c _Access
+ * policy, as in @ref bits::ct::modify "modify<>::at<>()".
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // LCD data lines D0..D7 on PB0, PB1, PB2, PB5, PB6, PB7, PB10, PB11
+ * typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd_data; // 3 steps
+ * lcd_data::write(0xA5);
+ * @endcode
+ */ // }}}
+template <uint32_t _port, unsigned... _pins>
+struct bus
+{
+  typedef detail::bus_map<_pins...> map;
+
+  static_assert(sizeof...(_pins) > 0u, "bus has no pins");
+  static_assert(detail::bus_valid(map::pins, 0u, map::width),
+                "invalid pin number (must be 0..15)");
+  static_assert(detail::bus_pins(map::pins, 0u, map::width) ==
+                detail::bus_pins_sum(map::pins, 0u, map::width),
+                "pin used twice in a bus");
+
+  /** // doc: port {{{
+   * Base address of the GPIO port.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t port = _port;
+  /** // doc: width {{{
+   * Number of bits (pins) in the bus.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned width = map::width;
+  /** // doc: pins {{{
+   * Mask of GPIO pins used by the bus.
+   * @hideinitializer
+   */ // }}}
+  constexpr static pins_t pins = detail::bus_pins(map::pins, 0u, map::width);
+  /** // doc: steps {{{
+   * Number of mask-and-shift steps of the scatter network.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned steps = detail::bus_steps(map::pins, map::width, -15);
+
+  static_assert(IS_GPIO_PIN(pins), "invalid pin specifier");
+
+  /** // doc: scatter() {{{
+   * @brief Return GPIO pin mask of pins that are high for bus @c value.
+   *
+   * Bits of @c value above @ref width are ignored.
+   */ // }}}
+  constexpr static uint32_t scatter(uint32_t value)
+  {
+    return detail::bus_scatter<map>::apply(value);
+  }
+
+  /** // doc: bsrr() {{{
+   * @brief Return the GPIOx_BSRR value that puts @c value on the bus.
+   */ // }}}
+  constexpr static uint32_t bsrr(uint32_t value)
+  {
+    return detail::bus_bsrr(scatter(value), pins);
+  }
+
+  /** // doc: write() {{{
+   * @brief Put @c value on the bus with a single store to GPIOx_BSRR.
+   *
+   * Other pins of the port are not affected, so the write is atomic and
+   * safe to use from ISRs.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static void write(uint32_t value)
+  {
+    detail::store_at<_Access>(_port + detail::bsrr_offset, bsrr(value));
+  }
+
+  /** // doc: gather() {{{
+   * @brief Return bus value from GPIOx_IDR value @c idr.
+   */ // }}}
+  constexpr static uint32_t gather(uint32_t idr)
+  {
+    return detail::bus_gather<map>::apply(idr);
+  }
+
+  /** // doc: read() {{{
+   * @brief Read bus value with a single load from GPIOx_IDR.
+   *
+   * The pins are compacted into the value with a compile-time generated
+   * network (see detail::bus_gather), with @ref steps mask-and-shift
+   * steps.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static uint32_t read()
+  {
+    return gather(detail::load_at<_Access>(_port + detail::idr_offset));
+  }
+};
+
+/** // doc: gpio::ct::multi_bus {{{
+ * @brief Parallel bus made of pins of several GPIO ports.
+ *
+ * The bus is a concatenation of @ref ct::bus "bus" parts, the first part
+ * holds the least significant bits of the value. Several parts may lie on
+ * the same port (e.g. when data lines alternate between ports), as long as
+ * they don't share pins.
+ *
+ * read() does one GPIOx_IDR load and write() one GPIOx_BSRR store per
+ * distinct port.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio::ct;
+ * // D0..D5 on PA8..PA13, D6..D9 on PC6..PC9, D10..D11 on PA0..PA1
+ * typedef multi_bus< bus<GPIOA_BASE, 8, 9, 10, 11, 12, 13>,
+ *                    bus<GPIOC_BASE, 6, 7, 8, 9>,
+ *                    bus<GPIOA_BASE, 0, 1> > fpga_data;
+ * uint32_t x = fpga_data::read(); // loads GPIOA->IDR and GPIOC->IDR
+ * @endcode
+ */ // }}}
+template <typename... _Buses>
+struct multi_bus
+{
+  typedef detail::bus_ports< detail::bus_list<_Buses...>,
+                             detail::bus_list<>, _Buses... > ports;
+
+  /** // doc: width {{{
+   * Number of bits in the bus.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned width = detail::bus_width<_Buses...>::value;
+
+  static_assert(sizeof...(_Buses) > 0u, "bus has no parts");
+  static_assert(width <= 32u, "bus wider than 32 bits");
+  static_assert(ports::disjoint, "pin used twice in a bus");
+
+  /** // doc: read() {{{
+   * @brief Read bus value, with one GPIOx_IDR load per distinct port.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static uint32_t read()
+  {
+    return ports::template read<_Access>();
+  }
+
+  /** // doc: write() {{{
+   * @brief Put @c value on the bus, with one GPIOx_BSRR store per distinct
+   *        port.
+   *
+   * The ports are not written at the same time, so the bus passes through
+   * intermediate states.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static void write(uint32_t value)
+  {
+    ports::template write<_Access>(value);
+  }
+};
+
+} /* namespace ct */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_BUS_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/gpio_debounce.hpp {{{
+ * \file stm32xx/gpio_debounce.hpp
+ * @brief Debouncing of GPIO inputs, all pins of a port at once.
+ */ // }}}
+#ifndef STM32XX_GPIO_DEBOUNCE_HPP_INCLUDED
+#define STM32XX_GPIO_DEBOUNCE_HPP_INCLUDED
+
+#include <stm32xx/gpio_board.hpp>
+
+/* Debouncer details */
+namespace stm32xx {
+namespace gpio {
+namespace detail {
+
+/* True if the input configured by _Conf is active low (has a pull-up) */
+#if defined(STM32_FAMILY_STM32F10X)
+template <typename _Conf>
+constexpr bool
+is_active_low()
+{
+  return _Conf::mode == GPIO_Mode_IPU;
+}
+#elif defined(STM32_FAMILY_STM32F4XX)
+template <typename _Conf>
+constexpr bool
+is_active_low()
+{
+  return _Conf::pupd == GPIO_PuPd_UP;
+}
+#endif
+
+/* Pins of _Entries on port _port, all of them (pins) and the active low
+ * ones (low) */
+template <uint32_t _port, typename... _Entries>
+struct debounce_port_pins
+{
+  constexpr static uint32_t pins = 0ul;
+  constexpr static uint32_t low = 0ul;
+};
+
+template <uint32_t _port, typename _Head, typename... _Tail>
+struct debounce_port_pins<_port, _Head, _Tail...>
+{
+  typedef debounce_port_pins<_port, _Tail...> tail;
+  constexpr static uint32_t pins = ((_Head::port == _port) ? _Head::pins : 0ul)
+                                 | tail::pins;
+  constexpr static uint32_t low =
+      ((_Head::port == _port && is_active_low<typename _Head::conf>())
+       ? _Head::pins : 0ul)
+    | tail::low;
+};
+
+/* Vertical counters of a word of inputs (e.g. the pins of a port). Bit n
+ * of cnt1:cnt0 counts the consecutive samples of input n which differ from
+ * its debounced state. */
+template <typename _Word>
+struct debounce_counter
+{
+  _Word state;
+  _Word cnt0;
+  _Word cnt1;
+  _Word pressed;
+  _Word released;
+
+  /* Take sample (1 for active inputs), flip the inputs which differed from
+   * their state in 4 consecutive samples */
+  void update(_Word sample)
+  {
+    const _Word delta = sample ^ state;
+    const _Word toggle = delta & cnt0 & cnt1;
+    cnt1 = (_Word)((cnt1 ^ cnt0) & delta);
+    cnt0 = (_Word)(~cnt0 & delta);
+    state = (_Word)(state ^ toggle);
+    pressed = (_Word)(toggle & state);
+    released = (_Word)(toggle & ~state);
+  }
+};
+
+/* Per-port operations of a debouncer: the first entry on each port loads
+ * GPIOx_IDR and updates the counters number _index */
+template <unsigned _index, typename _All, typename _Seen, typename... _Rest>
+struct debounce_ports
+{
+  constexpr static unsigned count = _index;
+  constexpr static unsigned index_of(uint32_t)
+  {
+    return _index;
+  }
+  template <typename _Access>
+  static void tick(debounce_counter<pins_t>*) { }
+};
+
+template <unsigned _index, typename... _All, typename... _Seen,
+          typename _Head, typename... _Tail>
+struct debounce_ports<_index, board_list<_All...>, board_list<_Seen...>,
+                      _Head, _Tail...>
+{
+  constexpr static bool first = !board_port_in<_Head::port, _Seen...>::value;
+  typedef debounce_port_pins<_Head::port, _All...> port_pins;
+  typedef debounce_ports<_index + (first ? 1u : 0u), board_list<_All...>,
+                         board_list<_Seen..., _Head>, _Tail...> tail;
+  constexpr static unsigned count = tail::count;
+
+  constexpr static unsigned index_of(uint32_t port)
+  {
+    return (first && _Head::port == port) ? _index : tail::index_of(port);
+  }
+
+  template <typename _Access>
+  static void tick(debounce_counter<pins_t>* counters)
+  {
+    if(first)
+      counters[_index].update((pins_t)((load_at<_Access>(_Head::port + idr_offset)
+                                        ^ port_pins::low) & port_pins::pins));
+    tail::template tick<_Access>(counters);
+  }
+};
+
+} /* namespace detail */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+namespace stm32xx {
+namespace gpio {
+
+/** // doc: gpio::debounce {{{
+ * @brief Debouncer of GPIO inputs (buttons, limit switches, ...).
+ *
+ * Each entry is a @ref ct::pin_conf_on_port "pin_conf_on_port" with the
+ * input pins to debounce. Inputs with a pull-up (@c GPIO_Mode_IPU on
+ * STM32F10x, @c GPIO_PuPd_UP on STM32F4xx) are active low, all others
+ * active high; the masks returned by state(), pressed() and released()
+ * have bits set for the active pins regardless.
+ *
+ * Every call to tick() loads GPIOx_IDR once per port and updates all the
+ * pins of the port at once, with vertical counters (bit n of two 16-bit
+ * words is the 2-bit counter of pin n). A pin changes its debounced
+ * state after 4 consecutive samples which differ from it, so with ticks
+ * every 5 ms a contact has to be stable for 20 ms. After construction
+ * all the pins are released.
+ *
+ * <b>Example</b>:
+ * @code
+ * using namespace stm32xx::gpio;
+ * using keys  = ct::pin_conf_on_port<GPIOA_BASE, ct::pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_IPU> >;
+ * using limit = ct::pin_conf_on_port<GPIOC_BASE, ct::pin_conf<GPIO_Pin_13, GPIO_Mode_IPD> >;
+ * debounce<keys, limit> inputs;
+ *
+ * void SysTick_Handler() // every 5 ms
+ * {
+ *   inputs.tick();
+ *   if(inputs.pressed<keys>() & GPIO_Pin_1)
+ *     menu_next();
+ *   if(inputs.state<limit>())
+ *     motor_stop();
+ * }
+ * @endcode
+ */ // }}}
+template <typename... _Entries>
+class debounce
+{
+  typedef detail::debounce_ports<0u, detail::board_list<_Entries...>,
+                                 detail::board_list<>, _Entries...> ports;
+
+  template <typename _Entry>
+  const detail::debounce_counter<pins_t>& counter() const
+  {
+    static_assert(ports::index_of(_Entry::port) < ports::count,
+                  "entry is not debounced");
+    return _counters[ports::index_of(_Entry::port)];
+  }
+public:
+  static_assert(sizeof...(_Entries) != 0u, "no pins to debounce");
+
+  /** // doc: port_count {{{
+   * Number of distinct GPIO ports, hence GPIOx_IDR loads per tick().
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned port_count = ports::count;
+
+  debounce()
+  {
+    for(unsigned i = 0; i < port_count; ++i)
+      _counters[i] = detail::debounce_counter<pins_t>();
+  }
+
+  /** // doc: tick() {{{
+   * @brief Sample all the pins and update their debounced states.
+   *
+   * To be called periodically, e.g. from a timer ISR.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  void tick()
+  {
+    ports::template tick<_Access>(_counters);
+  }
+
+  /** // doc: state() {{{
+   * @brief Debounced state of the pins of port of @c _Entry: a bit is set
+   *        for every active (pressed) pin.
+   */ // }}}
+  template <typename _Entry>
+  pins_t state() const
+  {
+    return counter<_Entry>().state & _Entry::pins;
+  }
+
+  /** // doc: pressed() {{{
+   * @brief Pins of @c _Entry which became active at the last tick().
+   */ // }}}
+  template <typename _Entry>
+  pins_t pressed() const
+  {
+    return counter<_Entry>().pressed & _Entry::pins;
+  }
+
+  /** // doc: released() {{{
+   * @brief Pins of @c _Entry which became inactive at the last tick().
+   */ // }}}
+  template <typename _Entry>
+  pins_t released() const
+  {
+    return counter<_Entry>().released & _Entry::pins;
+  }
+
+private:
+  detail::debounce_counter<pins_t> _counters[port_count];
+};
+
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_DEBOUNCE_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
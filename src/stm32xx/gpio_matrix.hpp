@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+
+/** // doc: stm32xx/gpio_matrix.hpp {{{
+ * \file stm32xx/gpio_matrix.hpp
+ * @brief Scanning and debouncing of key matrices on GPIO pins.
+ */ // }}}
+#ifndef STM32XX_GPIO_MATRIX_HPP_INCLUDED
+#define STM32XX_GPIO_MATRIX_HPP_INCLUDED
+
+#include <stm32xx/gpio_bitbang.hpp>
+#include <stm32xx/gpio_debounce.hpp>
+
+/* Key matrix details */
+namespace stm32xx {
+namespace gpio {
+namespace detail {
+
+/* Parts (single port buses) of a ct::bus or ct::multi_bus */
+template <typename _Bus>
+struct matrix_parts
+{
+  typedef bus_list<_Bus> type;
+};
+
+template <typename... _Buses>
+struct matrix_parts< ct::multi_bus<_Buses...> >
+{
+  typedef bus_list<_Buses...> type;
+};
+
+/* Mask of pins of the buses in _List which are on port _port */
+template <uint32_t _port, typename _List>
+struct matrix_port_pins;
+
+template <uint32_t _port, typename... _Buses>
+struct matrix_port_pins<_port, bus_list<_Buses...> >
+{
+  constexpr static uint32_t value = bus_port_parts<_port, 0u, _Buses...>::pins;
+};
+
+/* Checks of the pins of row parts _RowList and column parts _ColList, done
+ * on the port of each part in _Parts */
+template <typename _RowList, typename _ColList, typename... _Parts>
+struct matrix_ports_check
+{
+  constexpr static bool disjoint = true;
+  constexpr static bool valid = true;
+};
+
+template <typename _RowList, typename _ColList, typename _Head, typename... _Tail>
+struct matrix_ports_check<_RowList, _ColList, _Head, _Tail...>
+{
+  typedef matrix_ports_check<_RowList, _ColList, _Tail...> tail;
+  constexpr static uint32_t rows = matrix_port_pins<_Head::port, _RowList>::value;
+  constexpr static uint32_t cols = matrix_port_pins<_Head::port, _ColList>::value;
+  constexpr static bool disjoint = ((rows & cols) == 0ul) && tail::disjoint;
+  constexpr static bool valid = IS_GPIO_PIN(rows | cols) && tail::valid;
+};
+
+template <typename _RowList, typename _ColList>
+struct matrix_check;
+
+template <typename... _RowParts, typename... _ColParts>
+struct matrix_check< bus_list<_RowParts...>, bus_list<_ColParts...> >
+  : matrix_ports_check< bus_list<_RowParts...>, bus_list<_ColParts...>,
+                        _RowParts..., _ColParts... >
+{
+};
+
+/* Mask of the low n bits of a 64-bit word */
+constexpr uint64_t
+low_bits(unsigned n)
+{
+  return (n >= 64u) ? ~0ull : ((1ull << n) - 1ull);
+}
+
+/* Row by row sampling of a key matrix, unrolled with bitbang::detail::unroll
+ * (one call of bit<_r>() per row) */
+template <typename _Rows, typename _Cols, typename _Delay, typename _Access>
+struct matrix_scan
+{
+  constexpr static uint32_t rows_idle = (uint32_t)low_bits(_Rows::width);
+  constexpr static uint32_t cols_all = (uint32_t)low_bits(_Cols::width);
+
+  /* Drive row _r low, wait for the columns to settle and sample them into
+   * bits _r * cols .. (_r + 1) * cols - 1 of keys */
+  template <unsigned _r>
+  static void bit(uint64_t& keys, uint32_t& stamp)
+  {
+    _Rows::template write<_Access>(rows_idle & ~(1ul << _r));
+    _Delay::wait(stamp);
+    const uint32_t cols = ~_Cols::template read<_Access>() & cols_all;
+    keys |= (uint64_t)cols << (_r * _Cols::width);
+  }
+};
+
+} /* namespace detail */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+namespace stm32xx {
+namespace gpio {
+
+/** // doc: gpio::matrix {{{
+ * @brief Key matrix with rows on pins @c _Rows and columns on pins
+ *        @c _Cols, scanned and debounced as a whole.
+ *
+ * @c _Rows and @c _Cols are @ref ct::bus "bus" or
+ * @ref ct::multi_bus "multi_bus" types, bit @c r of @c _Rows is row @c r
+ * and bit @c c of @c _Cols is column @c c. The rows are open-drain outputs
+ * (released, i.e. high, when idle) and the columns inputs with pull-ups, so
+ * a pressed key pulls its column low while its row is driven low. The
+ * matrix may have up to 64 keys; key (r, c) is bit <tt>r * cols + c</tt>
+ * of the key words returned by sample(), state(), pressed() and
+ * released() (see key()).
+ *
+ * The scan is unrolled at compile time. Each row is driven low with one
+ * GPIOx_BSRR store (per port of @c _Rows), then the columns are sampled
+ * with one GPIOx_IDR load per port of @c _Cols and packed into the key word
+ * with the gather network of the bus (see ct::bus::read()). The rows are
+ * released with one more store at the end. Between driving a row and
+ * sampling the columns scan() waits for a tick of @c _Delay (see
+ * bitbang::no_delay and bitbang::cycle_delay); with
+ * <tt>bitbang::cycle_delay<n></tt> the columns have @c n cycles to settle,
+ * and a scan takes @c rows times @c n cycles plus a fixed, data independent
+ * number of cycles for the ghosting check and the debouncing.
+ *
+ * Without diodes, three keys pressed at three corners of a rectangle make
+ * the fourth corner appear pressed too (ghosting). A scan in which any two
+ * rows share two or more pressed columns is not trusted: the debounced
+ * state is kept, its pending changes are restarted as after a bounce, and
+ * ghosting() returns true until a scan without ghosting.
+ *
+ * Keys are debounced with vertical counters (as by gpio::debounce, one
+ * 64-bit word for all the keys): a key changes its state after 4
+ * consecutive scans which differ from it.
+ *
+ * The pins are checked at compile time: with @c IS_GPIO_PIN, as by
+ * ct::pin_conf, and rows and columns must not share pins.
+ *
+ * <b>Example</b> (4x4 keypad, rows on PB12..PB15, columns on PA0..PA3):
+ * @code
+ * using namespace stm32xx::gpio;
+ * typedef ct::bus<GPIOB_BASE, 12, 13, 14, 15> rows;
+ * typedef ct::bus<GPIOA_BASE, 0, 1, 2, 3> cols;
+ * matrix<rows, cols, bitbang::cycle_delay<72> > keypad; // 1 us per row
+ *
+ * void SysTick_Handler() // every 5 ms
+ * {
+ *   keypad.scan();
+ *   if(keypad.pressed() & keypad.key(3, 0))
+ *     enter();
+ * }
+ * @endcode
+ */ // }}}
+template <typename _Rows, typename _Cols, typename _Delay = bitbang::no_delay>
+class matrix
+{
+  typedef detail::matrix_check< typename detail::matrix_parts<_Rows>::type,
+                                typename detail::matrix_parts<_Cols>::type > check;
+public:
+  /** // doc: rows {{{
+   * Number of rows.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned rows = _Rows::width;
+  /** // doc: cols {{{
+   * Number of columns.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned cols = _Cols::width;
+  /** // doc: keys {{{
+   * Mask of all the keys in a key word.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint64_t keys = detail::low_bits(rows * cols);
+
+  static_assert(rows * cols <= 64u, "more than 64 keys");
+  static_assert(check::valid, "invalid pin specifier");
+  static_assert(check::disjoint, "pin used both by a row and a column");
+
+  /** // doc: key() {{{
+   * @brief Bit of key (@c row, @c col) in key words.
+   */ // }}}
+  constexpr static uint64_t key(unsigned row, unsigned col)
+  {
+    return 1ull << (row * cols + col);
+  }
+
+  /** // doc: sample() {{{
+   * @brief Scan the matrix once and return the raw (not debounced) key word,
+   *        bits set for the keys which read pressed.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  static uint64_t sample()
+  {
+    uint64_t k = 0ull;
+    uint32_t stamp = _Delay::start();
+    bitbang::detail::unroll<detail::matrix_scan<_Rows, _Cols, _Delay, _Access>,
+                            0u, rows>::apply(k, stamp);
+    _Rows::template write<_Access>(detail::matrix_scan<_Rows, _Cols, _Delay, _Access>::rows_idle);
+    return k;
+  }
+
+  /** // doc: is_ghosting() {{{
+   * @brief True if two rows of key word @c k share two or more pressed
+   *        columns, so that some of the keys may be ghosts.
+   *
+   * Branch-free, every pair of rows is checked.
+   */ // }}}
+  static bool is_ghosting(uint64_t k)
+  {
+    uint32_t ghost = 0ul;
+    for(unsigned i = 1u; i < rows; ++i)
+      for(unsigned j = 0u; j < i; ++j)
+        {
+          const uint32_t shared = (uint32_t)(k >> (i * cols))
+                                & (uint32_t)(k >> (j * cols))
+                                & (uint32_t)detail::low_bits(cols);
+          ghost |= shared & (shared - 1ul);
+        }
+    return ghost != 0ul;
+  }
+
+  matrix()
+    : _counter(), _ghosting(false)
+  {
+  }
+
+  /** // doc: scan() {{{
+   * @brief Scan the matrix and update the debounced state of the keys.
+   *
+   * To be called periodically, e.g. from a timer ISR.
+   */ // }}}
+  template <typename _Access = bits::volatile_access>
+  void scan()
+  {
+    const uint64_t k = sample<_Access>();
+    _ghosting = is_ghosting(k);
+    /* a ghosting scan counts as a sample equal to the state */
+    const uint64_t keep = 0ull - (uint64_t)_ghosting;
+    _counter.update((k & ~keep) | (_counter.state & keep));
+  }
+
+  /** // doc: state() {{{
+   * @brief Debounced state of the keys, bits set for pressed keys.
+   */ // }}}
+  uint64_t state() const
+  {
+    return _counter.state;
+  }
+
+  /** // doc: pressed() {{{
+   * @brief Keys which became pressed at the last scan().
+   */ // }}}
+  uint64_t pressed() const
+  {
+    return _counter.pressed;
+  }
+
+  /** // doc: released() {{{
+   * @brief Keys which became released at the last scan().
+   */ // }}}
+  uint64_t released() const
+  {
+    return _counter.released;
+  }
+
+  /** // doc: ghosting() {{{
+   * @brief True if the last scan() was ignored because of ghosting.
+   */ // }}}
+  bool ghosting() const
+  {
+    return _ghosting;
+  }
+
+private:
+  detail::debounce_counter<uint64_t> _counter;
+  bool _ghosting;
+};
+
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_MATRIX_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
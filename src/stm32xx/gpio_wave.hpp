@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/gpio_wave.hpp {{{
+ * \file stm32xx/gpio_wave.hpp
+ * @brief Waveform generation on GPIO pins with DMA transfers to GPIOx_BSRR.
+ *
+ * A timer update event requests a DMA transfer of one 32-bit word from a
+ * circular buffer to GPIOx_BSRR, so the pins change at the timer rate
+ * without CPU intervention. The buffer is split in two halves: while the
+ * DMA plays one half, the other is refilled from the half-transfer and
+ * transfer-complete interrupts.
+ *
+ * <b>Example</b> (STM32F10x, TIM2 update requests DMA1 channel 2):
+ * @code
+ * using namespace stm32xx::gpio;
+ * typedef ct::bus<GPIOB_BASE, 12, 13, 14, 15> steppers;
+ * const uint8_t* streams[4] = { step0, dir0, step1, dir1 };
+ * wave::array_source<4> source(streams, sizeof(step0));
+ * wave::stream<steppers, 128> stream(source);
+ *
+ * stream.start();
+ * wave::dma_start(*DMA1_Channel2, stream.bsrr_address, stream.buffer(), stream.size);
+ * wave::timer_start(*TIM2, 0, 71); // 1 MHz sample rate at 72 MHz
+ *
+ * extern "C" void DMA1_Channel2_IRQHandler()
+ * {
+ *   const uint32_t isr = DMA1->ISR;
+ *   DMA1->IFCR = isr & (DMA1_IT_HT2 | DMA1_IT_TC2);
+ *   if(isr & DMA1_IT_HT2)
+ *     stream.half_transfer();
+ *   if(isr & DMA1_IT_TC2)
+ *     stream.transfer_complete();
+ * }
+ * @endcode
+ */ // }}}
+#ifndef STM32XX_GPIO_WAVE_HPP_INCLUDED
+#define STM32XX_GPIO_WAVE_HPP_INCLUDED
+
+#include <stm32xx/gpio_bus.hpp>
+
+namespace stm32xx {
+namespace gpio {
+/** // doc: namespace wave {{{
+ * @brief Waveform generation with DMA transfers to GPIOx_BSRR.
+ */ // }}}
+namespace wave {
+namespace detail {
+
+/* Bit k of nibble n in the least significant bit of byte k */
+constexpr uint32_t
+nibble_bytes(unsigned n)
+{
+  return (n & 0x1u) | ((n & 0x2u) << 7) | ((n & 0x4u) << 14) | ((n & 0x8u) << 21);
+}
+
+/* Lookup tables of the encoder (header-only, hence a template) */
+template <typename _Dummy = void>
+struct tables
+{
+  constexpr static uint32_t spread[16] = {
+    nibble_bytes(0x0), nibble_bytes(0x1), nibble_bytes(0x2), nibble_bytes(0x3),
+    nibble_bytes(0x4), nibble_bytes(0x5), nibble_bytes(0x6), nibble_bytes(0x7),
+    nibble_bytes(0x8), nibble_bytes(0x9), nibble_bytes(0xA), nibble_bytes(0xB),
+    nibble_bytes(0xC), nibble_bytes(0xD), nibble_bytes(0xE), nibble_bytes(0xF)
+  };
+};
+
+template <typename _Dummy>
+constexpr uint32_t tables<_Dummy>::spread[16];
+
+} /* namespace detail */
+
+/** // doc: gpio::wave::encoder {{{
+ * @brief Encoder of per-pin bit streams into GPIOx_BSRR words.
+ *
+ * Each channel (bit of @c _Bus value, see gpio::ct::bus) has its own bit
+ * stream, 8 samples per byte, least significant bit first. encode8()
+ * transposes one byte of each channel into 8 bus values with a 16-entry
+ * table (two lookups per channel), and turns each value into a BSRR word
+ * with the bus scatter network. Every word drives all the bus pins (sets
+ * or resets each of them).
+ */ // }}}
+template <typename _Bus>
+struct encoder
+{
+  /** // doc: channels {{{
+   * Number of channels (bus pins).
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned channels = _Bus::width;
+
+  /** // doc: encode8() {{{
+   * @brief Encode 8 samples of all channels.
+   *
+   * @param bytes 8 samples of each channel, <tt>bytes[c]</tt> for channel
+   *        @c c, least significant bit first,
+   * @param words 8 GPIOx_BSRR words, output.
+   */ // }}}
+  static void encode8(const uint8_t* bytes, uint32_t* words)
+  {
+    const uint32_t* t = detail::tables<>::spread;
+    /* byte k of lo (hi) holds channels 0..7 of sample k (k + 4),
+     * byte k of lo2 (hi2) holds channels 8..15 */
+    uint32_t lo = 0ul, hi = 0ul, lo2 = 0ul, hi2 = 0ul;
+    for(unsigned c = 0u; c < channels && c < 8u; ++c)
+      {
+        lo |= t[bytes[c] & 0x0Fu] << c;
+        hi |= t[bytes[c] >> 4] << c;
+      }
+    for(unsigned c = 8u; c < channels; ++c)
+      {
+        lo2 |= t[bytes[c] & 0x0Fu] << (c - 8u);
+        hi2 |= t[bytes[c] >> 4] << (c - 8u);
+      }
+    for(unsigned k = 0u; k < 4u; ++k)
+      {
+        const unsigned s = k << 3;
+        words[k] = _Bus::bsrr(((lo >> s) & 0xFFul) | (((lo2 >> s) & 0xFFul) << 8));
+        words[k + 4u] = _Bus::bsrr(((hi >> s) & 0xFFul) | (((hi2 >> s) & 0xFFul) << 8));
+      }
+  }
+};
+
+/** // doc: gpio::wave::array_source {{{
+ * @brief Source of bit streams kept in memory, one array per channel.
+ *
+ * A source provides <tt>bool next(uint8_t* bytes)</tt>, which stores the
+ * next byte (8 samples) of each channel to @c bytes and returns @c false
+ * when there is no more data. Sources computing the data on the fly (e.g.
+ * LED strip drivers) implement the same method.
+ */ // }}}
+template <unsigned _channels>
+class array_source
+{
+public:
+  /** // doc: array_source() {{{
+   * @param streams @c _channels pointers to arrays of @c size bytes.
+   * @param size number of bytes of each channel.
+   */ // }}}
+  array_source(const uint8_t* const* streams, std::size_t size)
+    : _streams(streams), _size(size), _pos(0u)
+  {
+  }
+  /** // doc: next() {{{
+   * @brief Get next byte of each channel.
+   */ // }}}
+  bool next(uint8_t* bytes)
+  {
+    if(_pos == _size)
+      return false;
+    for(unsigned c = 0u; c < _channels; ++c)
+      bytes[c] = _streams[c][_pos];
+    ++_pos;
+    return true;
+  }
+private:
+  const uint8_t* const* _streams;
+  std::size_t _size;
+  std::size_t _pos;
+};
+
+/** // doc: gpio::wave::stream {{{
+ * @brief Double-buffered stream of GPIOx_BSRR words for a circular DMA.
+ *
+ * The buffer holds @c 2*_half words. start() fills both halves. Then
+ * half_transfer() and transfer_complete(), called from the DMA interrupt
+ * handler, refill the half the DMA has just played. Each refill encodes
+ * at most @c _half samples from @c _Source; when it runs dry, the rest is
+ * padded with zeros, which leave the pins unchanged.
+ *
+ * @c _half must be a multiple of 8.
+ */ // }}}
+template <typename _Bus, std::size_t _half,
+          typename _Source = array_source<_Bus::width> >
+class stream
+{
+  static_assert(_half > 0u && (_half & 7u) == 0u,
+                "half-buffer size must be a multiple of 8 words");
+  static_assert(2u * _half <= 0xFFFFu, "too large for a DMA transfer");
+public:
+  /** // doc: half_size {{{
+   * Number of words in half of the buffer.
+   * @hideinitializer
+   */ // }}}
+  constexpr static std::size_t half_size = _half;
+  /** // doc: size {{{
+   * Number of words in the buffer (number of DMA transfers per cycle).
+   * @hideinitializer
+   */ // }}}
+  constexpr static std::size_t size = 2u * _half;
+  /** // doc: bsrr_address {{{
+   * Address of GPIOx_BSRR, the DMA destination.
+   * @hideinitializer
+   */ // }}}
+  constexpr static uint32_t bsrr_address = _Bus::port + gpio::detail::bsrr_offset;
+
+  explicit stream(_Source& source)
+    : _source(&source), _idle(0u)
+  {
+  }
+  /** // doc: start() {{{
+   * @brief Fill both halves of the buffer, before the DMA is started.
+   */ // }}}
+  void start()
+  {
+    _idle = 0u;
+    fill(0u);
+    fill(1u);
+  }
+  /** // doc: half_transfer() {{{
+   * @brief Refill the first half (call on DMA half-transfer interrupt).
+   */ // }}}
+  void half_transfer()
+  {
+    fill(0u);
+  }
+  /** // doc: transfer_complete() {{{
+   * @brief Refill the second half (call on DMA transfer-complete
+   *        interrupt).
+   */ // }}}
+  void transfer_complete()
+  {
+    fill(1u);
+  }
+  /** // doc: finished() {{{
+   * @brief Return @c true when all the samples have been played.
+   *
+   * This is the case when two refills in a row found no samples: the
+   * second one happens after the DMA left the last half with samples.
+   * The count is updated by the DMA interrupt handlers, so it may be
+   * polled, e.g. <tt>while(!s.finished());</tt>.
+   */ // }}}
+  bool finished() const
+  {
+    return _idle >= 2u;
+  }
+  /** // doc: buffer() {{{
+   * @brief The DMA source buffer of @ref size words.
+   */ // }}}
+  const uint32_t* buffer() const
+  {
+    return _buffer;
+  }
+private:
+  void fill(unsigned half)
+  {
+    uint32_t* words = _buffer + half * _half;
+    uint8_t bytes[_Bus::width];
+    std::size_t i = 0u;
+    while(i < _half && _source->next(bytes))
+      {
+        encoder<_Bus>::encode8(bytes, words + i);
+        i += 8u;
+      }
+    _idle = (i == 0u) ? _idle + 1u : 0u;
+    for(; i < _half; ++i)
+      words[i] = 0ul; /* no-op for BSRR, pins keep their levels */
+  }
+
+  stream(stream const&);
+  stream& operator=(stream const&);
+
+  _Source* _source;
+  volatile unsigned _idle; /* written by the DMA interrupt handlers */
+  uint32_t _buffer[2u * _half];
+};
+
+#if defined(STM32_FAMILY_STM32F10X)
+
+/** // doc: gpio::wave::dma_ccr {{{
+ * @brief DMA channel configuration (DMA_CCRx) for waveform streams.
+ *
+ * Memory to peripheral, circular, memory increment, 32-bit transfers,
+ * very high priority, half-transfer and transfer-complete interrupts.
+ */ // }}}
+typedef bits::ct::masked<
+  DMA_CCR1_DIR | DMA_CCR1_CIRC | DMA_CCR1_MINC | DMA_CCR1_PSIZE_1 |
+  DMA_CCR1_MSIZE_1 | DMA_CCR1_PL | DMA_CCR1_HTIE | DMA_CCR1_TCIE,
+  DMA_CCR1_MEM2MEM | DMA_CCR1_PL | DMA_CCR1_MSIZE | DMA_CCR1_PSIZE |
+  DMA_CCR1_MINC | DMA_CCR1_PINC | DMA_CCR1_CIRC | DMA_CCR1_DIR |
+  DMA_CCR1_TEIE | DMA_CCR1_HTIE | DMA_CCR1_TCIE
+> dma_ccr;
+
+/** // doc: gpio::wave::dma_start() {{{
+ * @brief Start circular DMA transfers of @c size words from @c buffer to
+ *        @c periph (e.g. stream::bsrr_address).
+ *
+ * @param channel DMA channel connected to the timer update request, e.g.
+ *        @c *DMA1_Channel2 for TIM2_UP.
+ */ // }}}
+template <typename _Channel>
+inline void
+dma_start(_Channel& channel, uint32_t periph, const uint32_t* buffer,
+          uint16_t size)
+{
+  bits::ct::modify< bits::ct::masked<0ul, DMA_CCR1_EN> >::in(channel.CCR);
+  bits::store(channel.CPAR, periph);
+  bits::store(channel.CMAR, (uint32_t)reinterpret_cast<uintptr_t>(buffer));
+  bits::store(channel.CNDTR, size);
+  bits::ct::modify< bits::ct::mix< dma_ccr,
+                                   bits::ct::masked<DMA_CCR1_EN, DMA_CCR1_EN> >
+                  >::in(channel.CCR);
+}
+
+/** // doc: gpio::wave::dma_stop() {{{
+ * @brief Stop DMA transfers on @c channel.
+ */ // }}}
+template <typename _Channel>
+inline void
+dma_stop(_Channel& channel)
+{
+  bits::ct::modify< bits::ct::masked<0ul, DMA_CCR1_EN> >::in(channel.CCR);
+}
+
+#elif defined(STM32_FAMILY_STM32F4XX)
+
+/** // doc: gpio::wave::dma_cr {{{
+ * @brief DMA stream configuration (DMA_SxCR) for waveform streams.
+ *
+ * Request channel @c _channel (e.g. @c DMA_Channel_6), memory to
+ * peripheral, circular, memory increment, 32-bit single transfers, very
+ * high priority, half-transfer and transfer-complete interrupts.
+ *
+ * @note On STM32F4xx only DMA2 can access GPIO ports (AHB1).
+ */ // }}}
+template <uint32_t _channel>
+struct dma_cr
+  : bits::ct::masked<
+      _channel | DMA_SxCR_DIR_0 | DMA_SxCR_CIRC | DMA_SxCR_MINC |
+      DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1 | DMA_SxCR_PL | DMA_SxCR_HTIE |
+      DMA_SxCR_TCIE,
+      DMA_SxCR_CHSEL | DMA_SxCR_MBURST | DMA_SxCR_PBURST | DMA_SxCR_CT |
+      DMA_SxCR_DBM | DMA_SxCR_PL | DMA_SxCR_PINCOS | DMA_SxCR_MSIZE |
+      DMA_SxCR_PSIZE | DMA_SxCR_MINC | DMA_SxCR_PINC | DMA_SxCR_CIRC |
+      DMA_SxCR_DIR | DMA_SxCR_PFCTRL | DMA_SxCR_TCIE | DMA_SxCR_HTIE |
+      DMA_SxCR_TEIE | DMA_SxCR_DMEIE >
+{
+  static_assert(IS_DMA_CHANNEL(_channel), "invalid DMA channel");
+};
+
+/** // doc: gpio::wave::dma_start() {{{
+ * @brief Start circular DMA transfers of @c size words from @c buffer to
+ *        @c periph (e.g. stream::bsrr_address).
+ *
+ * @param stream DMA stream connected to the timer update request, e.g.
+ *        @c *DMA2_Stream5 (channel 6) for TIM1_UP.
+ */ // }}}
+template <uint32_t _channel, typename _Stream>
+inline void
+dma_start(_Stream& stream, uint32_t periph, const uint32_t* buffer,
+          uint16_t size)
+{
+  bits::ct::modify< bits::ct::masked<0ul, DMA_SxCR_EN> >::in(stream.CR);
+  while(bits::load(stream.CR) & DMA_SxCR_EN)
+    ; /* wait for the current transfer to finish */
+  bits::store(stream.PAR, periph);
+  bits::store(stream.M0AR, (uint32_t)reinterpret_cast<uintptr_t>(buffer));
+  bits::store(stream.NDTR, size);
+  bits::ct::modify< bits::ct::mix< dma_cr<_channel>,
+                                   bits::ct::masked<DMA_SxCR_EN, DMA_SxCR_EN> >
+                  >::in(stream.CR);
+}
+
+/** // doc: gpio::wave::dma_stop() {{{
+ * @brief Stop DMA transfers on @c stream.
+ */ // }}}
+template <typename _Stream>
+inline void
+dma_stop(_Stream& stream)
+{
+  bits::ct::modify< bits::ct::masked<0ul, DMA_SxCR_EN> >::in(stream.CR);
+}
+
+#endif /* STM32_FAMILY_STM32F4XX */
+
+/** // doc: gpio::wave::timer_start() {{{
+ * @brief Start @c timer requesting a DMA transfer on each update event.
+ *
+ * The sample rate is <tt>f_timer / ((prescaler + 1) * (reload + 1))</tt>.
+ * The new prescaler and reload values are loaded with an update generated
+ * before the DMA request is enabled, so no sample is transferred early.
+ */ // }}}
+template <typename _Timer>
+inline void
+timer_start(_Timer& timer, uint16_t prescaler, uint16_t reload)
+{
+  bits::store(timer.PSC, prescaler);
+  bits::store(timer.ARR, reload);
+  bits::store(timer.EGR, TIM_EGR_UG);
+  bits::ct::modify< bits::ct::masked<TIM_DIER_UDE, TIM_DIER_UDE> >::in(timer.DIER);
+  bits::ct::modify< bits::ct::masked<TIM_CR1_ARPE | TIM_CR1_CEN,
+                                     TIM_CR1_ARPE | TIM_CR1_CEN> >::in(timer.CR1);
+}
+
+/** // doc: gpio::wave::timer_stop() {{{
+ * @brief Stop @c timer and its DMA requests.
+ */ // }}}
+template <typename _Timer>
+inline void
+timer_stop(_Timer& timer)
+{
+  bits::ct::modify< bits::ct::masked<0ul, TIM_CR1_CEN> >::in(timer.CR1);
+  bits::ct::modify< bits::ct::masked<0ul, TIM_DIER_UDE> >::in(timer.DIER);
+}
+
+} /* namespace wave */
+} /* namespace gpio */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_GPIO_WAVE_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+/** // doc: stm32xx/prof.hpp {{{
+ * \file stm32xx/prof.hpp
+ * @brief Cycle-accurate profiling with the DWT cycle counter.
+ *
+ * A prof::probe is a named set of statistics (count, min, max, mean and a
+ * histogram) in static storage. A prof::scoped_timer adds the time spent
+ * in its scope to a probe. Probes are dumped one text line each with
+ * prof::dump().
+ *
+ * The macros compile to nothing unless @c STM32XX_PROF is defined, so the
+ * instrumentation can stay in the code:
+ *
+ * @code
+ * #include <stm32xx/prof.hpp>
+ *
+ * STM32XX_PROF_PROBE(lcd_write);
+ *
+ * void lcd_write(uint8_t x)
+ * {
+ *   STM32XX_PROF_SCOPE(lcd_write);
+ *   lcd::write(x);
+ * }
+ *
+ * int main()
+ * {
+ *   stm32xx::prof::dwt_clock::enable();
+ *   // ...
+ *   stm32xx::prof::dump([](const char* line, std::size_t n) { uart_write(line, n); });
+ * }
+ * @endcode
+ *
+ * On target the times are in CPU cycles (@c DWT_CYCCNT). On host (any
+ * non-ARM build) the default clock is prof::host_clock, counting
+ * nanoseconds. Another clock can be selected by defining
+ * @c STM32XX_PROF_CLOCK.
+ */ // }}}
+#ifndef STM32XX_PROF_HPP_INCLUDED
+#define STM32XX_PROF_HPP_INCLUDED
+
+#include <stm32xx/core_cmx.h>
+#include <stm32xx/bits.hpp>
+#include <cstddef>
+#if !defined(__arm__)
+# include <chrono>
+#endif
+
+namespace stm32xx {
+/** // doc: namespace prof {{{
+ * @brief Profiling with the cycle counter.
+ */ // }}}
+namespace prof {
+
+/** // doc: prof::dwt_clock {{{
+ * @brief Clock policy reading the DWT cycle counter (DWT_CYCCNT).
+ *
+ * The counter has to be enabled once with enable().
+ */ // }}}
+struct dwt_clock
+{
+  /** // doc: enable() {{{
+   * @brief Enable the trace unit and start the cycle counter.
+   */ // }}}
+  static void enable()
+  {
+    bits::ct::modify< bits::ct::masked<CoreDebug_DEMCR_TRCENA_Msk,
+                                       CoreDebug_DEMCR_TRCENA_Msk> >::in(CoreDebug->DEMCR);
+    bits::store(DWT->CYCCNT, 0ul);
+    bits::ct::modify< bits::ct::masked<DWT_CTRL_CYCCNTENA_Msk,
+                                       DWT_CTRL_CYCCNTENA_Msk> >::in(DWT->CTRL);
+  }
+  /** // doc: now() {{{
+   * @brief Current value of the cycle counter.
+   */ // }}}
+  static uint32_t now()
+  {
+    return DWT->CYCCNT;
+  }
+};
+
+#if !defined(__arm__)
+/** // doc: prof::host_clock {{{
+ * @brief Stand-in clock for host builds, counting nanoseconds.
+ *
+ * Wraps around every 4.29 s, as the cycle counter of a 1 GHz core would.
+ */ // }}}
+struct host_clock
+{
+  static uint32_t now()
+  {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+#endif
+
+/** // doc: prof::clock {{{
+ * @brief Default clock of the timers.
+ */ // }}}
+#if defined(STM32XX_PROF_CLOCK)
+typedef STM32XX_PROF_CLOCK clock;
+#elif defined(__arm__)
+typedef dwt_clock clock;
+#else
+typedef host_clock clock;
+#endif
+
+/** // doc: prof::stats {{{
+ * @brief Count, min, max, sum and histogram of time intervals.
+ *
+ * Histogram bin 0 counts zero intervals and bin @c k (1 to @c bins - 2)
+ * counts intervals of 2^(k-1) to 2^k - 1; the last bin counts all the
+ * longer ones.
+ */ // }}}
+struct stats
+{
+  /** // doc: bins {{{
+   * Number of histogram bins.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned bins = 16u;
+
+  uint32_t count;         /**< number of intervals */
+  uint32_t min;           /**< shortest interval (~0 if none) */
+  uint32_t max;           /**< longest interval */
+  uint64_t sum;           /**< total time */
+  uint32_t hist[bins];    /**< histogram */
+
+  /** // doc: bin() {{{
+   * @brief Histogram bin of interval @c t.
+   */ // }}}
+  static unsigned bin(uint32_t t)
+  {
+    const unsigned k = (t == 0ul) ? 0u : 32u - (unsigned)__builtin_clz(t);
+    return (k < bins - 1u) ? k : bins - 1u;
+  }
+  /** // doc: clear() {{{
+   * @brief Forget all the intervals.
+   */ // }}}
+  void clear()
+  {
+    count = 0ul;
+    min = 0xFFFFFFFFul;
+    max = 0ul;
+    sum = 0ull;
+    for(unsigned i = 0u; i < bins; ++i)
+      hist[i] = 0ul;
+  }
+  /** // doc: add() {{{
+   * @brief Account interval @c t.
+   */ // }}}
+  void add(uint32_t t)
+  {
+    ++count;
+    min = (t < min) ? t : min;
+    max = (t > max) ? t : max;
+    sum += t;
+    ++hist[bin(t)];
+  }
+  /** // doc: mean() {{{
+   * @brief Mean interval (0 if none).
+   */ // }}}
+  uint32_t mean() const
+  {
+    return count ? (uint32_t)(sum / count) : 0ul;
+  }
+};
+
+/** // doc: prof::probe {{{
+ * @brief Named statistics, linked into the list of all probes.
+ *
+ * Probes must have static storage duration (use STM32XX_PROF_PROBE()).
+ * They are not synchronized: a probe should be updated from one context
+ * only (thread mode, or one interrupt priority).
+ */ // }}}
+class probe
+{
+public:
+  explicit probe(const char* name)
+    : _name(name), _next(head())
+  {
+    _stats.clear();
+    head() = this;
+  }
+  /** // doc: name() {{{
+   * @brief Name of the probe.
+   */ // }}}
+  const char* name() const
+  {
+    return _name;
+  }
+  /** // doc: data() {{{
+   * @brief Statistics of the probe.
+   */ // }}}
+  const prof::stats& data() const
+  {
+    return _stats;
+  }
+  /** // doc: add() {{{
+   * @brief Account interval @c t.
+   */ // }}}
+  void add(uint32_t t)
+  {
+    _stats.add(t);
+  }
+  /** // doc: clear() {{{
+   * @brief Forget all the intervals.
+   */ // }}}
+  void clear()
+  {
+    _stats.clear();
+  }
+  /** // doc: first() {{{
+   * @brief The probe constructed last (start of the list of all probes).
+   */ // }}}
+  static probe* first()
+  {
+    return head();
+  }
+  /** // doc: next() {{{
+   * @brief The probe constructed before this one.
+   */ // }}}
+  probe* next() const
+  {
+    return _next;
+  }
+private:
+  probe(probe const&);
+  probe& operator=(probe const&);
+
+  /* Constant-initialized, so usable from constructors of other statics */
+  static probe*& head()
+  {
+    static probe* p = nullptr;
+    return p;
+  }
+
+  const char* _name;
+  probe* _next;
+  prof::stats _stats;
+};
+
+/** // doc: prof::scoped_timer {{{
+ * @brief Add the lifetime of the timer to a probe.
+ *
+ * Costs two reads of the clock and one stats::add(); the clock is read as
+ * late as possible on construction and as early as possible on
+ * destruction, so the measurement itself includes only one clock read.
+ */ // }}}
+template <typename _Clock = clock>
+class scoped_timer
+{
+public:
+  explicit scoped_timer(probe& p)
+    : _probe(p), _start(_Clock::now())
+  {
+  }
+  ~scoped_timer()
+  {
+    const uint32_t t = _Clock::now() - _start;
+    _probe.add(t);
+  }
+private:
+  scoped_timer(scoped_timer const&);
+  scoped_timer& operator=(scoped_timer const&);
+
+  probe& _probe;
+  const uint32_t _start;
+};
+
+namespace detail {
+/* Append decimal x to buf[n..size), return the new length; the output is
+ * truncated at size */
+inline std::size_t
+put_uint(char* buf, std::size_t n, std::size_t size, uint32_t x)
+{
+  char digits[10];
+  unsigned k = 0u;
+  do
+    {
+      digits[k++] = (char)('0' + x % 10u);
+      x /= 10u;
+    }
+  while(x);
+  while(k && n < size)
+    buf[n++] = digits[--k];
+  return n;
+}
+
+/* Append string s to buf[n..size), return the new length */
+inline std::size_t
+put_str(char* buf, std::size_t n, std::size_t size, const char* s)
+{
+  while(*s && n < size)
+    buf[n++] = *s++;
+  return n;
+}
+} /* namespace detail */
+
+/** // doc: prof::format() {{{
+ * @brief Format probe @c p as one line of text.
+ *
+ * The line is <tt>name count min mean max h0,h1,...,hk\\n</tt>, where
+ * @c h0 to @c hk are the histogram bins up to the last non-empty one
+ * (see prof::stats), e.g. <tt>lcd_write 1000 41 44 97 0,0,0,0,0,0,993,7\\n</tt>.
+ * At most @c size characters are written and the line is not
+ * null-terminated.
+ *
+ * @return length of the line.
+ */ // }}}
+inline std::size_t
+format(const probe& p, char* buf, std::size_t size)
+{
+  const stats& s = p.data();
+  unsigned last = stats::bins;
+  while(last > 1u && s.hist[last - 1u] == 0ul)
+    --last;
+  std::size_t n = detail::put_str(buf, 0u, size, p.name());
+  n = detail::put_str(buf, n, size, " ");
+  n = detail::put_uint(buf, n, size, s.count);
+  n = detail::put_str(buf, n, size, " ");
+  n = detail::put_uint(buf, n, size, s.count ? s.min : 0ul);
+  n = detail::put_str(buf, n, size, " ");
+  n = detail::put_uint(buf, n, size, s.mean());
+  n = detail::put_str(buf, n, size, " ");
+  n = detail::put_uint(buf, n, size, s.max);
+  for(unsigned i = 0u; i < last; ++i)
+    {
+      n = detail::put_str(buf, n, size, i ? "," : " ");
+      n = detail::put_uint(buf, n, size, s.hist[i]);
+    }
+  return detail::put_str(buf, n, size, "\n");
+}
+
+/** // doc: prof::dump() {{{
+ * @brief Format all the probes, calling <tt>put(const char* line,
+ *        std::size_t length)</tt> for each of them.
+ *
+ * Probes are visited from the last constructed one.
+ */ // }}}
+template <typename _Put>
+inline void
+dump(_Put put)
+{
+  char line[128];
+  for(const probe* p = probe::first(); p; p = p->next())
+    put(line, format(*p, line, sizeof(line)));
+}
+
+/** // doc: prof::clear() {{{
+ * @brief Clear all the probes.
+ */ // }}}
+inline void
+clear()
+{
+  for(probe* p = probe::first(); p; p = p->next())
+    p->clear();
+}
+
+} /* namespace prof */
+} /* namespace stm32xx */
+
+/** // doc: STM32XX_PROF_PROBE() {{{
+ * @brief Define probe @c name (at namespace scope).
+ */ // }}}
+/** // doc: STM32XX_PROF_EXTERN_PROBE() {{{
+ * @brief Declare probe @c name defined in another translation unit.
+ */ // }}}
+/** // doc: STM32XX_PROF_SCOPE() {{{
+ * @brief Add the time till the end of the enclosing scope to probe @c name.
+ */ // }}}
+#if defined(STM32XX_PROF)
+# define STM32XX_PROF_PROBE(name) \
+  ::stm32xx::prof::probe stm32xx_prof_probe_##name(#name)
+# define STM32XX_PROF_EXTERN_PROBE(name) \
+  extern ::stm32xx::prof::probe stm32xx_prof_probe_##name
+# define STM32XX_PROF_SCOPE(name) \
+  ::stm32xx::prof::scoped_timer<> stm32xx_prof_scope_##name(stm32xx_prof_probe_##name)
+#else
+# define STM32XX_PROF_PROBE(name) static_assert(true, "")
+# define STM32XX_PROF_EXTERN_PROBE(name) static_assert(true, "")
+# define STM32XX_PROF_SCOPE(name) static_assert(true, "")
+#endif
+
+#endif /* STM32XX_PROF_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
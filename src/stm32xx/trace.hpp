@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) by Pawel Tomulik <ptomulik@meil.pw.edu.pl>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE
+ */
+
+
+/** // doc: stm32xx/trace.hpp {{{
+ * \file stm32xx/trace.hpp
+ * @brief Recording of register accesses performed by the library.
+ *
+ * To enable tracing, include this header, declare a trace::ring and define
+ * @c STM32XX_ACCESS_HOOK (see bits::access_hook) before any other stm32xx
+ * header, in every translation unit:
+ *
+ * @code
+ * #include <stm32xx/trace.hpp>
+ * typedef stm32xx::trace::ring<64> my_ring_t;
+ * extern my_ring_t my_ring;
+ * #define STM32XX_ACCESS_HOOK stm32xx::trace::hook<my_ring_t, my_ring>
+ * #include <stm32xx/gpio.hpp>
+ * @endcode
+ *
+ * When @c STM32XX_ACCESS_HOOK is not defined, nothing is recorded and the
+ * library compiles to the same code as without the hook.
+ */ // }}}
+#ifndef STM32XX_TRACE_HPP_INCLUDED
+#define STM32XX_TRACE_HPP_INCLUDED
+
+#include <cstdint>
+#include <atomic>
+
+namespace stm32xx {
+/** // doc: namespace trace {{{
+ * @brief Tracing of register accesses.
+ */ // }}}
+namespace trace {
+
+/** // doc: trace::null_clock {{{
+ * @brief Clock policy for rings without time stamps (always returns 0).
+ *
+ * A clock policy is a type with <tt>static uint32_t now()</tt>; on target
+ * it would typically return @c DWT->CYCCNT.
+ */ // }}}
+struct null_clock
+{
+  static uint32_t now()
+  {
+    return 0ul;
+  }
+};
+
+/** // doc: trace::event {{{
+ * @brief Single register access.
+ */ // }}}
+struct event
+{
+  /** // doc: kind_t {{{
+   * @brief Type of the access, see bits::null_access_hook.
+   */ // }}}
+  enum kind_t { load, store, modify };
+
+  uintptr_t addr;       /**< address of the register */
+  uint32_t old_value;   /**< value before the access (same as @c new_value for load, 0 for store) */
+  uint32_t new_value;   /**< value loaded or stored */
+  uint32_t stamp;       /**< time stamp from the clock policy */
+  kind_t kind;          /**< type of the access */
+};
+
+/** // doc: trace::ring {{{
+ * @brief Lock-free ring buffer of the last @c _size accesses.
+ *
+ * record() reserves a slot with a single atomic increment, so it may be
+ * called from thread mode and from any number of (nested) ISRs without
+ * masking interrupts. When the ring is full the oldest events are
+ * overwritten. Each slot carries a sequence number written last, which
+ * lets get() detect events that were overwritten or are still being
+ * written.
+ *
+ * @c _size must be a power of two.
+ */ // }}}
+template <unsigned _size, typename _Clock = null_clock>
+class ring
+{
+  static_assert(_size != 0u && (_size & (_size - 1u)) == 0u,
+                "ring size must be a power of two");
+public:
+  /** // doc: size {{{
+   * Capacity of the ring.
+   * @hideinitializer
+   */ // }}}
+  constexpr static unsigned size = _size;
+
+  ring()
+    : _head(0ul)
+  {
+    clear();
+  }
+  /** // doc: record() {{{
+   * @brief Append an event to the ring.
+   */ // }}}
+  void record(event::kind_t kind, uintptr_t addr, uint32_t old_value,
+              uint32_t new_value)
+  {
+    const uint32_t n = _head.fetch_add(1ul, std::memory_order_relaxed);
+    slot& s = _slots[n & (_size - 1u)];
+    s.seq.store(0ul, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_release);
+    s.ev.addr = addr;
+    s.ev.old_value = old_value;
+    s.ev.new_value = new_value;
+    s.ev.stamp = _Clock::now();
+    s.ev.kind = kind;
+    s.seq.store(n + 1ul, std::memory_order_release);
+  }
+  /** // doc: count() {{{
+   * @brief Number of events recorded since construction or clear().
+   */ // }}}
+  uint32_t count() const
+  {
+    return _head.load(std::memory_order_acquire);
+  }
+  /** // doc: get() {{{
+   * @brief Copy @c n-th recorded event (counting from 0) to @c ev.
+   *
+   * @return @c false if the event was overwritten, is not recorded yet, or
+   *         is being written right now.
+   */ // }}}
+  bool get(uint32_t n, event& ev) const
+  {
+    const slot& s = _slots[n & (_size - 1u)];
+    if(s.seq.load(std::memory_order_acquire) != n + 1ul)
+      return false;
+    ev = s.ev;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    return s.seq.load(std::memory_order_relaxed) == n + 1ul;
+  }
+  /** // doc: clear() {{{
+   * @brief Discard all events.
+   *
+   * Must not race with record().
+   */ // }}}
+  void clear()
+  {
+    for(unsigned i = 0u; i < _size; ++i)
+      _slots[i].seq.store(0ul, std::memory_order_relaxed);
+    _head.store(0ul, std::memory_order_release);
+  }
+private:
+  struct slot
+  {
+    std::atomic<uint32_t> seq;
+    event ev;
+  };
+  ring(ring const&);
+  ring& operator=(ring const&);
+
+  std::atomic<uint32_t> _head;
+  slot _slots[_size];
+};
+
+/** // doc: trace::hook {{{
+ * @brief Access hook recording into ring @c _ring.
+ *
+ * Use as @c STM32XX_ACCESS_HOOK (see bits::access_hook).
+ */ // }}}
+template <typename _Ring, _Ring& _ring>
+struct hook
+{
+  static void load(uintptr_t addr, uint32_t value)
+  {
+    _ring.record(event::load, addr, value, value);
+  }
+  static void store(uintptr_t addr, uint32_t value)
+  {
+    _ring.record(event::store, addr, 0ul, value);
+  }
+  static void modify(uintptr_t addr, uint32_t old_value, uint32_t new_value)
+  {
+    _ring.record(event::modify, addr, old_value, new_value);
+  }
+};
+
+} /* namespace trace */
+} /* namespace stm32xx */
+
+#endif /* STM32XX_TRACE_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
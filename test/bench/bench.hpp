@@ -0,0 +1,275 @@
+/** // doc: bench.hpp {{{
+ * \file bench.hpp
+ * \brief Minimal host micro-benchmark harness.
+ *
+ * Benchmarks are defined with the BENCH() macro, similarly to CppUTest's
+ * TEST(). Each benchmark body runs its measured loop @c state.iterations
+ * times and passes computed values to bench::keep(), so the compiler
+ * doesn't optimize the measured code away. bench::run_all() runs each
+ * benchmark after a warm-up, several times, and reports statistics as text
+ * and, optionally, JSON.
+ */ // }}}
+#ifndef BENCH_HPP_INCLUDED
+#define BENCH_HPP_INCLUDED
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+/* Name of the MCU target the benchmarks were built for (see SConscript) */
+#ifndef BENCH_TARGET
+# define BENCH_TARGET "unknown"
+#endif
+
+namespace bench {
+
+/** // doc: bench::keep() {{{
+ * @brief Force the compiler to materialize @c x.
+ */ // }}}
+template <typename T>
+inline void
+keep(T const& x)
+{
+  asm volatile("" : : "g"(x) : "memory");
+}
+
+/** // doc: bench::cycles() {{{
+ * @brief Read host cycle counter (TSC on x86, 0 elsewhere).
+ */ // }}}
+inline uint64_t
+cycles()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  return __builtin_ia32_rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/** // doc: bench::state {{{
+ * @brief State passed to a benchmark body.
+ */ // }}}
+struct state
+{
+  uint32_t iterations;
+};
+
+typedef void (*function_t)(state&);
+
+/** // doc: bench::registrar {{{
+ * @brief Static registration of benchmarks (see BENCH()).
+ */ // }}}
+struct registrar
+{
+  const char* group;
+  const char* name;
+  function_t function;
+  registrar* next;
+
+  registrar(const char* g, const char* n, function_t f)
+    : group(g), name(n), function(f), next(nullptr)
+  {
+    registrar** p = &head();
+    while(*p) p = &(*p)->next;
+    *p = this;
+  }
+
+  static registrar*& head()
+  {
+    static registrar* h = nullptr;
+    return h;
+  }
+};
+
+/** // doc: bench::stats {{{
+ * @brief Summary of per-iteration times measured in several repetitions.
+ */ // }}}
+struct stats
+{
+  double min;
+  double median;
+  double mean;
+  double max;
+
+  explicit stats(std::vector<double> v)
+  {
+    std::sort(v.begin(), v.end());
+    const std::size_t n = v.size();
+    min = v.front();
+    max = v.back();
+    median = (n & 1u) ? v[n/2] : 0.5 * (v[n/2 - 1] + v[n/2]);
+    mean = std::accumulate(v.begin(), v.end(), 0.0) / n;
+  }
+};
+
+/** // doc: bench::options {{{
+ * @brief Command-line options of run_all().
+ */ // }}}
+struct options
+{
+  uint32_t iterations;
+  unsigned warmup;
+  unsigned repetitions;
+  const char* json;
+  std::vector<const char*> filters;
+
+  options()
+    : iterations(1ul << 20), warmup(1), repetitions(5), json(nullptr)
+  {
+  }
+
+  /* Parse arguments, return false on error. */
+  bool parse(int argc, char** argv)
+  {
+    for(int i = 1; i < argc; ++i)
+      {
+        const char* a = argv[i];
+        const bool has_value = (i + 1 < argc);
+        if(!std::strcmp(a, "--json") && has_value)
+          json = argv[++i];
+        else if(!std::strcmp(a, "--iterations") && has_value)
+          iterations = std::strtoul(argv[++i], nullptr, 0);
+        else if(!std::strcmp(a, "--warmup") && has_value)
+          warmup = std::strtoul(argv[++i], nullptr, 0);
+        else if(!std::strcmp(a, "--repetitions") && has_value)
+          repetitions = std::strtoul(argv[++i], nullptr, 0);
+        else if(a[0] == '-')
+          return false;
+        else
+          filters.push_back(a);
+      }
+    return (iterations > 0) && (repetitions > 0);
+  }
+
+  /* Is benchmark @c id selected by the filters? */
+  bool selected(const char* id) const
+  {
+    bool result = filters.empty();
+    for(const char* f : filters)
+      result = result || (std::strstr(id, f) != nullptr);
+    return result;
+  }
+};
+
+/* Write stats as JSON object */
+inline void
+json_stats(std::FILE* f, const char* key, stats const& s)
+{
+  std::fprintf(f, "\"%s\": {\"min\": %.4f, \"median\": %.4f, "
+                  "\"mean\": %.4f, \"max\": %.4f}",
+               key, s.min, s.median, s.mean, s.max);
+}
+
+/** // doc: bench::run_all() {{{
+ * @brief Run all registered benchmarks and print results.
+ *
+ * Each selected benchmark is run @c --warmup times (results discarded), then
+ * @c --repetitions times, each run doing @c --iterations iterations. The
+ * median and minimum of per-iteration times are printed. With @c --json
+ * FILE, all the statistics are also written to FILE in JSON format.
+ *
+ * Other arguments select benchmarks: only those whose @c group.name contains
+ * one of the arguments are run.
+ */ // }}}
+inline int
+run_all(int argc, char** argv)
+{
+  options opts;
+  if(!opts.parse(argc, argv))
+    {
+      std::fprintf(stderr, "usage: %s [--json FILE] [--iterations N] "
+                           "[--warmup N] [--repetitions N] [filter...]\n",
+                   argv[0]);
+      return 2;
+    }
+
+  std::FILE* json = nullptr;
+  if(opts.json)
+    {
+      json = std::fopen(opts.json, "w");
+      if(!json)
+        {
+          std::perror(opts.json);
+          return 1;
+        }
+      std::fprintf(json, "{\n  \"context\": {\"target\": \"%s\", "
+                         "\"iterations\": %lu, \"warmup\": %u, "
+                         "\"repetitions\": %u},\n  \"benchmarks\": [",
+                   BENCH_TARGET, (unsigned long)opts.iterations, opts.warmup,
+                   opts.repetitions);
+    }
+
+  std::printf("%-48s %12s %12s %12s\n", "benchmark", "ns/iter", "min",
+              "cycles/iter");
+  const char* sep = "\n";
+  for(registrar* r = registrar::head(); r; r = r->next)
+    {
+      char id[128];
+      std::snprintf(id, sizeof(id), "%s.%s", r->group, r->name);
+      if(!opts.selected(id))
+        continue;
+
+      state s = { opts.iterations };
+      for(unsigned i = 0; i < opts.warmup; ++i)
+        r->function(s);
+
+      std::vector<double> ns, cy;
+      for(unsigned i = 0; i < opts.repetitions; ++i)
+        {
+          auto t0 = std::chrono::steady_clock::now();
+          uint64_t c0 = cycles();
+          r->function(s);
+          uint64_t c1 = cycles();
+          auto t1 = std::chrono::steady_clock::now();
+          ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count()
+                       / opts.iterations);
+          cy.push_back(double(c1 - c0) / opts.iterations);
+        }
+      const stats ns_stats(ns), cy_stats(cy);
+      std::printf("%-48s %12.3f %12.3f %12.3f\n", id, ns_stats.median,
+                  ns_stats.min, cy_stats.median);
+      if(json)
+        {
+          std::fprintf(json, "%s    {\"name\": \"%s\", ", sep, id);
+          json_stats(json, "ns_per_iter", ns_stats);
+          std::fprintf(json, ", ");
+          json_stats(json, "cycles_per_iter", cy_stats);
+          std::fprintf(json, "}");
+          sep = ",\n";
+        }
+    }
+  if(json)
+    {
+      std::fprintf(json, "\n  ]\n}\n");
+      std::fclose(json);
+    }
+  return 0;
+}
+
+} /* namespace bench */
+
+/** // doc: BENCH() {{{
+ * @brief Define and register a benchmark.
+ *
+ * @code
+ * BENCH(stm32xx__gpio, rt_configure)
+ * {
+ *   for(uint32_t i = 0; i < state.iterations; ++i)
+ *     bench::keep(f(i));
+ * }
+ * @endcode
+ */ // }}}
+#define BENCH(group, name) \
+  static void bench_##group##__##name(::bench::state&); \
+  static ::bench::registrar bench_registrar_##group##__##name( \
+      #group, #name, &bench_##group##__##name); \
+  static void bench_##group##__##name(::bench::state& state)
+
+#endif /* BENCH_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,44 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the gpio::bitbang benchmarks. */
+#include <stm32xx/gpio_bitbang.hpp>
+
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::bitbang::no_delay;
+
+namespace {
+#if defined STM32_FAMILY_STM32F10X
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN_FLOATING> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> tx;
+#elif defined STM32_FAMILY_STM32F4XX
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> tx;
+#endif
+
+typedef stm32xx::gpio::bitbang::spi<GPIOB_BASE, sck, mosi, miso> spi;
+typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda> i2c;
+typedef stm32xx::gpio::bitbang::uart_tx<GPIOB_BASE, tx, no_delay> uart;
+}
+
+extern "C" {
+
+uint8_t stm32xx__gpio__bitbang__spi__transfer(uint8_t out)
+{ return spi::transfer(out); }
+
+bool stm32xx__gpio__bitbang__i2c__write(uint8_t byte)
+{ return i2c::write(byte); }
+
+void stm32xx__gpio__bitbang__uart__write(uint8_t byte)
+{ uart::write(byte); }
+
+} /* extern "C" */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
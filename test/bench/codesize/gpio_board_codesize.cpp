@@ -0,0 +1,62 @@
+/* Functions measured by the code size report (see SConscript): bring-up of
+ * the same set of pins with gpio::ct::board and with one clock enable and
+ * one port_conf per driver module. */
+#include <stm32xx/gpio_board.hpp>
+
+using namespace stm32xx::gpio::ct;
+
+#if defined(STM32_FAMILY_STM32F10X)
+namespace {
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> led;
+typedef pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> usart_tx;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_IN_FLOATING> usart_rx;
+typedef pin_conf<GPIO_Pin_5|GPIO_Pin_7, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> spi_out;
+typedef pin_conf<GPIO_Pin_0, GPIO_Mode_IPU> button;
+
+template <uint32_t _enable>
+void enable_clock()
+{
+  using namespace stm32xx::bits::ct;
+  modify< masked<_enable, _enable> >::template at<RCC_BASE + offsetof(RCC_TypeDef, APB2ENR)>();
+}
+}
+
+extern "C" {
+
+void stm32xx__gpio__board__init__per_module()
+{
+  enable_clock<RCC_APB2Periph_GPIOC>();
+  port_conf<led>::in(*GPIOC);
+  enable_clock<RCC_APB2Periph_GPIOA>();
+  port_conf<usart_tx>::in(*GPIOA);
+  enable_clock<RCC_APB2Periph_GPIOA>();
+  port_conf<usart_rx>::in(*GPIOA);
+  enable_clock<RCC_APB2Periph_GPIOA>();
+  port_conf<spi_out>::in(*GPIOA);
+  enable_clock<RCC_APB2Periph_GPIOB>();
+  port_conf<button>::in(*GPIOB);
+}
+
+void stm32xx__gpio__board__init()
+{
+  board< pin_conf_on_port<GPIOC_BASE, led>,
+         pin_conf_on_port<GPIOA_BASE, usart_tx>,
+         pin_conf_on_port<GPIOA_BASE, usart_rx>,
+         pin_conf_on_port<GPIOA_BASE, spi_out>,
+         pin_conf_on_port<GPIOB_BASE, button> >::init();
+}
+
+void stm32xx__gpio__board__init_from_reset()
+{
+  board< pin_conf_on_port<GPIOC_BASE, led>,
+         pin_conf_on_port<GPIOA_BASE, usart_tx>,
+         pin_conf_on_port<GPIOA_BASE, usart_rx>,
+         pin_conf_on_port<GPIOA_BASE, spi_out>,
+         pin_conf_on_port<GPIOB_BASE, button> >::init_from_reset();
+}
+
+} /* extern "C" */
+#endif /* STM32_FAMILY_STM32F10X */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,44 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the gpio::ct::bus benchmarks. */
+#include <stm32xx/gpio_bus.hpp>
+
+using stm32xx::gpio::ct::bus;
+
+namespace {
+typedef bus<GPIOB_BASE, 0, 1, 2, 3, 4, 5, 6, 7> low8;
+typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+
+using stm32xx::gpio::ct::multi_bus;
+typedef multi_bus< bus<GPIOA_BASE, 8, 9, 10, 11, 12, 13>,
+                   bus<GPIOC_BASE, 6, 7, 8, 9>,
+                   bus<GPIOA_BASE, 1, 0> > two_ports12;
+}
+
+extern "C" {
+
+void stm32xx__gpio__bus__write__low8(uint32_t value)
+{ low8::write(value); }
+
+void stm32xx__gpio__bus__write__lcd8(uint32_t value)
+{ lcd8::write(value); }
+
+void stm32xx__gpio__bus__write__shuffled16(uint32_t value)
+{ shuffled16::write(value); }
+
+uint32_t stm32xx__gpio__bus__read__low8()
+{ return low8::read(); }
+
+uint32_t stm32xx__gpio__bus__read__lcd8()
+{ return lcd8::read(); }
+
+uint32_t stm32xx__gpio__bus__read__shuffled16()
+{ return shuffled16::read(); }
+
+uint32_t stm32xx__gpio__bus__read__two_ports12()
+{ return two_ports12::read(); }
+
+} /* extern "C" */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,109 @@
+/* Functions measured by the code size report (see SConscript). Each one
+ * wraps a benchmarked API with runtime arguments; its name matches the
+ * benchmark, with '.' replaced by "__". */
+#include <stm32xx/gpio.hpp>
+
+#if defined STM32_FAMILY_STM32F10X
+using namespace stm32xx::gpio;
+
+extern "C" {
+
+uint32_t stm32xx__gpio__detail__crl_nibbles(pins_t pins)
+{ return detail::crl_nibbles(pins); }
+
+uint32_t stm32xx__gpio__detail__crh_nibbles(pins_t pins)
+{ return detail::crh_nibbles(pins); }
+
+uint32_t stm32xx__gpio__detail__cnf_mode(GPIOMode_TypeDef mode,
+                                         GPIOSpeed_TypeDef speed)
+{ return detail::cnf_mode(mode, speed); }
+
+uint32_t stm32xx__gpio__detail__crl_bits(pins_t pins, GPIOMode_TypeDef mode,
+                                         GPIOSpeed_TypeDef speed)
+{ return detail::crl_bits(pins, mode, speed); }
+
+uint32_t stm32xx__gpio__detail__crl_mask(pins_t pins)
+{ return detail::crl_mask(pins); }
+
+uint32_t stm32xx__gpio__detail__crh_bits(pins_t pins, GPIOMode_TypeDef mode,
+                                         GPIOSpeed_TypeDef speed)
+{ return detail::crh_bits(pins, mode, speed); }
+
+uint32_t stm32xx__gpio__detail__crh_mask(pins_t pins)
+{ return detail::crh_mask(pins); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crl_cnf_bits(pins_t pins,
+                                                            GPIOMode_TypeDef mode)
+{ return detail::crl_cnf_bits(pins, mode); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crl_cnf_mask(pins_t pins)
+{ return detail::crl_cnf_mask(pins); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crl_mode_bits(pins_t pins,
+                                                             GPIOSpeed_TypeDef speed)
+{ return detail::crl_mode_bits(pins, speed); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crl_mode_mask(pins_t pins)
+{ return detail::crl_mode_mask(pins); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crh_cnf_bits(pins_t pins,
+                                                            GPIOMode_TypeDef mode)
+{ return detail::crh_cnf_bits(pins, mode); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crh_cnf_mask(pins_t pins)
+{ return detail::crh_cnf_mask(pins); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crh_mode_bits(pins_t pins,
+                                                             GPIOSpeed_TypeDef speed)
+{ return detail::crh_mode_bits(pins, speed); }
+
+uint32_t stm32xx__gpio__all_pin_masks__detail__crh_mode_mask(pins_t pins)
+{ return detail::crh_mode_mask(pins); }
+
+void stm32xx__gpio__rt__configure(GPIO_TypeDef* port, pins_t pins,
+                                  GPIOMode_TypeDef mode,
+                                  GPIOSpeed_TypeDef speed)
+{ rt::configure(port, pins, mode, speed); }
+
+void stm32xx__gpio__ct__port_conf__switch(GPIO_TypeDef* port)
+{
+  typedef ct::pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> leds;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> bitbang;
+  ct::port_conf<leds, bitbang>::in(*port);
+}
+
+void stm32xx__gpio__ct__transition__switch(GPIO_TypeDef* port)
+{
+  typedef ct::pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> leds;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> usart;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> bitbang;
+  ct::transition< ct::port_conf<leds, usart>, ct::port_conf<leds, bitbang> >::in(*port);
+}
+
+void stm32xx__gpio__rt__configure__roles(GPIO_TypeDef* port, unsigned index)
+{
+  static const struct {
+    uint16_t pins;
+    GPIOMode_TypeDef mode;
+    GPIOSpeed_TypeDef speed;
+  } roles[3] = {
+    { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz },
+    { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz },
+    { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_IN_FLOATING, (GPIOSpeed_TypeDef)0 }
+  };
+  rt::configure(port, roles[index].pins, roles[index].mode, roles[index].speed);
+}
+
+void stm32xx__gpio__ct__config_set__in(GPIO_TypeDef* port, unsigned index)
+{
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> usart;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> bitbang;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_IN_FLOATING> hiz;
+  ct::config_set<usart, bitbang, hiz>::in(*port, index);
+}
+
+} /* extern "C" */
+#endif /* STM32_FAMILY_STM32F10X */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,26 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the gpio::debounce benchmarks. */
+#include <stm32xx/gpio_debounce.hpp>
+
+using namespace stm32xx::gpio;
+
+#if defined STM32_FAMILY_STM32F10X
+namespace {
+typedef ct::pin_conf<GPIO_Pin_All, GPIO_Mode_IPU> buttons;
+typedef ct::pin_conf_on_port<GPIOA_BASE, buttons> port_a;
+typedef ct::pin_conf_on_port<GPIOB_BASE, buttons> port_b;
+}
+
+extern "C" {
+
+uint32_t stm32xx__gpio__debounce__tick__32_pins(debounce<port_a, port_b>& d)
+{
+  d.tick();
+  return d.pressed<port_a>() | ((uint32_t)d.pressed<port_b>() << 16);
+}
+
+} /* extern "C" */
+#endif /* STM32_FAMILY_STM32F10X */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
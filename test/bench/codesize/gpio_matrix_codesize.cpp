@@ -0,0 +1,23 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the gpio::matrix benchmarks. */
+#include <stm32xx/gpio_matrix.hpp>
+
+using namespace stm32xx::gpio;
+
+namespace {
+typedef ct::bus<GPIOB_BASE, 8, 9, 10, 11, 12, 13, 14, 15> rows;
+typedef ct::bus<GPIOA_BASE, 0, 1, 2, 3, 4, 5, 6, 7> cols;
+}
+
+extern "C" {
+
+uint64_t stm32xx__gpio__matrix__scan__64_keys(matrix<rows, cols>& m)
+{
+  m.scan();
+  return m.pressed();
+}
+
+} /* extern "C" */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
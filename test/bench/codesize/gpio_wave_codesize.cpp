@@ -0,0 +1,28 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the gpio::wave benchmarks. */
+#include <stm32xx/gpio_wave.hpp>
+
+using stm32xx::gpio::ct::bus;
+using stm32xx::gpio::wave::encoder;
+
+namespace {
+typedef bus<GPIOB_BASE, 12, 13, 14, 15> steppers;
+typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+}
+
+extern "C" {
+
+void stm32xx__gpio__wave__encode8__steppers(const uint8_t* bytes, uint32_t* words)
+{ encoder<steppers>::encode8(bytes, words); }
+
+void stm32xx__gpio__wave__encode8__lcd8(const uint8_t* bytes, uint32_t* words)
+{ encoder<lcd8>::encode8(bytes, words); }
+
+void stm32xx__gpio__wave__encode8__shuffled16(const uint8_t* bytes, uint32_t* words)
+{ encoder<shuffled16>::encode8(bytes, words); }
+
+} /* extern "C" */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
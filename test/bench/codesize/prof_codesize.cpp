@@ -0,0 +1,20 @@
+/* Functions measured by the code size report (see SConscript), named after
+ * the prof benchmarks. */
+#include <stm32xx/prof.hpp>
+
+using stm32xx::prof::probe;
+using stm32xx::prof::scoped_timer;
+using stm32xx::prof::dwt_clock;
+
+extern "C" {
+
+void stm32xx__prof__stats__add(probe& p, uint32_t t)
+{ p.add(t); }
+
+void stm32xx__prof__scoped_timer(probe& p)
+{ scoped_timer<dwt_clock> timer(p); }
+
+} /* extern "C" */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
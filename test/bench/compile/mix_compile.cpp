@@ -0,0 +1,84 @@
+/* Compile-time benchmark of bits::ct::mix.
+ *
+ * This file is only compiled (with -fsyntax-only), the build time is what
+ * is measured (see SConscript). MIX_COMPILE_N is the number of elements
+ * mixed. With MIX_COMPILE_RECURSIVE defined, the former recursive
+ * implementation of mix is used instead, as a baseline. */
+#include <stm32xx/bits.hpp>
+
+#ifndef MIX_COMPILE_N
+# define MIX_COMPILE_N 100
+#endif
+
+namespace {
+using stm32xx::bits::ct::masked;
+using stm32xx::bits::ct::get_bits;
+using stm32xx::bits::ct::get_mask;
+
+/* Element I: bit I in the mask for the first 32 elements, empty mask for
+ * the others (so that the elements do not overlap). */
+template <std::size_t I>
+  struct element
+    : masked<(I < 32u && (I & 1u)) ? (1ul << (I & 31u)) : 0ul,
+             (I < 32u) ? (1ul << (I & 31u)) : 0ul>
+  {
+  };
+
+/* Index sequence with O(log N) instantiation depth */
+template <std::size_t ... I> struct seq {};
+template <typename A, typename B> struct seq_cat;
+template <std::size_t ... I, std::size_t ... J>
+  struct seq_cat<seq<I...>, seq<J...> >
+  {
+    typedef seq<I..., (sizeof...(I) + J)...> type;
+  };
+template <std::size_t N>
+  struct make_seq
+    : seq_cat<typename make_seq<N/2>::type, typename make_seq<N - N/2>::type>
+  {
+  };
+template <> struct make_seq<0> { typedef seq<> type; };
+template <> struct make_seq<1> { typedef seq<0> type; };
+
+#if defined(MIX_COMPILE_RECURSIVE)
+/* The former implementation, one instantiation per element */
+template <typename ... _list> struct mix;
+template <typename _m, typename ... _tail>
+  struct mix<_m,_tail...>
+  {
+    constexpr static uint32_t _m_mask = get_mask<_m>::value;
+    constexpr static uint32_t _t_mask = get_mask<mix<_tail...> >::value;
+    static_assert((_m_mask^_t_mask)==(_m_mask|_t_mask), "masks overlap");
+    constexpr static uint32_t _t_bits = get_bits<mix<_tail...> >::value;
+    constexpr static uint32_t _m_bits = get_bits<_m>::value;
+    constexpr static uint32_t mask = _t_mask | _m_mask;
+    constexpr static uint32_t bits = _t_bits | _m_bits;
+    constexpr static uint32_t value = bits;
+  };
+template <>
+  struct mix<>
+  {
+    constexpr static uint32_t bits = 0;
+    constexpr static uint32_t mask = 0;
+    constexpr static uint32_t value = 0;
+  };
+#else
+using stm32xx::bits::ct::mix;
+#endif
+
+template <typename S> struct mix_of;
+template <std::size_t ... I>
+  struct mix_of<seq<I...> >
+  {
+    typedef mix<element<I>...> type;
+  };
+
+typedef mix_of<make_seq<MIX_COMPILE_N>::type>::type mixed;
+static_assert(mixed::mask == ((MIX_COMPILE_N >= 32) ? 0xFFFFFFFFul
+                              : ((1ul << (MIX_COMPILE_N % 32)) - 1ul)),
+              "unexpected mask");
+static_assert(mixed::bits == (mixed::mask & 0xAAAAAAAAul), "unexpected bits");
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
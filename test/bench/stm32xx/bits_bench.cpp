@@ -0,0 +1,109 @@
+#include <stm32xx/bits.hpp>
+#include <stm32xx/atomic.hpp>
+#include <bench.hpp>
+
+namespace {
+using namespace stm32xx::bits::ct;
+
+typedef masked<0x00000003ul, 0x0000000Ful> m0;
+typedef masked<0x00000B00ul, 0x00000F00ul> m1;
+typedef masked<0x00400000ul, 0x00F00000ul> m2;
+typedef masked<0x80000000ul, 0xF0000000ul> m3;
+
+volatile uint32_t reg;
+
+/* Host memory standing for the configured registers */
+volatile uint32_t regs[16];
+
+struct host_regs
+{
+  static uint32_t read(uint32_t addr) { return regs[(addr >> 2) & 15]; }
+  static void write(uint32_t addr, uint32_t v) { regs[(addr >> 2) & 15] = v; }
+};
+
+/* Field _f (4 bits) of register _r of a configuration, 16 registers with
+ * 3 fields each, listed field by field as separate modules would */
+template <unsigned _r, unsigned _f>
+using cfg = op<0x60000000ul + 4u * _r,
+               masked<((_r + _f) & 0xFul) << (4u * _f), 0xFul << (4u * _f)> >;
+
+typedef transaction<
+  cfg<0,0>, cfg<1,0>, cfg<2,0>, cfg<3,0>, cfg<4,0>, cfg<5,0>, cfg<6,0>, cfg<7,0>,
+  cfg<8,0>, cfg<9,0>, cfg<10,0>, cfg<11,0>, cfg<12,0>, cfg<13,0>, cfg<14,0>, cfg<15,0>,
+  cfg<0,1>, cfg<1,1>, cfg<2,1>, cfg<3,1>, cfg<4,1>, cfg<5,1>, cfg<6,1>, cfg<7,1>,
+  cfg<8,1>, cfg<9,1>, cfg<10,1>, cfg<11,1>, cfg<12,1>, cfg<13,1>, cfg<14,1>, cfg<15,1>,
+  cfg<0,2>, cfg<1,2>, cfg<2,2>, cfg<3,2>, cfg<4,2>, cfg<5,2>, cfg<6,2>, cfg<7,2>,
+  cfg<8,2>, cfg<9,2>, cfg<10,2>, cfg<11,2>, cfg<12,2>, cfg<13,2>, cfg<14,2>, cfg<15,2>
+> config_transaction;
+
+typedef table<
+  cfg<0,0>, cfg<1,0>, cfg<2,0>, cfg<3,0>, cfg<4,0>, cfg<5,0>, cfg<6,0>, cfg<7,0>,
+  cfg<8,0>, cfg<9,0>, cfg<10,0>, cfg<11,0>, cfg<12,0>, cfg<13,0>, cfg<14,0>, cfg<15,0>,
+  cfg<0,1>, cfg<1,1>, cfg<2,1>, cfg<3,1>, cfg<4,1>, cfg<5,1>, cfg<6,1>, cfg<7,1>,
+  cfg<8,1>, cfg<9,1>, cfg<10,1>, cfg<11,1>, cfg<12,1>, cfg<13,1>, cfg<14,1>, cfg<15,1>,
+  cfg<0,2>, cfg<1,2>, cfg<2,2>, cfg<3,2>, cfg<4,2>, cfg<5,2>, cfg<6,2>, cfg<7,2>,
+  cfg<8,2>, cfg<9,2>, cfg<10,2>, cfg<11,2>, cfg<12,2>, cfg<13,2>, cfg<14,2>, cfg<15,2>
+> config_table;
+}
+
+BENCH(stm32xx__bits__ct, modify__in)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    modify<m1>::in(reg);
+}
+
+BENCH(stm32xx__bits__ct, modify__in_exclusive)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    modify<m1>::in<stm32xx::bits::exclusive_access>(reg);
+}
+
+BENCH(stm32xx__bits__ct, modify__in_critical)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    modify<m1>::in<stm32xx::bits::critical_access<> >(reg);
+}
+
+BENCH(stm32xx__bits__ct, modify__in_full_mask)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    modify<masked<0x12345678ul, 0xFFFFFFFFul> >::in(reg);
+}
+
+BENCH(stm32xx__bits__rt, modify)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    stm32xx::bits::rt::modify(reg, (i & 0x0Ful) << 8, 0x00000F00ul);
+}
+
+BENCH(stm32xx__bits__ct, modify__four_separate)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      modify<m0>::in(reg);
+      modify<m1>::in(reg);
+      modify<m2>::in(reg);
+      modify<m3>::in(reg);
+    }
+}
+
+BENCH(stm32xx__bits__ct, modify__mix_of_four)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    modify<mix<m0, m1, m2, m3> >::in(reg);
+}
+
+BENCH(stm32xx__bits__ct, transaction__48_ops)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    config_transaction::apply<host_regs>();
+}
+
+BENCH(stm32xx__bits__ct, table__48_ops)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    config_table::apply<host_regs>();
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
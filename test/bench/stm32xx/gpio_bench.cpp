@@ -0,0 +1,308 @@
+#include <stm32xx/gpio.hpp>
+#include <bench.hpp>
+
+#if defined STM32_FAMILY_STM32F10X
+namespace {
+
+/* The original 8-way ternary chains of gpio::detail, kept as a baseline. */
+uint32_t
+chain_cnf(uint32_t pins, uint32_t cnf)
+{
+  return  ((pins & GPIO_Pin_0) ? (cnf << 0x00) : 0x00)
+        | ((pins & GPIO_Pin_1) ? (cnf << 0x04) : 0x00)
+        | ((pins & GPIO_Pin_2) ? (cnf << 0x08) : 0x00)
+        | ((pins & GPIO_Pin_3) ? (cnf << 0x0C) : 0x00)
+        | ((pins & GPIO_Pin_4) ? (cnf << 0x10) : 0x00)
+        | ((pins & GPIO_Pin_5) ? (cnf << 0x14) : 0x00)
+        | ((pins & GPIO_Pin_6) ? (cnf << 0x18) : 0x00)
+        | ((pins & GPIO_Pin_7) ? (cnf << 0x1C) : 0x00);
+}
+
+inline uint32_t
+chain_crl_bits(uint32_t pins, GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
+{
+  return chain_cnf(pins, mode & 0x0Cul) | chain_cnf(pins, speed & 0x03ul);
+}
+
+inline uint32_t
+chain_crl_mask(uint32_t pins)
+{
+  return chain_cnf(pins, 0x0Cul) | chain_cnf(pins, 0x03ul);
+}
+
+inline uint32_t
+chain_crh_bits(uint32_t pins, GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
+{
+  return chain_crl_bits(pins >> 8, mode, speed);
+}
+
+inline uint32_t
+chain_crh_mask(uint32_t pins)
+{
+  return chain_crl_mask(pins >> 8);
+}
+
+struct input
+{
+  stm32xx::gpio::pins_t pins;
+  GPIOMode_TypeDef mode;
+  GPIOSpeed_TypeDef speed;
+};
+
+/* Pseudo-random inputs, so nothing is folded at compile time. */
+const input*
+inputs()
+{
+  static input in[1024];
+  static bool ready = false;
+  if(!ready)
+    {
+      const GPIOMode_TypeDef modes[] = {
+        GPIO_Mode_AIN, GPIO_Mode_IN_FLOATING, GPIO_Mode_IPD, GPIO_Mode_IPU,
+        GPIO_Mode_Out_OD, GPIO_Mode_Out_PP, GPIO_Mode_AF_OD, GPIO_Mode_AF_PP
+      };
+      uint32_t x = 12345;
+      for(input& i : in)
+        {
+          x = x * 1103515245ul + 12345ul;
+          i.pins = (x >> 8) & 0xFFFF;
+          i.mode = modes[(x >> 24) & 0x07];
+          i.speed = (GPIOSpeed_TypeDef)(((i.mode & 0x10) != 0) ? 1 + (x >> 28) % 3 : 0);
+        }
+      ready = true;
+    }
+  return in;
+}
+
+} /* anonymous namespace */
+
+BENCH(stm32xx__gpio, chains__crl_crh_bits_mask)
+{
+  const input* in = inputs();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      const input& x = in[i & 1023];
+      bench::keep(chain_crl_bits(x.pins, x.mode, x.speed));
+      bench::keep(chain_crl_mask(x.pins));
+      bench::keep(chain_crh_bits(x.pins, x.mode, x.speed));
+      bench::keep(chain_crh_mask(x.pins));
+    }
+}
+
+BENCH(stm32xx__gpio, detail__crl_crh_bits_mask)
+{
+  using namespace stm32xx::gpio;
+  const input* in = inputs();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      const input& x = in[i & 1023];
+      bench::keep(detail::crl_bits(x.pins, x.mode, x.speed));
+      bench::keep(detail::crl_mask(x.pins));
+      bench::keep(detail::crh_bits(x.pins, x.mode, x.speed));
+      bench::keep(detail::crh_mask(x.pins));
+    }
+}
+
+BENCH(stm32xx__gpio, chains__configure)
+{
+  const input* in = inputs();
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      const input& x = in[i & 1023];
+      port.CRL = (port.CRL & ~chain_crl_mask(x.pins))
+               | chain_crl_bits(x.pins, x.mode, x.speed);
+      port.CRH = (port.CRH & ~chain_crh_mask(x.pins))
+               | chain_crh_bits(x.pins, x.mode, x.speed);
+    }
+}
+
+BENCH(stm32xx__gpio, rt__configure)
+{
+  using namespace stm32xx::gpio;
+  const input* in = inputs();
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      const input& x = in[i & 1023];
+      rt::configure(&port, x.pins, x.mode, x.speed);
+    }
+}
+
+/*
+ * Switching USART1 TX/RX (PA9, PA10) between alternate function and GPIO,
+ * with LEDs on PA0, PA1: rewriting the whole configuration ("port_conf")
+ * versus writing only what changes ("transition").
+ */
+namespace {
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::port_conf;
+typedef pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> leds;
+typedef pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> usart;
+typedef pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> bitbang;
+typedef port_conf<leds, usart> usart_mode;
+typedef port_conf<leds, bitbang> bitbang_mode;
+}
+
+BENCH(stm32xx__gpio, ct__port_conf__switch)
+{
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      bitbang_mode::in(port);
+      usart_mode::in(port);
+    }
+  bench::keep(port.CRH);
+}
+
+BENCH(stm32xx__gpio, ct__transition__switch)
+{
+  using stm32xx::gpio::ct::transition;
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      transition<usart_mode, bitbang_mode>::in(port);
+      transition<bitbang_mode, usart_mode>::in(port);
+    }
+  bench::keep(port.CRH);
+}
+
+/*
+ * Switching PA9, PA10 between three roles chosen at run time: computing
+ * the configuration with gpio::detail ("rt::configure") versus looking
+ * it up in a compile-time table ("config_set").
+ */
+namespace {
+typedef pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_IN_FLOATING> hiz;
+
+struct role
+{
+  uint16_t pins;
+  GPIOMode_TypeDef mode;
+  GPIOSpeed_TypeDef speed;
+};
+
+const role roles[3] = {
+  { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz },
+  { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz },
+  { GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_IN_FLOATING, (GPIOSpeed_TypeDef)0 }
+};
+
+/* Pseudo-random sequence of role indices */
+const uint8_t*
+role_indices()
+{
+  static uint8_t in[1024];
+  static bool ready = false;
+  if(!ready)
+    {
+      uint32_t x = 12345;
+      for(uint8_t& i : in)
+        {
+          x = x * 1103515245ul + 12345ul;
+          i = (x >> 16) % 3u;
+        }
+      ready = true;
+    }
+  return in;
+}
+}
+
+BENCH(stm32xx__gpio, rt__configure__roles)
+{
+  using namespace stm32xx::gpio;
+  const uint8_t* in = role_indices();
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      const role& r = roles[in[i & 1023]];
+      rt::configure(&port, r.pins, r.mode, r.speed);
+    }
+  bench::keep(port.CRH);
+}
+
+BENCH(stm32xx__gpio, ct__config_set__in)
+{
+  using stm32xx::gpio::ct::config_set;
+  const uint8_t* in = role_indices();
+  GPIO_TypeDef port = GPIO_TypeDef();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    config_set<usart, bitbang, hiz>::in(port, in[i & 1023]);
+  bench::keep(port.CRH);
+}
+
+/*
+ * Per-function benchmarks over all 65536 pin masks: the original ternary
+ * chains ("chains") versus current gpio::detail ("detail").
+ */
+#define GPIO_BENCH_ALL_PIN_MASKS(name, chain_expr, detail_expr)            \
+  BENCH(stm32xx__gpio__all_pin_masks, chains__##name)                      \
+  {                                                                        \
+    const input* in = inputs();                                            \
+    for(uint32_t i = 0; i < state.iterations; ++i)                         \
+      {                                                                    \
+        const uint32_t pins = i & 0xFFFFul;                                \
+        const GPIOMode_TypeDef mode = in[i & 1023].mode;                   \
+        const GPIOSpeed_TypeDef speed = in[i & 1023].speed;                \
+        (void)mode; (void)speed;                                           \
+        bench::keep(chain_expr);                                           \
+      }                                                                    \
+  }                                                                        \
+  BENCH(stm32xx__gpio__all_pin_masks, detail__##name)                      \
+  {                                                                        \
+    using namespace stm32xx::gpio::detail;                                 \
+    const input* in = inputs();                                            \
+    for(uint32_t i = 0; i < state.iterations; ++i)                         \
+      {                                                                    \
+        const stm32xx::gpio::pins_t pins = i & 0xFFFFul;                   \
+        const GPIOMode_TypeDef mode = in[i & 1023].mode;                   \
+        const GPIOSpeed_TypeDef speed = in[i & 1023].speed;                \
+        (void)mode; (void)speed;                                           \
+        bench::keep(detail_expr);                                          \
+      }                                                                    \
+  }
+
+GPIO_BENCH_ALL_PIN_MASKS(crl_cnf_bits,  chain_cnf(pins, mode & 0x0Cul),
+                                        crl_cnf_bits(pins, mode))
+GPIO_BENCH_ALL_PIN_MASKS(crl_cnf_mask,  chain_cnf(pins, 0x0Cul),
+                                        crl_cnf_mask(pins))
+GPIO_BENCH_ALL_PIN_MASKS(crl_mode_bits, chain_cnf(pins, speed & 0x03ul),
+                                        crl_mode_bits(pins, speed))
+GPIO_BENCH_ALL_PIN_MASKS(crl_mode_mask, chain_cnf(pins, 0x03ul),
+                                        crl_mode_mask(pins))
+GPIO_BENCH_ALL_PIN_MASKS(crh_cnf_bits,  chain_cnf(pins >> 8, mode & 0x0Cul),
+                                        crh_cnf_bits(pins, mode))
+GPIO_BENCH_ALL_PIN_MASKS(crh_cnf_mask,  chain_cnf(pins >> 8, 0x0Cul),
+                                        crh_cnf_mask(pins))
+GPIO_BENCH_ALL_PIN_MASKS(crh_mode_bits, chain_cnf(pins >> 8, speed & 0x03ul),
+                                        crh_mode_bits(pins, speed))
+GPIO_BENCH_ALL_PIN_MASKS(crh_mode_mask, chain_cnf(pins >> 8, 0x03ul),
+                                        crh_mode_mask(pins))
+
+#undef GPIO_BENCH_ALL_PIN_MASKS
+
+/*
+ * The remaining gpio::detail functions, one benchmark each.
+ */
+#define GPIO_BENCH_DETAIL(name, expr)                                      \
+  BENCH(stm32xx__gpio__detail, name)                                       \
+  {                                                                        \
+    using namespace stm32xx::gpio::detail;                                 \
+    const input* in = inputs();                                            \
+    for(uint32_t i = 0; i < state.iterations; ++i)                         \
+      {                                                                    \
+        const input& x = in[i & 1023];                                     \
+        bench::keep(expr);                                                 \
+      }                                                                    \
+  }
+
+GPIO_BENCH_DETAIL(crl_nibbles,  crl_nibbles(x.pins))
+GPIO_BENCH_DETAIL(crh_nibbles,  crh_nibbles(x.pins))
+GPIO_BENCH_DETAIL(cnf_mode,     cnf_mode(x.mode, x.speed))
+GPIO_BENCH_DETAIL(crl_bits,     crl_bits(x.pins, x.mode, x.speed))
+GPIO_BENCH_DETAIL(crl_mask,     crl_mask(x.pins))
+GPIO_BENCH_DETAIL(crh_bits,     crh_bits(x.pins, x.mode, x.speed))
+GPIO_BENCH_DETAIL(crh_mask,     crh_mask(x.pins))
+
+#undef GPIO_BENCH_DETAIL
+#endif /* STM32_FAMILY_STM32F10X */
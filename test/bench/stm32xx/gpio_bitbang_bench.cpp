@@ -0,0 +1,107 @@
+#include <stm32xx/gpio_bitbang.hpp>
+#include <bench.hpp>
+
+namespace {
+
+/* Host memory standing for a GPIO port, accessed as gpio::bitbang does */
+volatile uint32_t port[8];
+
+struct host_port
+{
+  static uint32_t read(uint32_t addr) { return port[(addr >> 2) & 7]; }
+  static void write(uint32_t addr, uint32_t v) { port[(addr >> 2) & 7] = v; }
+};
+
+using stm32xx::gpio::detail::odr_offset;
+using stm32xx::gpio::detail::idr_offset;
+using stm32xx::gpio::bitbang::no_delay;
+
+using stm32xx::gpio::ct::pin_conf;
+#if defined STM32_FAMILY_STM32F10X
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN_FLOATING> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> tx;
+#elif defined STM32_FAMILY_STM32F4XX
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> tx;
+#endif
+
+typedef stm32xx::gpio::bitbang::spi<GPIOB_BASE, sck, mosi, miso, 0, 0,
+                                    no_delay, host_port> spi;
+typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda, no_delay,
+                                    host_port> i2c;
+typedef stm32xx::gpio::bitbang::uart_tx<GPIOB_BASE, tx, no_delay,
+                                        host_port> uart;
+
+/* Run time pin masks, as usually passed to hand-written loops */
+volatile uint32_t sck_pin = sck::pins;
+volatile uint32_t mosi_pin = mosi::pins;
+volatile uint32_t miso_pin = miso::pins;
+
+/* Baseline: SPI mode 0 with a GPIOx_ODR read-modify-write per edge and a
+ * test of GPIOx_IDR per bit */
+inline uint8_t
+naive_spi_transfer(uint8_t out)
+{
+  const uint32_t sck_m = sck_pin, mosi_m = mosi_pin, miso_m = miso_pin;
+  uint8_t in = 0;
+  for(int b = 7; b >= 0; --b)
+    {
+      uint32_t odr = host_port::read(GPIOB_BASE + odr_offset);
+      odr = (out & (1u << b)) ? (odr | mosi_m) : (odr & ~mosi_m);
+      host_port::write(GPIOB_BASE + odr_offset, odr);
+      host_port::write(GPIOB_BASE + odr_offset,
+                       host_port::read(GPIOB_BASE + odr_offset) | sck_m);
+      if(host_port::read(GPIOB_BASE + idr_offset) & miso_m)
+        in |= (uint8_t)(1u << b);
+      host_port::write(GPIOB_BASE + odr_offset,
+                       host_port::read(GPIOB_BASE + odr_offset) & ~sck_m);
+    }
+  return in;
+}
+
+/* SCL must read high for the I2C master to proceed */
+inline void
+release_lines()
+{
+  port[(idr_offset >> 2) & 7] = 0xFFFFul;
+}
+
+} /* anonymous namespace */
+
+BENCH(stm32xx__gpio__bitbang, naive_spi__transfer)
+{
+  release_lines();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    bench::keep(naive_spi_transfer((uint8_t)i));
+}
+
+BENCH(stm32xx__gpio__bitbang, spi__transfer)
+{
+  release_lines();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    bench::keep(spi::transfer((uint8_t)i));
+}
+
+BENCH(stm32xx__gpio__bitbang, i2c__write)
+{
+  release_lines();
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    bench::keep(i2c::write((uint8_t)i));
+}
+
+BENCH(stm32xx__gpio__bitbang, uart__write)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    uart::write((uint8_t)i);
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
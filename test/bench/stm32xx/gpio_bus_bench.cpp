@@ -0,0 +1,160 @@
+#include <stm32xx/gpio_bus.hpp>
+#include <bench.hpp>
+
+namespace {
+
+/* Host memory standing for a GPIO port, accessed as gpio::ct::bus does */
+volatile uint32_t port[8];
+
+struct host_port
+{
+  static uint32_t read(uint32_t addr) { return port[(addr >> 2) & 7]; }
+  static void write(uint32_t addr, uint32_t v) { port[(addr >> 2) & 7] = v; }
+};
+
+using stm32xx::gpio::ct::bus;
+using stm32xx::gpio::detail::odr_offset;
+using stm32xx::gpio::detail::bsrr_offset;
+using stm32xx::gpio::detail::idr_offset;
+
+typedef bus<GPIOB_BASE, 0, 1, 2, 3, 4, 5, 6, 7> low8;
+typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+
+/* Baseline: one GPIOx_ODR read-modify-write per bit */
+template <typename _Bus>
+inline void
+naive_odr(uint32_t value)
+{
+  for(unsigned i = 0; i < _Bus::width; ++i)
+    {
+      const uint32_t pin = 1ul << _Bus::map::pins[i];
+      const uint32_t odr = host_port::read(_Bus::port + odr_offset);
+      host_port::write(_Bus::port + odr_offset,
+                       ((value >> i) & 1ul) ? (odr | pin) : (odr & ~pin));
+    }
+}
+
+/* Baseline: per-bit shifts and ORs, then one GPIOx_BSRR store */
+template <typename _Bus>
+inline void
+naive_bsrr(uint32_t value)
+{
+  uint32_t set = 0, reset = 0;
+  for(unsigned i = 0; i < _Bus::width; ++i)
+    {
+      if((value >> i) & 1ul)
+        set |= 1ul << _Bus::map::pins[i];
+      else
+        reset |= 1ul << _Bus::map::pins[i];
+    }
+  host_port::write(_Bus::port + bsrr_offset, set | (reset << 16));
+}
+
+/* Baseline: one GPIOx_IDR load and test per bit, as with
+ * GPIO_ReadInputDataBit() */
+template <typename _Bus>
+inline uint32_t
+naive_idr_per_bit()
+{
+  uint32_t value = 0;
+  for(unsigned i = 0; i < _Bus::width; ++i)
+    if(host_port::read(_Bus::port + idr_offset) & (1ul << _Bus::map::pins[i]))
+      value |= 1ul << i;
+  return value;
+}
+
+/* Baseline: one GPIOx_IDR load, then a test per bit */
+template <typename _Bus>
+inline uint32_t
+naive_idr(uint32_t idr)
+{
+  uint32_t value = 0;
+  for(unsigned i = 0; i < _Bus::width; ++i)
+    if(idr & (1ul << _Bus::map::pins[i]))
+      value |= 1ul << i;
+  return value;
+}
+
+using stm32xx::gpio::ct::multi_bus;
+
+typedef multi_bus< bus<GPIOA_BASE, 8, 9, 10, 11, 12, 13>,
+                   bus<GPIOC_BASE, 6, 7, 8, 9>,
+                   bus<GPIOA_BASE, 1, 0> > two_ports12;
+
+/* IDR changes between reads, so nothing is hoisted out of the loops */
+inline void
+next_idr(uint32_t i)
+{
+  port[(idr_offset >> 2) & 7] = i * 0x9E3779B9ul;
+}
+
+} /* anonymous namespace */
+
+#define GPIO_BUS_BENCH_WRITE(name)                                          \
+  BENCH(stm32xx__gpio__bus, naive_odr__##name)                              \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      naive_odr<name>(i * 0x9E3779B9ul);                                    \
+  }                                                                         \
+  BENCH(stm32xx__gpio__bus, naive_bsrr__##name)                             \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      naive_bsrr<name>(i * 0x9E3779B9ul);                                   \
+  }                                                                         \
+  BENCH(stm32xx__gpio__bus, write__##name)                                  \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      name::write<host_port>(i * 0x9E3779B9ul);                             \
+  }
+
+GPIO_BUS_BENCH_WRITE(low8)
+GPIO_BUS_BENCH_WRITE(lcd8)
+GPIO_BUS_BENCH_WRITE(shuffled16)
+
+#undef GPIO_BUS_BENCH_WRITE
+
+#define GPIO_BUS_BENCH_READ(name)                                           \
+  BENCH(stm32xx__gpio__bus, naive_idr_per_bit__##name)                      \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      {                                                                     \
+        next_idr(i);                                                        \
+        bench::keep(naive_idr_per_bit<name>());                             \
+      }                                                                     \
+  }                                                                         \
+  BENCH(stm32xx__gpio__bus, naive_idr__##name)                              \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      {                                                                     \
+        next_idr(i);                                                        \
+        const uint32_t idr = host_port::read(name::port + idr_offset);      \
+        bench::keep(naive_idr<name>(idr));                                  \
+      }                                                                     \
+  }                                                                         \
+  BENCH(stm32xx__gpio__bus, read__##name)                                   \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      {                                                                     \
+        next_idr(i);                                                        \
+        bench::keep(name::read<host_port>());                               \
+      }                                                                     \
+  }
+
+GPIO_BUS_BENCH_READ(low8)
+GPIO_BUS_BENCH_READ(lcd8)
+GPIO_BUS_BENCH_READ(shuffled16)
+
+#undef GPIO_BUS_BENCH_READ
+
+BENCH(stm32xx__gpio__bus, read__two_ports12)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      next_idr(i);
+      bench::keep(two_ports12::read<host_port>());
+    }
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,88 @@
+#include <stm32xx/gpio_debounce.hpp>
+#include <bench.hpp>
+
+namespace {
+
+/* Host memory standing for GPIOx_IDR of two ports */
+volatile uint32_t idr[2];
+
+struct host_ports
+{
+  static uint32_t read(uint32_t addr) { return idr[(addr >> 10) & 1]; }
+  static void write(uint32_t, uint32_t) { }
+};
+
+using stm32xx::gpio::debounce;
+using stm32xx::gpio::detail::idr_offset;
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::pin_conf_on_port;
+
+#if defined STM32_FAMILY_STM32F10X
+typedef pin_conf<GPIO_Pin_All, GPIO_Mode_IPU> buttons;
+#elif defined STM32_FAMILY_STM32F4XX
+typedef pin_conf<GPIO_Pin_All, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP> buttons;
+#endif
+typedef pin_conf_on_port<GPIOA_BASE, buttons> port_a;
+typedef pin_conf_on_port<GPIOB_BASE, buttons> port_b;
+
+/* Baseline: one GPIOx_IDR load and a state machine per pin */
+struct naive_pin
+{
+  uint8_t count;
+  bool state;
+  bool pressed;
+};
+
+naive_pin naive_pins[32];
+
+inline void
+naive_tick()
+{
+  for(unsigned i = 0; i < 32u; ++i)
+    {
+      const uint32_t port = (i < 16u) ? GPIOA_BASE : GPIOB_BASE;
+      const bool active = ((host_ports::read(port + idr_offset) >> (i & 15u)) & 1ul) == 0ul;
+      naive_pin& p = naive_pins[i];
+      p.pressed = false;
+      if(active == p.state)
+        p.count = 0;
+      else if(++p.count == 4)
+        {
+          p.count = 0;
+          p.state = active;
+          p.pressed = active;
+        }
+    }
+}
+
+/* Change some input levels */
+inline void
+next_idr(uint32_t i)
+{
+  idr[i & 1] = (i * 0x9E3779B9ul) >> 16;
+}
+}
+
+BENCH(stm32xx__gpio__debounce, naive_tick__32_pins)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      next_idr(i);
+      naive_tick();
+      bench::keep(naive_pins[i & 31].pressed);
+    }
+}
+
+BENCH(stm32xx__gpio__debounce, tick__32_pins)
+{
+  debounce<port_a, port_b> d;
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      next_idr(i);
+      d.tick<host_ports>();
+      bench::keep(d.pressed<port_a>() | d.pressed<port_b>());
+    }
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
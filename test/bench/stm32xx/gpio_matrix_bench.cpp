@@ -0,0 +1,90 @@
+#include <stm32xx/gpio_matrix.hpp>
+#include <bench.hpp>
+
+namespace {
+
+/* Host memory standing for GPIOx_IDR and GPIOx_ODR of two ports */
+volatile uint32_t idr[2];
+volatile uint32_t odr[2];
+
+struct host_ports
+{
+  static uint32_t read(uint32_t addr) { return idr[(addr >> 10) & 1]; }
+  static void write(uint32_t addr, uint32_t v) { odr[(addr >> 10) & 1] = v; }
+};
+
+using stm32xx::gpio::matrix;
+using stm32xx::gpio::ct::bus;
+using stm32xx::gpio::detail::idr_offset;
+using stm32xx::gpio::detail::bsrr_offset;
+
+/* 8x8 keyboard, rows on PB8..PB15, columns on PA0..PA7 */
+typedef bus<GPIOB_BASE, 8, 9, 10, 11, 12, 13, 14, 15> rows;
+typedef bus<GPIOA_BASE, 0, 1, 2, 3, 4, 5, 6, 7> cols;
+
+/* Baseline: a loop over the rows, a GPIOx_IDR load and a state machine
+ * per key */
+struct naive_key
+{
+  uint8_t count;
+  bool state;
+  bool pressed;
+};
+
+naive_key naive_keys[64];
+
+inline void
+naive_scan()
+{
+  for(unsigned r = 0; r < 8u; ++r)
+    {
+      host_ports::write(GPIOB_BASE + bsrr_offset, (0x100ul << r) << 16);
+      for(unsigned c = 0; c < 8u; ++c)
+        {
+          const bool down = ((host_ports::read(GPIOA_BASE + idr_offset) >> c) & 1ul) == 0ul;
+          naive_key& k = naive_keys[r * 8u + c];
+          k.pressed = false;
+          if(down == k.state)
+            k.count = 0;
+          else if(++k.count == 4)
+            {
+              k.count = 0;
+              k.state = down;
+              k.pressed = down;
+            }
+        }
+      host_ports::write(GPIOB_BASE + bsrr_offset, 0x100ul << r);
+    }
+}
+
+/* Change some column levels */
+inline void
+next_idr(uint32_t i)
+{
+  idr[0] = (i * 0x9E3779B9ul) >> 16;
+}
+}
+
+BENCH(stm32xx__gpio__matrix, naive_scan__64_keys)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      next_idr(i);
+      naive_scan();
+      bench::keep(naive_keys[i & 63].pressed);
+    }
+}
+
+BENCH(stm32xx__gpio__matrix, scan__64_keys)
+{
+  matrix<rows, cols> m;
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      next_idr(i);
+      m.scan<host_ports>();
+      bench::keep(m.pressed());
+    }
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
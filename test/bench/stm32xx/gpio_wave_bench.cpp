@@ -0,0 +1,68 @@
+#include <stm32xx/gpio_wave.hpp>
+#include <bench.hpp>
+
+namespace {
+
+using stm32xx::gpio::ct::bus;
+using stm32xx::gpio::wave::encoder;
+
+typedef bus<GPIOB_BASE, 12, 13, 14, 15> steppers;
+typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+
+/* 8 samples per channel at a time, as wave::stream asks for them */
+uint8_t bytes[16];
+uint32_t words[8];
+
+/* Baseline: one bus::bsrr() per sample, bits picked one by one */
+template <typename _Bus>
+inline void
+naive_encode8(const uint8_t* in, uint32_t* out)
+{
+  for(unsigned k = 0; k < 8; ++k)
+    {
+      uint32_t value = 0;
+      for(unsigned c = 0; c < _Bus::width; ++c)
+        value |= (uint32_t)((in[c] >> k) & 1u) << c;
+      out[k] = _Bus::bsrr(value);
+    }
+}
+
+/* Input changes between iterations, so nothing is hoisted out of loops */
+inline void
+next_bytes(uint32_t i)
+{
+  for(unsigned c = 0; c < 16; ++c)
+    bytes[c] = (uint8_t)((i + c) * 0x9E3779B9ul >> 24);
+}
+
+} /* anonymous namespace */
+
+#define GPIO_WAVE_BENCH_ENCODE(name)                                        \
+  BENCH(stm32xx__gpio__wave, naive_encode8__##name)                         \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      {                                                                     \
+        next_bytes(i);                                                      \
+        naive_encode8<name>(bytes, words);                                  \
+        bench::keep(words[7]);                                              \
+      }                                                                     \
+  }                                                                         \
+  BENCH(stm32xx__gpio__wave, encode8__##name)                               \
+  {                                                                         \
+    for(uint32_t i = 0; i < state.iterations; ++i)                          \
+      {                                                                     \
+        next_bytes(i);                                                      \
+        encoder<name>::encode8(bytes, words);                               \
+        bench::keep(words[7]);                                              \
+      }                                                                     \
+  }
+
+GPIO_WAVE_BENCH_ENCODE(steppers)
+GPIO_WAVE_BENCH_ENCODE(lcd8)
+GPIO_WAVE_BENCH_ENCODE(shuffled16)
+
+#undef GPIO_WAVE_BENCH_ENCODE
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
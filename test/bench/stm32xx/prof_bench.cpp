@@ -0,0 +1,45 @@
+#include <stm32xx/prof.hpp>
+#include <bench.hpp>
+
+namespace {
+
+/* Clock as cheap as DWT_CYCCNT: a load from memory */
+volatile uint32_t counter;
+
+struct memory_clock
+{
+  static uint32_t now() { return counter; }
+};
+
+stm32xx::prof::probe probe("bench");
+
+} /* anonymous namespace */
+
+/* Cost of a probe without the clock reads: one stats::add() per iteration */
+BENCH(stm32xx__prof, stats__add)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    probe.add(i & 0xFFFul);
+}
+
+/* Cost of a probe with a clock read from memory (as DWT_CYCCNT on target) */
+BENCH(stm32xx__prof, scoped_timer__memory_clock)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      stm32xx::prof::scoped_timer<memory_clock> timer(probe);
+      counter = i;
+    }
+}
+
+/* Cost of a probe with the host stand-in clock */
+BENCH(stm32xx__prof, scoped_timer__host_clock)
+{
+  for(uint32_t i = 0; i < state.iterations; ++i)
+    {
+      stm32xx::prof::scoped_timer<stm32xx::prof::host_clock> timer(probe);
+    }
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,150 @@
+/* Object code check for the default (null) bits::access_hook.
+ *
+ * This file is compiled twice with optimization: as is, and with
+ * STM32XX_OBJCODE_REFERENCE defined. The reference variant contains the
+ * same functions written with plain register accesses. The build compares
+ * disassembly of both objects and fails if they differ, i.e. if the hook
+ * calls added to the library leave any trace in the generated code. */
+#include <stm32xx/gpio.hpp>
+
+#if defined(STM32XX_OBJCODE_REFERENCE)
+
+#if defined(STM32_FAMILY_STM32F4XX)
+/* StdPeriph declares BSRR as two 16-bit halves on STM32F4xx */
+# define PORT_BSRR(port) (*reinterpret_cast<volatile uint32_t*>(&(port).BSRRL))
+#else
+# define PORT_BSRR(port) ((port).BSRR)
+#endif
+
+void ct_modify_in(volatile uint32_t& x)
+{
+  x = (x & ~0x0000FF00ul) | 0x00001200ul;
+}
+
+void ct_modify_in_full_mask(volatile uint32_t& x)
+{
+  x = 0x12345678ul;
+}
+
+void ct_modify_at()
+{
+  volatile uint32_t& x = *reinterpret_cast<volatile uint32_t*>(0x60000004ul);
+  x = (x & ~0x000000F0ul) | 0x00000010ul;
+}
+
+void ct_modify_at_bitband()
+{
+  *reinterpret_cast<volatile uint32_t*>(0x42420308ul) = 1ul;
+}
+
+bool ct_test_bit_in(volatile uint32_t& x)
+{
+  return ((x >> 3) & 1ul) != 0ul;
+}
+
+bool ct_test_bit_at()
+{
+  return *reinterpret_cast<volatile uint32_t*>(0x4242030Cul) != 0ul;
+}
+
+void rt_modify(volatile uint32_t& x, uint32_t bits, uint32_t mask)
+{
+  x = (x & ~mask) | bits;
+}
+
+void gpio_ct_write(GPIO_TypeDef& port)
+{
+  PORT_BSRR(port) = 0x00080004ul;
+}
+
+void gpio_ct_toggle(GPIO_TypeDef& port)
+{
+  const uint32_t odr = port.ODR;
+  PORT_BSRR(port) = (~odr & 0x0003ul) | ((odr & 0x0003ul) << 16);
+}
+
+void gpio_rt_write(GPIO_TypeDef* port, uint16_t set_pins, uint16_t reset_pins)
+{
+  PORT_BSRR(*port) = (uint32_t)set_pins | ((uint32_t)reset_pins << 16);
+}
+
+/* Same shape as gpio::rt::toggle(), GCC allocates registers differently
+ * for the non-template version */
+template <typename _Port>
+inline void
+toggle(_Port* port, uint16_t pins)
+{
+  const uint32_t odr = port->ODR;
+  PORT_BSRR(*port) = (~odr & pins) | ((odr & pins) << 16);
+}
+
+void gpio_rt_toggle(GPIO_TypeDef* port, uint16_t pins)
+{
+  toggle(port, pins);
+}
+
+#else /* !STM32XX_OBJCODE_REFERENCE */
+
+using namespace stm32xx;
+
+void ct_modify_in(volatile uint32_t& x)
+{
+  bits::ct::modify<bits::ct::masked<0x00001200ul, 0x0000FF00ul> >::in(x);
+}
+
+void ct_modify_in_full_mask(volatile uint32_t& x)
+{
+  bits::ct::modify<bits::ct::masked<0x12345678ul, 0xFFFFFFFFul> >::in(x);
+}
+
+void ct_modify_at()
+{
+  bits::ct::modify<bits::ct::masked<0x00000010ul, 0x000000F0ul> >
+    ::at<0x60000004ul>();
+}
+
+void ct_modify_at_bitband()
+{
+  bits::ct::modify<bits::ct::masked<0x00000004ul, 0x00000004ul> >
+    ::at<0x40021018ul>();
+}
+
+bool ct_test_bit_in(volatile uint32_t& x)
+{
+  return bits::ct::test_bit<3>::in(x);
+}
+
+bool ct_test_bit_at()
+{
+  return bits::ct::test_bit<3>::at<0x40021018ul>();
+}
+
+void rt_modify(volatile uint32_t& x, uint32_t b, uint32_t m)
+{
+  bits::rt::modify(x, b, m);
+}
+
+void gpio_ct_write(GPIO_TypeDef& port)
+{
+  gpio::ct::write<GPIO_Pin_2, GPIO_Pin_3>::in(port);
+}
+
+void gpio_ct_toggle(GPIO_TypeDef& port)
+{
+  gpio::ct::toggle<GPIO_Pin_0|GPIO_Pin_1>::in(port);
+}
+
+void gpio_rt_write(GPIO_TypeDef* port, uint16_t set_pins, uint16_t reset_pins)
+{
+  gpio::rt::write(port, set_pins, reset_pins);
+}
+
+void gpio_rt_toggle(GPIO_TypeDef* port, uint16_t pins)
+{
+  gpio::rt::toggle(port, pins);
+}
+
+#endif /* STM32XX_OBJCODE_REFERENCE */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,49 @@
+/* Object code check for disabled profiling (see stm32xx/prof.hpp).
+ *
+ * This file is compiled twice with optimization and without STM32XX_PROF:
+ * as is, and with STM32XX_OBJCODE_REFERENCE defined. The reference variant
+ * contains the same functions without the profiling macros. The build
+ * compares disassembly of both objects and fails if they differ, i.e. if
+ * the disabled probes leave any trace in the generated code. */
+#include <stm32xx/gpio_bus.hpp>
+#include <stm32xx/prof.hpp>
+
+#if defined(STM32XX_PROF)
+# error "null_prof.cpp must be compiled with profiling disabled"
+#endif
+
+typedef stm32xx::gpio::ct::bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+
+#if defined(STM32XX_OBJCODE_REFERENCE)
+
+void lcd_write(uint32_t value)
+{
+  lcd8::write(value);
+}
+
+uint32_t lcd_read()
+{
+  return lcd8::read();
+}
+
+#else /* STM32XX_OBJCODE_REFERENCE */
+
+STM32XX_PROF_PROBE(lcd_write);
+STM32XX_PROF_EXTERN_PROBE(lcd_read);
+
+void lcd_write(uint32_t value)
+{
+  STM32XX_PROF_SCOPE(lcd_write);
+  lcd8::write(value);
+}
+
+uint32_t lcd_read()
+{
+  STM32XX_PROF_SCOPE(lcd_read);
+  return lcd8::read();
+}
+
+#endif /* STM32XX_OBJCODE_REFERENCE */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
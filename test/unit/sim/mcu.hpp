@@ -0,0 +1,349 @@
+/** // doc: sim/mcu.hpp {{{
+ * \file sim/mcu.hpp
+ * \brief Host-side simulated peripheral register file.
+ *
+ * Simulated GPIO and RCC register blocks, laid out as @c GPIO_TypeDef and
+ * @c RCC_TypeDef, with reset values from the reference manual. Every bus
+ * read and write of a register is counted, so unit tests can check how
+ * many accesses an operation really costs. The library code works with the
+ * simulated registers unchanged, e.g.:
+ *
+ * @code
+ * sim::mcu& m = sim::instance();
+ * m.reset();
+ * gpio::ct::port_conf<leds, buttons>::in(m.gpiob);
+ * CHECK_EQUAL(2u, m.gpiob.reads());
+ * @endcode
+ *
+ * Address based operations (bits::ct::modify<>::at<>()) reach the
+ * simulated registers through the sim::access policy, which also decodes
+ * bit-band alias addresses.
+ *
+ * @see ST RM0008 Reference manual (STM32F10x) for reset values.
+ */ // }}}
+#ifndef SIM_MCU_HPP_INCLUDED
+#define SIM_MCU_HPP_INCLUDED
+
+#include <stm32xx/stm32fxxx.h>
+#include <cstdint>
+
+namespace sim {
+
+/** // doc: sim::reg {{{
+ * @brief Simulated 32-bit register counting bus accesses.
+ */ // }}}
+struct reg
+{
+  uint32_t value;
+  uint32_t reset_value;
+  unsigned reads;
+  unsigned writes;
+
+  explicit reg(uint32_t rv = 0ul)
+    : value(rv), reset_value(rv), reads(0), writes(0)
+  {
+  }
+
+  /* Bus read */
+  operator uint32_t()
+  {
+    ++reads;
+    return load();
+  }
+
+  /* Bus write */
+  reg& operator=(uint32_t x)
+  {
+    ++writes;
+    store(x);
+    return *this;
+  }
+
+  reg& operator|=(uint32_t x) { return *this = uint32_t(*this) | x; }
+  reg& operator&=(uint32_t x) { return *this = uint32_t(*this) & x; }
+  reg& operator^=(uint32_t x) { return *this = uint32_t(*this) ^ x; }
+
+  /* Apply reset value and clear counters */
+  void reset()
+  {
+    value = reset_value;
+    clear();
+  }
+
+  /* Clear counters */
+  void clear()
+  {
+    reads = writes = 0;
+  }
+
+  /* Hardware behaviour of the register, overriden by special registers */
+  virtual uint32_t load() const
+  {
+    return value;
+  }
+  virtual void store(uint32_t x)
+  {
+    value = x;
+  }
+
+  virtual ~reg() {}
+
+private:
+  reg(reg const&);
+};
+
+#if defined STM32_FAMILY_STM32F10X
+/** // doc: sim::bsrr_reg {{{
+ * @brief Simulated GPIOx_BSRR/GPIOx_BRR, applying writes to GPIOx_ODR.
+ */ // }}}
+struct bsrr_reg : reg
+{
+  reg& odr;
+  unsigned shift;   /* 0 for BSRR, 16 for BRR */
+
+  bsrr_reg(reg& o, unsigned s) : odr(o), shift(s) {}
+  using reg::operator=;
+
+  uint32_t load() const
+  {
+    return 0ul;
+  }
+  void store(uint32_t x)
+  {
+    x <<= shift;
+    odr.value = (odr.value & ~(x >> 16)) | (x & 0xFFFFul);
+  }
+};
+
+/** // doc: sim::gpio_regs {{{
+ * @brief Simulated GPIO port (STM32F10x layout).
+ */ // }}}
+struct gpio_regs
+{
+  reg CRL;
+  reg CRH;
+  reg IDR;
+  reg ODR;
+  bsrr_reg BSRR;
+  bsrr_reg BRR;
+  reg LCKR;
+
+  gpio_regs()
+    : CRL(0x44444444ul), CRH(0x44444444ul), IDR(), ODR(),
+      BSRR(ODR, 0), BRR(ODR, 16), LCKR()
+  {
+  }
+
+  reg* find(uint32_t offset)
+  {
+    reg* regs[] = { &CRL, &CRH, &IDR, &ODR, &BSRR, &BRR, &LCKR };
+    return (offset < 4 * 7) ? regs[offset >> 2] : nullptr;
+  }
+
+  template <typename F>
+  void for_each(F f)
+  {
+    for(uint32_t offset = 0; offset < 4 * 7; offset += 4)
+      f(*find(offset));
+  }
+
+  /* Number of bus reads of all the port registers */
+  unsigned reads()
+  {
+    unsigned n = 0;
+    for_each([&n](reg& r) { n += r.reads; });
+    return n;
+  }
+
+  /* Number of bus writes to all the port registers */
+  unsigned writes()
+  {
+    unsigned n = 0;
+    for_each([&n](reg& r) { n += r.writes; });
+    return n;
+  }
+};
+
+/** // doc: sim::rcc_regs {{{
+ * @brief Simulated RCC (STM32F10x layout).
+ */ // }}}
+struct rcc_regs
+{
+  reg CR;
+  reg CFGR;
+  reg CIR;
+  reg APB2RSTR;
+  reg APB1RSTR;
+  reg AHBENR;
+  reg APB2ENR;
+  reg APB1ENR;
+  reg BDCR;
+  reg CSR;
+
+  rcc_regs()
+    : CR(0x00000083ul), CFGR(), CIR(), APB2RSTR(), APB1RSTR(),
+      AHBENR(0x00000014ul), APB2ENR(), APB1ENR(), BDCR(), CSR(0x0C000000ul)
+  {
+  }
+
+  reg* find(uint32_t offset)
+  {
+    reg* regs[] = { &CR, &CFGR, &CIR, &APB2RSTR, &APB1RSTR, &AHBENR,
+                    &APB2ENR, &APB1ENR, &BDCR, &CSR };
+    return (offset < 4 * 10) ? regs[offset >> 2] : nullptr;
+  }
+
+  template <typename F>
+  void for_each(F f)
+  {
+    for(uint32_t offset = 0; offset < 4 * 10; offset += 4)
+      f(*find(offset));
+  }
+};
+
+/** // doc: sim::mcu {{{
+ * @brief Simulated register file of the whole MCU.
+ */ // }}}
+struct mcu
+{
+  gpio_regs gpioa;
+  gpio_regs gpiob;
+  gpio_regs gpioc;
+  gpio_regs gpiod;
+  gpio_regs gpioe;
+  rcc_regs rcc;
+
+  /* Registers at their (MCU) addresses */
+  reg* find(uint32_t addr)
+  {
+    struct { uint32_t base; gpio_regs* port; } const ports[] = {
+      { GPIOA_BASE, &gpioa }, { GPIOB_BASE, &gpiob }, { GPIOC_BASE, &gpioc },
+      { GPIOD_BASE, &gpiod }, { GPIOE_BASE, &gpioe }
+    };
+    for(auto const& p : ports)
+      if(addr >= p.base && addr < p.base + 0x400ul)
+        return p.port->find(addr - p.base);
+    if(addr >= RCC_BASE && addr < RCC_BASE + 0x400ul)
+      return rcc.find(addr - RCC_BASE);
+    return nullptr;
+  }
+
+  /* Apply reset values to all the registers and clear counters */
+  void reset()
+  {
+    for_each([](reg& r) { r.reset(); });
+  }
+
+  /* Clear access counters of all the registers */
+  void clear()
+  {
+    for_each([](reg& r) { r.clear(); });
+  }
+
+  /* Total number of bus reads */
+  unsigned reads()
+  {
+    unsigned n = 0;
+    for_each([&n](reg& r) { n += r.reads; });
+    return n;
+  }
+
+  /* Total number of bus writes */
+  unsigned writes()
+  {
+    unsigned n = 0;
+    for_each([&n](reg& r) { n += r.writes; });
+    return n;
+  }
+
+  template <typename F>
+  void for_each(F f)
+  {
+    gpioa.for_each(f);
+    gpiob.for_each(f);
+    gpioc.for_each(f);
+    gpiod.for_each(f);
+    gpioe.for_each(f);
+    rcc.for_each(f);
+  }
+};
+
+/** // doc: sim::instance() {{{
+ * @brief The simulated MCU.
+ */ // }}}
+inline mcu&
+instance()
+{
+  static mcu m;
+  return m;
+}
+
+/** // doc: sim::access {{{
+ * @brief Memory access policy (see bits::volatile_access) targeting
+ *        sim::instance().
+ *
+ * Accesses to bit-band alias addresses are decoded and applied to the bit
+ * of the target register; they are counted separately (in
+ * @c alias_reads/alias_writes) as they are not read-modify-writes.
+ */ // }}}
+struct access
+{
+  static unsigned& alias_reads()  { static unsigned n = 0; return n; }
+  static unsigned& alias_writes() { static unsigned n = 0; return n; }
+
+  static bool is_alias(uint32_t addr)
+  {
+    return (addr >= 0x42000000ul) && (addr < 0x44000000ul);
+  }
+  static uint32_t alias_target(uint32_t addr)
+  {
+    return 0x40000000ul | ((((addr & 0x01FFFFFFul) >> 5)) & ~3ul);
+  }
+  static unsigned alias_bit(uint32_t addr)
+  {
+    return ((((addr & 0x01FFFFFFul) >> 5) & 3ul) << 3) | ((addr >> 2) & 7ul);
+  }
+
+  static reg& at(uint32_t addr)
+  {
+    static reg unmapped;
+    reg* r = instance().find(addr);
+    return r ? *r : unmapped;
+  }
+
+  static uint32_t read(uint32_t addr)
+  {
+    if(is_alias(addr))
+      {
+        ++alias_reads();
+        return (at(alias_target(addr)).load() >> alias_bit(addr)) & 1ul;
+      }
+    return at(addr);
+  }
+
+  static void write(uint32_t addr, uint32_t value)
+  {
+    if(is_alias(addr))
+      {
+        ++alias_writes();
+        reg& r = at(alias_target(addr));
+        const uint32_t bit = 1ul << alias_bit(addr);
+        r.store((r.load() & ~bit) | ((value & 1ul) ? bit : 0ul));
+        return;
+      }
+    at(addr) = value;
+  }
+
+  static void clear()
+  {
+    alias_reads() = alias_writes() = 0;
+  }
+};
+
+#endif /* STM32_FAMILY_STM32F10X */
+
+} /* namespace sim */
+
+#endif /* SIM_MCU_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
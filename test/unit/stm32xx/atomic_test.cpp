@@ -0,0 +1,169 @@
+#include <stm32xx/atomic.hpp>
+#include <CppUTest/TestHarness.h>
+#include <atomic>
+#include <thread>
+
+namespace {
+using namespace stm32xx::bits;
+using stm32xx::bits::ct::masked;
+using stm32xx::bits::ct::modify;
+
+/* Memory access policy with a modify() counting the atomic modifications */
+struct atomic_memory
+{
+  static uint32_t word;
+  static unsigned reads;
+  static unsigned writes;
+  static unsigned modifies;
+  static uint32_t read(uint32_t) { ++reads; return word; }
+  static void write(uint32_t, uint32_t v) { ++writes; word = v; }
+  static uint32_t modify(uint32_t, uint32_t mask, uint32_t bits)
+  {
+    ++modifies;
+    const uint32_t old = word;
+    word = (old & ~mask) | bits;
+    return old;
+  }
+  static void clear(uint32_t value)
+  {
+    word = value;
+    reads = writes = modifies = 0u;
+  }
+};
+uint32_t atomic_memory::word = 0ul;
+unsigned atomic_memory::reads = 0u;
+unsigned atomic_memory::writes = 0u;
+unsigned atomic_memory::modifies = 0u;
+
+/* Policy _Access counting the read-modify-writes done by its modify_in(),
+ * to check that the stress tests go through the policy and not through
+ * the plain read-modify-write used for policies without modify_in() */
+template <typename _Access>
+struct counted_access
+  : _Access
+{
+  static std::atomic<unsigned> modifies;
+  template <typename T>
+  static uint32_t modify_in(T& x, uint32_t mask, uint32_t bits)
+  {
+    ++modifies;
+    return _Access::modify_in(x, mask, bits);
+  }
+};
+template <typename _Access>
+std::atomic<unsigned> counted_access<_Access>::modifies(0u);
+
+/* Toggle byte _i of w between two values, checking after each
+ * modification that no other thread has overwritten it */
+template <unsigned _i, typename _Access>
+void
+hammer(std::atomic<uint32_t>* w, unsigned iterations, unsigned* lost)
+{
+  typedef masked<0xA5ul << (8u * _i), 0xFFul << (8u * _i)> a;
+  typedef masked<0x5Aul << (8u * _i), 0xFFul << (8u * _i)> b;
+  for(unsigned n = 0; n < iterations; ++n)
+    {
+      modify<a>::template in<_Access>(*w);
+      if(((w->load() >> (8u * _i)) & 0xFFul) != 0xA5ul)
+        ++*lost;
+      modify<b>::template in<_Access>(*w);
+      if(((w->load() >> (8u * _i)) & 0xFFul) != 0x5Aul)
+        ++*lost;
+    }
+}
+
+template <typename _Access>
+unsigned
+stress(std::atomic<uint32_t>& w, unsigned iterations)
+{
+  unsigned lost[4] = { 0u, 0u, 0u, 0u };
+  std::thread t0(hammer<0, _Access>, &w, iterations, &lost[0]);
+  std::thread t1(hammer<1, _Access>, &w, iterations, &lost[1]);
+  std::thread t2(hammer<2, _Access>, &w, iterations, &lost[2]);
+  std::thread t3(hammer<3, _Access>, &w, iterations, &lost[3]);
+  t0.join();
+  t1.join();
+  t2.join();
+  t3.join();
+  return lost[0] + lost[1] + lost[2] + lost[3];
+}
+}
+
+TEST_GROUP(stm32xx__bits__atomic)
+{
+  void setup()
+  {
+    atomic_memory::clear(0x44444444ul);
+  }
+};
+
+TEST(stm32xx__bits__atomic, is_exclusive_address)
+{
+  CHECK(!is_exclusive_address(0x08000000ul));
+  CHECK(is_exclusive_address(0x20000000ul));
+  CHECK(is_exclusive_address(0x2001FFFCul));
+  CHECK(is_exclusive_address(0x3FFFFFFCul));
+  CHECK(!is_exclusive_address(0x40010800ul));
+  CHECK(!is_exclusive_address(0xE000E100ul));
+}
+
+TEST(stm32xx__bits__atomic, modify__at__uses_policy_modify)
+{
+  modify< masked<0x30ul, 0xF0ul> >::at<0x40010800ul, atomic_memory>();
+  CHECK_EQUAL(0x44444434ul, atomic_memory::word);
+  CHECK_EQUAL(1u, atomic_memory::modifies);
+  CHECK_EQUAL(0u, atomic_memory::reads + atomic_memory::writes);
+}
+
+TEST(stm32xx__bits__atomic, modify__at__full_mask_is_a_store)
+{
+  modify< masked<0x12345678ul, 0xFFFFFFFFul> >::at<0x40010800ul, atomic_memory>();
+  CHECK_EQUAL(0x12345678ul, atomic_memory::word);
+  CHECK_EQUAL(0u, atomic_memory::modifies);
+  CHECK_EQUAL(1u, atomic_memory::writes);
+}
+
+TEST(stm32xx__bits__atomic, modify__in__exclusive_access)
+{
+  volatile uint32_t x = 0x44444444ul;
+  modify< masked<0x0Bul, 0x0Ful> >::in<exclusive_access>(x);
+  CHECK_EQUAL(0x4444444Bul, x);
+}
+
+TEST(stm32xx__bits__atomic, modify__in__critical_access)
+{
+  volatile uint32_t x = 0x44444444ul;
+  modify< masked<0x0B00ul, 0x0F00ul> >::in<critical_access<2> >(x);
+  CHECK_EQUAL(0x44444B44ul, x);
+}
+
+TEST(stm32xx__bits__atomic, modify__in__atomic_access)
+{
+  std::atomic<uint32_t> x(0x44444444ul);
+  modify< masked<0x80000000ul, 0xF0000000ul> >::in<atomic_access<> >(x);
+  CHECK_EQUAL(0x84444444ul, x.load());
+}
+
+TEST(stm32xx__bits__atomic, exclusive_access__stress)
+{
+  typedef counted_access<exclusive_access> policy;
+  std::atomic<uint32_t> w(0ul);
+  policy::modifies = 0u;
+  CHECK_EQUAL(0u, stress<policy>(w, 100000u));
+  CHECK_EQUAL(0x5A5A5A5Aul, w.load());
+  /* 4 threads, 2 modifications per iteration, all through the policy */
+  CHECK_EQUAL(8u * 100000u, policy::modifies.load());
+}
+
+TEST(stm32xx__bits__atomic, atomic_access__stress)
+{
+  typedef counted_access<atomic_access<3> > policy;
+  std::atomic<uint32_t> w(0ul);
+  policy::modifies = 0u;
+  CHECK_EQUAL(0u, stress<policy>(w, 100000u));
+  CHECK_EQUAL(0x5A5A5A5Aul, w.load());
+  CHECK_EQUAL(8u * 100000u, policy::modifies.load());
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -79,6 +79,47 @@ TEST(stm32xx__bits__ct, mix__with_two_args)
   CHECK_EQUAL((mix<m1,m2>::mask),  0xFFFFFFFFul);
 }
 
+TEST(stm32xx__bits__ct, mix__with_many_args)
+{
+  using namespace stm32xx::bits::ct;
+  using m0 = masked<0x00000001ul,0x0000000Ful>;
+  using m1 = masked<0x00000020ul,0x000000F0ul>;
+  using m2 = masked<0x00000300ul,0x00000F00ul>;
+  using m3 = masked<0x00004000ul,0x0000F000ul>;
+  using m4 = masked<0x00050000ul,0x000F0000ul>;
+  using m5 = masked<0x00600000ul,0x00F00000ul>;
+  using m6 = masked<0x07000000ul,0x0F000000ul>;
+  using m7 = masked<0x80000000ul,0xF0000000ul>;
+  using z = masked<0ul,0ul>;
+  CHECK_EQUAL((mix<m0,m1,m2,m3,m4,m5,m6,m7>::bits), 0x87654321ul);
+  CHECK_EQUAL((mix<m0,m1,m2,m3,m4,m5,m6,m7>::mask), 0xFFFFFFFFul);
+  CHECK_EQUAL((mix<m7,z,m3,z,z,m5,m0,z,m1>::bits), 0x80604021ul);
+  CHECK_EQUAL((mix<m7,z,m3,z,z,m5,m0,z,m1>::mask), 0xF0F0F0FFul);
+}
+
+TEST(stm32xx__bits__ct, mix__is_constexpr)
+{
+  using namespace stm32xx::bits::ct;
+  using m1 = masked<0x00004321ul,0x0000FFFFul>;
+  using m2 = masked<0x87650000ul,0xFFFF0000ul>;
+  static_assert(mix<m1,m2>::value == 0x87654321ul, "");
+  static_assert(mix<m1,m2>::mask == 0xFFFFFFFFul, "");
+  static_assert(mix<>::mask == 0ul, "");
+}
+
+TEST(stm32xx__bits__ct, delta)
+{
+  using namespace stm32xx::bits::ct;
+  using from = masked<0x00000211ul,0x00000FFFul>;
+  using to = masked<0x00000310ul,0x0000FFF0ul>;
+  static_assert(delta<from,to>::mask == 0x0000F100ul, "");
+  static_assert(delta<from,to>::bits == 0x00000100ul, "");
+  static_assert(delta<from,from>::mask == 0ul, "");
+  static_assert(delta<masked<0ul,0ul>,to>::mask == to::mask, "");
+  static_assert(delta<masked<0ul,0ul>,to>::bits == to::bits, "");
+  static_assert(delta<to,masked<0ul,0ul> >::mask == 0ul, "");
+}
+
 TEST(stm32xx__bits__ct, modify_modifies_only_masked_bits)
 {
   using namespace stm32xx::bits::ct;
@@ -87,3 +128,497 @@ TEST(stm32xx__bits__ct, modify_modifies_only_masked_bits)
   modify<bits>::in(var);
   CHECK_EQUAL(var, 0x12345678ul);
 }
+
+TEST_GROUP(stm32xx__bits__rt)
+{
+};
+
+TEST(stm32xx__bits__rt, modify_modifies_only_masked_bits)
+{
+  using namespace stm32xx::bits::rt;
+  volatile uint32_t var = 0x5678ul;
+  modify(var, 0x12340000ul, 0xFFFF0000ul);
+  CHECK_EQUAL(var, 0x12345678ul);
+}
+
+TEST_GROUP(stm32xx__bits)
+{
+  static uint32_t
+  reference_spread(uint32_t x, unsigned bits, unsigned width)
+  {
+    uint32_t result = 0;
+    for(unsigned n = 0; n < bits; ++n)
+      if(x & (1ul << n))
+        result |= 1ul << (n * width);
+    return result;
+  }
+};
+
+TEST(stm32xx__bits, spread4__is_constexpr)
+{
+  using namespace stm32xx::bits;
+  constexpr uint32_t x = spread4(0x83ul);
+  CHECK_EQUAL(0x10000011ul, x);
+}
+
+TEST(stm32xx__bits, spread4__all_values)
+{
+  using namespace stm32xx::bits;
+  for(uint32_t x = 0; x <= 0xFFFFul; ++x)
+    CHECK_EQUAL(reference_spread(x, 8, 4), spread4(x));
+}
+
+TEST(stm32xx__bits, spread2__is_constexpr)
+{
+  using namespace stm32xx::bits;
+  constexpr uint32_t x = spread2(0x8003ul);
+  CHECK_EQUAL(0x40000005ul, x);
+}
+
+TEST(stm32xx__bits, spread2__all_values)
+{
+  using namespace stm32xx::bits;
+  for(uint32_t x = 0; x <= 0xFFFFul; ++x)
+    CHECK_EQUAL(reference_spread(x, 16, 2), spread2(x));
+}
+
+/*
+ * Host-side stand-in for the Cortex-M3/M4 address space: 64 words of SRAM
+ * (0x20000000), 64 words of peripherals (0x40000000), 64 words outside of
+ * bit-band regions (0x60000000) and bit-band aliases of the first two.
+ */
+struct host_memory
+{
+  struct state
+  {
+    uint32_t sram[64];
+    uint32_t periph[64];
+    uint32_t other[64];
+    unsigned reads;
+    unsigned writes;
+    unsigned alias_reads;
+    unsigned alias_writes;
+  };
+
+  static state& mem()
+  {
+    static state s;
+    return s;
+  }
+
+  static void clear()
+  {
+    mem() = state();
+  }
+
+  static uint32_t& word(uint32_t addr)
+  {
+    uint32_t* base = (addr >= 0x60000000ul) ? mem().other
+                   : (addr >= 0x40000000ul) ? mem().periph
+                   : mem().sram;
+    return base[((addr & 0x0FFFFFFFul) >> 2) & 63];
+  }
+
+  static bool is_alias(uint32_t addr)
+  {
+    return ((addr >= 0x22000000ul) && (addr < 0x24000000ul))
+        || ((addr >= 0x42000000ul) && (addr < 0x44000000ul));
+  }
+
+  /* decode alias address into (word address, bit) */
+  static uint32_t alias_word(uint32_t addr)
+  {
+    return (addr & 0xF0000000ul) | ((((addr & 0x01FFFFFFul) >> 5)) & ~3ul);
+  }
+
+  static unsigned alias_bit(uint32_t addr)
+  {
+    return ((((addr & 0x01FFFFFFul) >> 5) & 3ul) << 3)
+         | ((addr >> 2) & 7ul);
+  }
+
+  static uint32_t read(uint32_t addr)
+  {
+    if(is_alias(addr))
+      {
+        ++mem().alias_reads;
+        return (word(alias_word(addr)) >> alias_bit(addr)) & 1ul;
+      }
+    ++mem().reads;
+    return word(addr);
+  }
+
+  static void write(uint32_t addr, uint32_t value)
+  {
+    if(is_alias(addr))
+      {
+        ++mem().alias_writes;
+        uint32_t& w = word(alias_word(addr));
+        w = (w & ~(1ul << alias_bit(addr))) | ((value & 1ul) << alias_bit(addr));
+        return;
+      }
+    ++mem().writes;
+    word(addr) = value;
+  }
+};
+
+TEST_GROUP(stm32xx__bits__ct__bitband)
+{
+  void setup()
+  {
+    host_memory::clear();
+  }
+};
+
+TEST(stm32xx__bits__ct__bitband, is_single_bit)
+{
+  using namespace stm32xx::bits;
+  CHECK(!is_single_bit(0x00000000ul));
+  CHECK( is_single_bit(0x00000001ul));
+  CHECK( is_single_bit(0x80000000ul));
+  CHECK(!is_single_bit(0x00000003ul));
+}
+
+TEST(stm32xx__bits__ct__bitband, bit_index)
+{
+  using namespace stm32xx::bits;
+  CHECK_EQUAL(0u,  bit_index(0x00000001ul));
+  CHECK_EQUAL(5u,  bit_index(0x00000020ul));
+  CHECK_EQUAL(31u, bit_index(0x80000000ul));
+  CHECK_EQUAL(32u, bit_index(0x00000000ul));
+}
+
+TEST(stm32xx__bits__ct__bitband, bitband_alias)
+{
+  using namespace stm32xx::bits;
+  CHECK(is_bitband_address(0x20000000ul));
+  CHECK(is_bitband_address(0x400FFFFCul));
+  CHECK(!is_bitband_address(0x20100000ul));
+  CHECK(!is_bitband_address(0x60000000ul));
+  /* examples from the Cortex-M3 Technical Reference Manual */
+  CHECK_EQUAL(0x23FFFFE0ul, bitband_alias(0x200FFFFFul, 0));
+  CHECK_EQUAL(0x23FFFFFCul, bitband_alias(0x200FFFFFul, 7));
+  CHECK_EQUAL(0x22000000ul, bitband_alias(0x20000000ul, 0));
+  CHECK_EQUAL(0x2200001Cul, bitband_alias(0x20000000ul, 7));
+  /* RCC->APB2ENR (STM32F10x), bit 3 */
+  CHECK_EQUAL(0x4242030Cul, bitband_alias(0x40021018ul, 3));
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__single_bit_uses_alias)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x40000010ul) = 0x5678ul;
+  modify<masked<0x00010000ul, 0x00010000ul> >::at<0x40000010ul, host_memory>();
+  CHECK_EQUAL(0x00015678ul, host_memory::word(0x40000010ul));
+  modify<masked<0x00000000ul, 0x00000008ul> >::at<0x40000010ul, host_memory>();
+  CHECK_EQUAL(0x00015670ul, host_memory::word(0x40000010ul));
+  CHECK_EQUAL(0u, host_memory::mem().reads);
+  CHECK_EQUAL(0u, host_memory::mem().writes);
+  CHECK_EQUAL(0u, host_memory::mem().alias_reads);
+  CHECK_EQUAL(2u, host_memory::mem().alias_writes);
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__single_bit_in_sram_uses_alias)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x20000004ul) = 0ul;
+  modify<masked<0x80000000ul, 0x80000000ul> >::at<0x20000004ul, host_memory>();
+  CHECK_EQUAL(0x80000000ul, host_memory::word(0x20000004ul));
+  CHECK_EQUAL(0u, host_memory::mem().reads);
+  CHECK_EQUAL(1u, host_memory::mem().alias_writes);
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__many_bits_use_read_modify_write)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x40000010ul) = 0x5678ul;
+  modify<masked<0x12340000ul, 0xFFFF0000ul> >::at<0x40000010ul, host_memory>();
+  CHECK_EQUAL(0x12345678ul, host_memory::word(0x40000010ul));
+  CHECK_EQUAL(1u, host_memory::mem().reads);
+  CHECK_EQUAL(1u, host_memory::mem().writes);
+  CHECK_EQUAL(0u, host_memory::mem().alias_writes);
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__outside_bitband_uses_read_modify_write)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x60000000ul) = 0x5678ul;
+  modify<masked<0x00010000ul, 0x00010000ul> >::at<0x60000000ul, host_memory>();
+  CHECK_EQUAL(0x00015678ul, host_memory::word(0x60000000ul));
+  CHECK_EQUAL(1u, host_memory::mem().reads);
+  CHECK_EQUAL(1u, host_memory::mem().writes);
+  CHECK_EQUAL(0u, host_memory::mem().alias_writes);
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__empty_mask_does_nothing)
+{
+  using namespace stm32xx::bits::ct;
+  modify<masked<0ul, 0ul> >::at<0x40000010ul, host_memory>();
+  CHECK_EQUAL(0u, host_memory::mem().reads + host_memory::mem().writes);
+  CHECK_EQUAL(0u, host_memory::mem().alias_reads + host_memory::mem().alias_writes);
+}
+
+TEST(stm32xx__bits__ct__bitband, test_bit__in)
+{
+  using namespace stm32xx::bits::ct;
+  uint32_t var = 0x00000008ul;
+  CHECK(test_bit<3>::in(var));
+  CHECK(!test_bit<4>::in(var));
+}
+
+TEST(stm32xx__bits__ct__bitband, test_bit__at)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x40000010ul) = 0x00100000ul;
+  host_memory::word(0x60000000ul) = 0x00100000ul;
+  CHECK((test_bit<20>::at<0x40000010ul, host_memory>()));
+  CHECK(!(test_bit<21>::at<0x40000010ul, host_memory>()));
+  CHECK_EQUAL(0u, host_memory::mem().reads);
+  CHECK_EQUAL(2u, host_memory::mem().alias_reads);
+  CHECK((test_bit<20>::at<0x60000000ul, host_memory>()));
+  CHECK_EQUAL(1u, host_memory::mem().reads);
+}
+
+TEST(stm32xx__bits__ct__bitband, modify_at__full_mask_is_a_store)
+{
+  using namespace stm32xx::bits::ct;
+  host_memory::word(0x40000010ul) = 0x5678ul;
+  modify<masked<0x12345678ul, 0xFFFFFFFFul> >::at<0x40000010ul, host_memory>();
+  CHECK_EQUAL(0x12345678ul, host_memory::word(0x40000010ul));
+  CHECK_EQUAL(0u, host_memory::mem().reads);
+  CHECK_EQUAL(1u, host_memory::mem().writes);
+}
+
+TEST_GROUP(stm32xx__bits__ct__transaction)
+{
+  void setup()
+  {
+    host_memory::clear();
+  }
+};
+
+TEST(stm32xx__bits__ct__transaction, empty)
+{
+  using namespace stm32xx::bits::ct;
+  CHECK_EQUAL(0u, transaction<>::size);
+  transaction<>::apply<host_memory>();
+  CHECK_EQUAL(0u, host_memory::mem().reads + host_memory::mem().writes);
+}
+
+TEST(stm32xx__bits__ct__transaction, one_rmw_per_register)
+{
+  using namespace stm32xx::bits::ct;
+  using t = transaction<
+    op<0x60000000ul, masked<0x00000001ul, 0x0000000Ful> >,
+    op<0x60000004ul, masked<0x00000020ul, 0x000000F0ul> >,
+    op<0x60000000ul, masked<0x00000300ul, 0x00000F00ul> >,
+    op<0x60000004ul, masked<0x00004000ul, 0x0000F000ul> >,
+    op<0x60000000ul, masked<0x00050000ul, 0x000F0000ul> >
+  >;
+  CHECK_EQUAL(2u, t::size);
+  host_memory::word(0x60000000ul) = 0xFFFFFFFFul;
+  host_memory::word(0x60000004ul) = 0xFFFFFFFFul;
+  t::apply<host_memory>();
+  CHECK_EQUAL(0xFFF5F3F1ul, host_memory::word(0x60000000ul));
+  CHECK_EQUAL(0xFFFF4F2Ful, host_memory::word(0x60000004ul));
+  CHECK_EQUAL(2u, host_memory::mem().reads);
+  CHECK_EQUAL(2u, host_memory::mem().writes);
+}
+
+TEST(stm32xx__bits__ct__transaction, full_mask_is_a_store)
+{
+  using namespace stm32xx::bits::ct;
+  using t = transaction<
+    op<0x60000000ul, masked<0x00001234ul, 0x0000FFFFul> >,
+    op<0x60000000ul, masked<0x56780000ul, 0xFFFF0000ul> >
+  >;
+  CHECK_EQUAL(1u, t::size);
+  t::apply<host_memory>();
+  CHECK_EQUAL(0x56781234ul, host_memory::word(0x60000000ul));
+  CHECK_EQUAL(0u, host_memory::mem().reads);
+  CHECK_EQUAL(1u, host_memory::mem().writes);
+}
+
+TEST(stm32xx__bits__ct__transaction, single_bit_uses_bitband_alias)
+{
+  using namespace stm32xx::bits::ct;
+  using t = transaction<
+    op<0x40000018ul, masked<0x00000004ul, 0x00000004ul> >
+  >;
+  t::apply<host_memory>();
+  CHECK_EQUAL(0x00000004ul, host_memory::word(0x40000018ul));
+  CHECK_EQUAL(0u, host_memory::mem().reads + host_memory::mem().writes);
+  CHECK_EQUAL(1u, host_memory::mem().alias_writes);
+}
+
+TEST_GROUP(stm32xx__bits__ct__table)
+{
+  void setup()
+  {
+    host_memory::clear();
+  }
+
+  /* Fill the registers used by the tests with a pattern */
+  static void fill()
+  {
+    for(unsigned i = 0; i < 64; ++i)
+      {
+        host_memory::mem().sram[i] = 0x9E3779B9ul * (i + 1u);
+        host_memory::mem().periph[i] = 0x7F4A7C15ul * (i + 3u);
+        host_memory::mem().other[i] = 0x85EBCA6Bul * (i + 5u);
+      }
+  }
+};
+
+TEST(stm32xx__bits__ct__table, empty)
+{
+  using namespace stm32xx::bits::ct;
+  CHECK_EQUAL(0u, table<>::size);
+  table<>::apply<host_memory>();
+  CHECK_EQUAL(0u, host_memory::mem().reads + host_memory::mem().writes);
+}
+
+TEST(stm32xx__bits__ct__table, sorted_and_merged)
+{
+  using namespace stm32xx::bits::ct;
+  using t = table<
+    op<0x60000008ul, masked<0x00000001ul, 0x0000000Ful> >,
+    op<0x60000000ul, masked<0x00001234ul, 0x0000FFFFul> >,
+    op<0x60000008ul, masked<0x00000300ul, 0x00000F00ul> >,
+    op<0x40000018ul, masked<0x00000004ul, 0x00000004ul> >,
+    op<0x60000000ul, masked<0x56780000ul, 0xFFFF0000ul> >
+  >;
+  CHECK_EQUAL(3u, t::size);
+  const table_entry* e = t::entries();
+  /* single bit in bit-band region: store to alias */
+  CHECK_EQUAL(0x42000308ul | table_entry::store_flag, e[0].addr);
+  CHECK_EQUAL(1ul, e[0].bits);
+  /* whole word: plain store */
+  CHECK_EQUAL(0x60000000ul | table_entry::store_flag, e[1].addr);
+  CHECK_EQUAL(0x56781234ul, e[1].bits);
+  /* read-modify-write */
+  CHECK_EQUAL(0x60000008ul, e[2].addr);
+  CHECK_EQUAL(0x00000F0Ful, e[2].mask);
+  CHECK_EQUAL(0x00000301ul, e[2].bits);
+}
+
+TEST(stm32xx__bits__ct__table, same_end_state_as_transaction)
+{
+  using namespace stm32xx::bits::ct;
+  typedef op<0x40000010ul, masked<0x00000003ul, 0x0000000Ful> > o0;
+  typedef op<0x60000004ul, masked<0x00000020ul, 0x000000F0ul> > o1;
+  typedef op<0x20000008ul, masked<0x00000000ul, 0x00000100ul> > o2;
+  typedef op<0x40000010ul, masked<0x00000B00ul, 0x00000F00ul> > o3;
+  typedef op<0x40000000ul, masked<0xCAFEBABEul, 0xFFFFFFFFul> > o4;
+  typedef op<0x60000004ul, masked<0x80000000ul, 0xF0000000ul> > o5;
+  typedef op<0x4000001Cul, masked<0x00400000ul, 0x00400000ul> > o6;
+  typedef op<0x40000010ul, masked<0x00400000ul, 0x00F00000ul> > o7;
+  typedef op<0x60000000ul, masked<0x0000AA00ul, 0x0000FF00ul> > o8;
+  typedef op<0x20000008ul, masked<0x00010000ul, 0x00010000ul> > o9;
+  typedef op<0x60000000ul, masked<0x00000055ul, 0x000000FFul> > o10;
+  typedef op<0x40000004ul, masked<0x00000000ul, 0x0000FFFFul> > o11;
+
+  fill();
+  transaction<o0, o1, o2, o3, o4, o5, o6, o7, o8, o9, o10, o11>::apply<host_memory>();
+  const host_memory::state expected = host_memory::mem();
+
+  host_memory::clear();
+  fill();
+  typedef table<o0, o1, o2, o3, o4, o5, o6, o7, o8, o9, o10, o11> t;
+  t::apply<host_memory>();
+  CHECK_EQUAL(7u, t::size);
+  for(unsigned i = 0; i < 64; ++i)
+    {
+      CHECK_EQUAL(expected.sram[i], host_memory::mem().sram[i]);
+      CHECK_EQUAL(expected.periph[i], host_memory::mem().periph[i]);
+      CHECK_EQUAL(expected.other[i], host_memory::mem().other[i]);
+    }
+  CHECK_EQUAL(expected.reads, host_memory::mem().reads);
+  CHECK_EQUAL(expected.writes, host_memory::mem().writes);
+  CHECK_EQUAL(expected.alias_writes, host_memory::mem().alias_writes);
+}
+
+/* Register stand-in counting reads and writes */
+struct counting_register
+{
+  uint32_t value;
+  unsigned reads;
+  unsigned writes;
+
+  operator uint32_t()
+  {
+    ++reads;
+    return value;
+  }
+  counting_register& operator=(uint32_t x)
+  {
+    ++writes;
+    value = x;
+    return *this;
+  }
+};
+
+TEST_GROUP(stm32xx__bits__shadowed)
+{
+};
+
+TEST(stm32xx__bits__shadowed, modify_on_register_reads)
+{
+  using namespace stm32xx::bits::ct;
+  counting_register reg = { 0x44444444ul, 0, 0 };
+  modify<masked<0x00000002ul, 0x0000000Ful> >::in(reg);
+  modify<masked<0x00000080ul, 0x000000F0ul> >::in(reg);
+  CHECK_EQUAL(0x44444482ul, reg.value);
+  CHECK_EQUAL(2u, reg.reads);
+  CHECK_EQUAL(2u, reg.writes);
+}
+
+TEST(stm32xx__bits__shadowed, modify_on_shadowed_doesnt_read)
+{
+  using namespace stm32xx::bits;
+  using namespace stm32xx::bits::ct;
+  counting_register reg = { 0x44444444ul, 0, 0 };
+  shadowed<counting_register> sh(reg, 0x44444444ul);
+  modify<masked<0x00000002ul, 0x0000000Ful> >::in(sh);
+  modify<masked<0x00000080ul, 0x000000F0ul> >::in(sh);
+  rt::modify(sh, 0x00000B00ul, 0x00000F00ul);
+  CHECK_EQUAL(0x44444B82ul, reg.value);
+  CHECK_EQUAL(0x44444B82ul, sh.value());
+  CHECK_EQUAL(0u, reg.reads);
+  CHECK_EQUAL(3u, reg.writes);
+}
+
+TEST(stm32xx__bits__shadowed, construct_from_register_reads_once)
+{
+  using namespace stm32xx::bits;
+  using namespace stm32xx::bits::ct;
+  counting_register reg = { 0x12345678ul, 0, 0 };
+  shadowed<counting_register> sh(reg);
+  CHECK_EQUAL(0x12345678ul, sh.value());
+  CHECK_EQUAL(1u, reg.reads);
+  modify<masked<0x00000000ul, 0x0000000Ful> >::in(sh);
+  CHECK_EQUAL(0x12345670ul, reg.value);
+  CHECK_EQUAL(1u, reg.reads);
+}
+
+TEST(stm32xx__bits__shadowed, sync)
+{
+  using namespace stm32xx::bits;
+  counting_register reg = { 0x44444444ul, 0, 0 };
+  shadowed<counting_register> sh(reg, 0x44444444ul);
+  reg.value = 0x11111111ul; /* modified behind our back */
+  CHECK_EQUAL(0x44444444ul, sh.value());
+  sh.sync();
+  CHECK_EQUAL(0x11111111ul, sh.value());
+  CHECK_EQUAL(1u, reg.reads);
+}
+
+TEST(stm32xx__bits__shadowed, volatile_register)
+{
+  using namespace stm32xx::bits;
+  using namespace stm32xx::bits::ct;
+  volatile uint32_t reg = 0x5678ul;
+  shadowed<> sh(reg);
+  modify<masked<0x12340000ul, 0xFFFF0000ul> >::in(sh);
+  CHECK_EQUAL(0x12345678ul, reg);
+}
@@ -0,0 +1,285 @@
+/* This file defines its own STM32XX_ASSERT, so it uses its own pin
+ * configurations and access policy. The templates instantiated here are
+ * then distinct from the ones instantiated (with the default assertion) by
+ * other tests. */
+#include <cstdint>
+
+namespace {
+/* Reset value checks of bits::ct::from_reset, enabled by the tests as
+ * NDEBUG would (when disabled the register is not read at all) */
+struct reset_checks
+{
+  static bool enabled;
+  static unsigned count;
+  static unsigned failures;
+  static void note(bool ok)
+  {
+    ++count;
+    if(!ok)
+      ++failures;
+  }
+  static void clear(bool enable)
+  {
+    enabled = enable;
+    count = failures = 0u;
+  }
+};
+bool reset_checks::enabled = false;
+unsigned reset_checks::count = 0u;
+unsigned reset_checks::failures = 0u;
+}
+
+#define STM32XX_ASSERT(expr) \
+  (reset_checks::enabled ? reset_checks::note(expr) : (void)0)
+#include <stm32xx/gpio_board.hpp>
+#include <CppUTest/TestHarness.h>
+#include <map>
+
+namespace {
+/* Memory access policy recording values and accesses per address */
+struct reset_memory
+{
+  static std::map<uint32_t, uint32_t> mem;
+  static unsigned reads;
+  static unsigned writes;
+  static uint32_t read(uint32_t addr) { ++reads; return mem[addr]; }
+  static void write(uint32_t addr, uint32_t v) { ++writes; mem[addr] = v; }
+  static void clear()
+  {
+    mem.clear();
+    reads = writes = 0u;
+  }
+};
+std::map<uint32_t, uint32_t> reset_memory::mem;
+unsigned reset_memory::reads = 0u;
+unsigned reset_memory::writes = 0u;
+
+using stm32xx::bits::ct::from_reset;
+using stm32xx::bits::ct::masked;
+}
+
+TEST_GROUP(stm32xx__bits__ct__from_reset)
+{
+  void setup()
+  {
+    reset_checks::clear(false);
+    reset_memory::clear();
+  }
+};
+
+TEST(stm32xx__bits__ct__from_reset, value)
+{
+  CHECK_EQUAL(0x444444B2ul, (from_reset<masked<0xB2ul, 0xFFul>, 0x44444444ul>::value));
+  CHECK_EQUAL(0x12345678ul, (from_reset<masked<0ul, 0ul>, 0x12345678ul>::value));
+}
+
+TEST(stm32xx__bits__ct__from_reset, in__stores_without_read)
+{
+  volatile uint32_t x = 0x44444444ul;
+  from_reset<masked<0x0Bul, 0x0Ful>, 0x44444444ul>::in(x);
+  CHECK_EQUAL(0x4444444Bul, x);
+  CHECK_EQUAL(0u, reset_checks::count);
+}
+
+TEST(stm32xx__bits__ct__from_reset, at__stores_without_read)
+{
+  from_reset<masked<0x0Bul, 0x0Ful>, 0x44444444ul>::at<0x40010C00ul, reset_memory>();
+  CHECK_EQUAL(0x4444444Bul, reset_memory::mem[0x40010C00ul]);
+  CHECK_EQUAL(0u, reset_memory::reads);
+  CHECK_EQUAL(1u, reset_memory::writes);
+}
+
+TEST(stm32xx__bits__ct__from_reset, at__with_no_mask_does_nothing)
+{
+  reset_checks::clear(true);
+  from_reset<masked<0ul, 0ul>, 0x44444444ul>::at<0x40010C00ul, reset_memory>();
+  CHECK_EQUAL(0u, reset_memory::reads + reset_memory::writes);
+  CHECK_EQUAL(0u, reset_checks::count);
+}
+
+TEST(stm32xx__bits__ct__from_reset, in__checks_reset_value)
+{
+  volatile uint32_t x = 0x44444444ul;
+  reset_checks::clear(true);
+  from_reset<masked<0x0Bul, 0x0Ful>, 0x44444444ul>::in(x);
+  CHECK_EQUAL(1u, reset_checks::count);
+  CHECK_EQUAL(0u, reset_checks::failures);
+  /* already modified */
+  from_reset<masked<0x20ul, 0xF0ul>, 0x44444444ul>::in(x);
+  CHECK_EQUAL(2u, reset_checks::count);
+  CHECK_EQUAL(1u, reset_checks::failures);
+}
+
+TEST(stm32xx__bits__ct__from_reset, at__checks_reset_value)
+{
+  reset_checks::clear(true);
+  reset_memory::mem[0x40010C00ul] = 0x44444448ul;
+  from_reset<masked<0x0Bul, 0x0Ful>, 0x44444444ul>::at<0x40010C00ul, reset_memory>();
+  CHECK_EQUAL(1u, reset_checks::failures);
+  CHECK_EQUAL(1u, reset_memory::reads);
+  CHECK_EQUAL(0x4444444Bul, reset_memory::mem[0x40010C00ul]);
+}
+
+#if defined STM32_FAMILY_STM32F10X
+#include <sim/mcu.hpp>
+
+namespace {
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::pin_conf_on_port;
+using stm32xx::gpio::ct::port_conf;
+using stm32xx::gpio::ct::board;
+typedef pin_conf<GPIO_Pin_1|GPIO_Pin_2, GPIO_Mode_Out_OD, GPIO_Speed_10MHz> reset_leds;
+typedef pin_conf<GPIO_Pin_6|GPIO_Pin_9, GPIO_Mode_IPD> reset_buttons;
+typedef pin_conf<GPIO_Pin_11, GPIO_Mode_AF_OD, GPIO_Speed_2MHz> reset_i2c;
+}
+
+TEST_GROUP(stm32xx__gpio__init_from_reset)
+{
+  void setup()
+  {
+    reset_checks::clear(false);
+    sim::instance().reset();
+    sim::access::clear();
+  }
+};
+
+TEST(stm32xx__gpio__init_from_reset, port_conf__init__same_as_in)
+{
+  typedef port_conf<reset_leds, reset_buttons, reset_i2c> conf;
+  sim::mcu& m = sim::instance();
+  conf::in(m.gpiob);
+  const uint32_t crl = m.gpiob.CRL.value;
+  const uint32_t crh = m.gpiob.CRH.value;
+  m.reset();
+  conf::init(m.gpiob);
+  CHECK_EQUAL(crl, m.gpiob.CRL.value);
+  CHECK_EQUAL(crh, m.gpiob.CRH.value);
+  CHECK_EQUAL(0u, m.reads());
+  CHECK_EQUAL(2u, m.writes());
+}
+
+TEST(stm32xx__gpio__init_from_reset, port_conf__init_at__costs_1_write_per_register)
+{
+  typedef port_conf<reset_leds> conf;
+  sim::mcu& m = sim::instance();
+  conf::init_at<GPIOC_BASE, sim::access>();
+  CHECK_EQUAL(0x44444554ul, m.gpioc.CRL.value);
+  CHECK_EQUAL(0u, m.gpioc.CRL.reads);
+  CHECK_EQUAL(1u, m.gpioc.CRL.writes);
+  CHECK_EQUAL(0u, m.gpioc.CRH.reads + m.gpioc.CRH.writes);
+}
+
+TEST(stm32xx__gpio__init_from_reset, port_conf__init__checks_reset_value)
+{
+  typedef port_conf<reset_leds, reset_i2c> conf;
+  sim::mcu& m = sim::instance();
+  reset_checks::clear(true);
+  conf::init(m.gpioa);
+  CHECK_EQUAL(2u, reset_checks::count);
+  CHECK_EQUAL(0u, reset_checks::failures);
+  CHECK_EQUAL(2u, m.reads());
+  /* second time, registers are not at reset any more */
+  conf::init(m.gpioa);
+  CHECK_EQUAL(2u, reset_checks::failures);
+}
+
+TEST(stm32xx__gpio__init_from_reset, board__init_from_reset)
+{
+  typedef pin_conf_on_port<GPIOA_BASE, reset_leds> leds;
+  typedef pin_conf_on_port<GPIOA_BASE, reset_i2c> i2c;
+  typedef pin_conf_on_port<GPIOD_BASE, reset_buttons> buttons;
+  typedef board<leds, buttons, i2c> b;
+  sim::mcu& m = sim::instance();
+  b::init<sim::access>();
+  const uint32_t expected[] = {
+    m.gpioa.CRL.value, m.gpioa.CRH.value, m.gpiod.CRL.value, m.gpiod.CRH.value
+  };
+  m.reset();
+  b::init_from_reset<sim::access>();
+  CHECK_EQUAL(expected[0], m.gpioa.CRL.value);
+  CHECK_EQUAL(expected[1], m.gpioa.CRH.value);
+  CHECK_EQUAL(expected[2], m.gpiod.CRL.value);
+  CHECK_EQUAL(expected[3], m.gpiod.CRH.value);
+  /* RCC_APB2ENR read-modify-write, then 4 stores */
+  CHECK_EQUAL(1u, m.reads());
+  CHECK_EQUAL(5u, m.writes());
+}
+#endif /* STM32_FAMILY_STM32F10X */
+
+#if defined STM32_FAMILY_STM32F4XX
+namespace {
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::pin_conf_on_port;
+using stm32xx::gpio::ct::board;
+using stm32xx::gpio::detail::moder_reset;
+using stm32xx::gpio::detail::ospeedr_reset;
+using stm32xx::gpio::detail::pupdr_reset;
+
+/* Set reset values of GPIO port at address port */
+void
+reset_port(uint32_t port)
+{
+  reset_memory::mem[port + 0x00] = moder_reset(port);
+  reset_memory::mem[port + 0x04] = 0ul;
+  reset_memory::mem[port + 0x08] = ospeedr_reset(port);
+  reset_memory::mem[port + 0x0C] = pupdr_reset(port);
+  reset_memory::mem[port + 0x20] = 0ul;
+  reset_memory::mem[port + 0x24] = 0ul;
+}
+}
+
+TEST_GROUP(stm32xx__gpio__init_from_reset)
+{
+  void setup()
+  {
+    reset_checks::clear(false);
+    reset_memory::clear();
+  }
+};
+
+TEST(stm32xx__gpio__init_from_reset, reset_values)
+{
+  CHECK_EQUAL(0xA8000000ul, moder_reset(GPIOA_BASE));
+  CHECK_EQUAL(0x00000280ul, moder_reset(GPIOB_BASE));
+  CHECK_EQUAL(0ul, moder_reset(GPIOC_BASE));
+  CHECK_EQUAL(0x0C000000ul, ospeedr_reset(GPIOA_BASE));
+  CHECK_EQUAL(0x000000C0ul, ospeedr_reset(GPIOB_BASE));
+  CHECK_EQUAL(0x64000000ul, pupdr_reset(GPIOA_BASE));
+  CHECK_EQUAL(0x00000100ul, pupdr_reset(GPIOB_BASE));
+  CHECK_EQUAL(0ul, pupdr_reset(GPIOE_BASE));
+}
+
+TEST(stm32xx__gpio__init_from_reset, board__init_from_reset__same_as_init)
+{
+  typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_2|GPIO_Pin_3, GPIO_Mode_AF, GPIO_OType_PP,
+                                                GPIO_Speed_25MHz, GPIO_PuPd_UP, GPIO_AF_USART2> > usart;
+  typedef pin_conf_on_port<GPIOB_BASE, pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_OUT, GPIO_OType_OD> > leds;
+  typedef pin_conf_on_port<GPIOE_BASE, pin_conf<GPIO_Pin_4, GPIO_Mode_IN, GPIO_OType_PP,
+                                                GPIO_Speed_2MHz, GPIO_PuPd_DOWN> > button;
+  typedef board<usart, leds, button> b;
+  reset_port(GPIOA_BASE);
+  reset_port(GPIOB_BASE);
+  reset_port(GPIOE_BASE);
+  b::init<reset_memory>();
+  const std::map<uint32_t, uint32_t> expected = reset_memory::mem;
+  const unsigned writes = reset_memory::writes;
+  reset_memory::clear();
+  reset_port(GPIOA_BASE);
+  reset_port(GPIOB_BASE);
+  reset_port(GPIOE_BASE);
+  reset_checks::clear(true);
+  b::init_from_reset<reset_memory>();
+  CHECK(expected == reset_memory::mem);
+  CHECK_EQUAL(writes, reset_memory::writes);
+  CHECK_EQUAL(0u, reset_checks::failures);
+  /* 2 reads of RCC_AHB1ENR (see enable_clocks()), one per checked register */
+  CHECK_EQUAL(2u + reset_checks::count, reset_memory::reads);
+  reset_checks::clear(false);
+  reset_memory::reads = 0u;
+  b::init_from_reset<reset_memory>();
+  CHECK_EQUAL(2u, reset_memory::reads);
+}
+#endif /* STM32_FAMILY_STM32F4XX */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,503 @@
+#include <stm32xx/gpio_bitbang.hpp>
+#include <CppUTest/TestHarness.h>
+#include <vector>
+
+namespace {
+using stm32xx::gpio::detail::idr_offset;
+using stm32xx::gpio::detail::bsrr_offset;
+
+/* Device attached to the simulated port pins */
+struct device
+{
+  /* Levels of the port pins given the output data register */
+  virtual uint32_t lines(uint32_t odr) const = 0;
+  /* Called on each GPIOx_IDR load, before the pins are sampled */
+  virtual void on_load() {}
+  /* Called when the levels of the pins change */
+  virtual void on_change(uint32_t before, uint32_t after) = 0;
+  virtual ~device() {}
+};
+
+/* Simulated GPIOB with a cycle counter. Every access and every clock read
+ * takes one cycle; pin changes are logged with their time. */
+struct wires
+{
+  static uint32_t time;
+  static uint32_t odr;
+  static unsigned loads;
+  static unsigned stores;
+  static device* dev;
+  static std::vector< std::pair<uint32_t, uint32_t> > log;
+
+  static void reset(device* d)
+  {
+    time = 1000ul;
+    odr = 0ul;
+    loads = stores = 0u;
+    dev = d;
+    log.clear();
+  }
+  static void changed(uint32_t before)
+  {
+    const uint32_t after = dev->lines(odr);
+    if(after != before)
+      {
+        log.push_back(std::make_pair(time, after));
+        dev->on_change(before, after);
+      }
+  }
+  static void check(uint32_t addr, uint32_t expected)
+  {
+    CHECK_EQUAL(expected, addr);
+  }
+  static uint32_t read(uint32_t addr)
+  {
+    check(addr, GPIOB_BASE + idr_offset);
+    ++time;
+    ++loads;
+    const uint32_t before = dev->lines(odr);
+    dev->on_load();
+    changed(before);
+    return dev->lines(odr);
+  }
+  static void write(uint32_t addr, uint32_t value)
+  {
+    check(addr, GPIOB_BASE + bsrr_offset);
+    CHECK_EQUAL(0ul, value & (value >> 16) & 0xFFFFul);
+    ++time;
+    ++stores;
+    const uint32_t before = dev->lines(odr);
+    odr = (odr & ~(value >> 16)) | (value & 0xFFFFul);
+    changed(before);
+  }
+};
+uint32_t wires::time;
+uint32_t wires::odr;
+unsigned wires::loads;
+unsigned wires::stores;
+device* wires::dev;
+std::vector< std::pair<uint32_t, uint32_t> > wires::log;
+
+struct wires_clock
+{
+  static uint32_t now() { return ++wires::time; }
+};
+
+/* Half clock period, in cycles */
+constexpr uint32_t half = 10ul;
+typedef stm32xx::gpio::bitbang::cycle_delay<half, wires_clock> delay;
+
+using stm32xx::gpio::ct::pin_conf;
+#if defined STM32_FAMILY_STM32F10X
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN_FLOATING> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_Out_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_Out_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> tx;
+#elif defined STM32_FAMILY_STM32F4XX
+typedef pin_conf<GPIO_Pin_13, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> sck;
+typedef pin_conf<GPIO_Pin_14, GPIO_Mode_IN> miso;
+typedef pin_conf<GPIO_Pin_15, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz> mosi;
+typedef pin_conf<GPIO_Pin_6, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> scl;
+typedef pin_conf<GPIO_Pin_7, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> sda;
+typedef pin_conf<GPIO_Pin_10, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_2MHz> tx;
+#endif
+
+/* SPI slave shifting out responses[] while receiving to received[] */
+struct spi_slave : device
+{
+  unsigned cpol, cpha;
+  const uint8_t* responses;
+  unsigned count;             /* bytes */
+  std::vector<uint8_t> received;
+  unsigned sampled, shifted;  /* bits */
+  bool miso_level;
+  unsigned violations;        /* MOSI changed on a sampling edge */
+  std::vector<uint32_t> edges;
+
+  spi_slave(unsigned pol, unsigned pha, const uint8_t* resp, unsigned n)
+    : cpol(pol), cpha(pha), responses(resp), count(n), sampled(0u), shifted(0u),
+      miso_level(false), violations(0u)
+  {
+    if(cpha == 0u)
+      shift_out();
+  }
+
+  void shift_out()
+  {
+    if((shifted >> 3) < count)
+      miso_level = (responses[shifted >> 3] >> (7u - (shifted & 7u))) & 1u;
+    ++shifted;
+  }
+
+  uint32_t lines(uint32_t odr) const
+  {
+    return (odr & ~(uint32_t)miso::pins) | (miso_level ? miso::pins : 0ul);
+  }
+
+  void on_change(uint32_t before, uint32_t after)
+  {
+    if(((before ^ after) & sck::pins) == 0ul)
+      return;
+    edges.push_back(wires::time);
+    const unsigned level = (after & sck::pins) ? 1u : 0u;
+    const bool leading = (level != cpol);
+    if(leading == (cpha == 0u))
+      {
+        if((before ^ after) & mosi::pins)
+          ++violations;
+        if((sampled & 7u) == 0u)
+          received.push_back(0u);
+        received.back() = (uint8_t)((received.back() << 1) | ((after & mosi::pins) ? 1u : 0u));
+        ++sampled;
+      }
+    else
+      shift_out();
+  }
+};
+
+/* I2C slave with 8 bytes of memory at address 0x50. Writes store bytes at
+ * the memory pointer, reads return them; the pointer advances in both
+ * cases. The slave stretches SCL for stretch IDR loads after each byte. */
+struct i2c_slave : device
+{
+  enum state_t { idle, address, writing, reading };
+  state_t state;
+  uint8_t mem[8];
+  unsigned ptr;
+  unsigned n;             /* SCL rising edges in the current byte + ack */
+  uint32_t shift;
+  bool matched;
+  bool master_ack;
+  bool pull_sda;
+  unsigned stretch;
+  unsigned hold;          /* IDR loads left with SCL held low */
+  unsigned starts, stops;
+
+  explicit i2c_slave(unsigned s = 0u)
+    : state(idle), ptr(0u), n(0u), shift(0ul), matched(false),
+      master_ack(false), pull_sda(false), stretch(s), hold(0u), starts(0u),
+      stops(0u)
+  {
+    for(unsigned i = 0; i < 8u; ++i)
+      mem[i] = (uint8_t)(0xA0u + i);
+  }
+
+  uint32_t lines(uint32_t odr) const
+  {
+    uint32_t x = odr;
+    if(pull_sda)
+      x &= ~(uint32_t)sda::pins;
+    if(hold)
+      x &= ~(uint32_t)scl::pins;
+    return x;
+  }
+
+  void on_load()
+  {
+    if(hold)
+      --hold;
+  }
+
+  void drive(uint8_t byte, unsigned bit)
+  {
+    pull_sda = ((byte >> (7u - bit)) & 1u) == 0u;
+  }
+
+  void on_change(uint32_t before, uint32_t after)
+  {
+    const uint32_t diff = before ^ after;
+    if(diff & scl::pins)
+      {
+        if(after & scl::pins)
+          rising((after & sda::pins) != 0ul);
+        else
+          falling();
+      }
+    else if((diff & sda::pins) && (after & scl::pins))
+      {
+        if(after & sda::pins)
+          {
+            ++stops;
+            state = idle;
+          }
+        else
+          {
+            ++starts;
+            state = address;
+            n = 0u;
+            shift = 0ul;
+          }
+        pull_sda = false;
+      }
+  }
+
+  void rising(bool bit)
+  {
+    if(state == idle)
+      return;
+    if(n < 8u && state != reading)
+      shift = (shift << 1) | (bit ? 1ul : 0ul);
+    if(n == 8u && state == reading)
+      master_ack = !bit;
+    ++n;
+  }
+
+  void falling()
+  {
+    if(state == idle)
+      return;
+    if(n == 8u)
+      {
+        if(state == reading)
+          {
+            pull_sda = false;
+            ++ptr;
+          }
+        else if(state == address)
+          {
+            matched = (shift >> 1) == 0x50ul;
+            pull_sda = matched;
+          }
+        else
+          {
+            mem[ptr++ & 7u] = (uint8_t)shift;
+            pull_sda = true;
+          }
+      }
+    else if(n == 9u)
+      {
+        pull_sda = false;
+        n = 0u;
+        hold = stretch;
+        if(state == address)
+          state = !matched ? idle : ((shift & 1ul) ? reading : writing);
+        else if(state == reading && !master_ack)
+          state = idle;
+        shift = 0ul;
+        if(state == reading)
+          drive(mem[ptr & 7u], 0u);
+      }
+    else if(state == reading)
+      drive(mem[ptr & 7u], n);
+  }
+};
+
+/* Plain wire on which the UART transmitter is observed */
+struct line : device
+{
+  uint32_t lines(uint32_t odr) const { return odr; }
+  void on_change(uint32_t, uint32_t) {}
+};
+}
+
+TEST_GROUP(stm32xx__gpio__bitbang)
+{
+  template <unsigned _cpol, unsigned _cpha>
+  static void
+  check_spi_transfer()
+  {
+    typedef stm32xx::gpio::bitbang::spi<GPIOB_BASE, sck, mosi, miso,
+                                        _cpol, _cpha, delay, wires> spi;
+    const uint8_t out[4] = { 0x9F, 0x00, 0x5A, 0xC3 };
+    const uint8_t resp[4] = { 0xEF, 0x40, 0x18, 0x01 };
+    uint8_t in[4];
+    spi_slave slave(_cpol, _cpha, resp, 4u);
+    line unselected;
+    wires::reset(&unselected);
+    spi::init();
+    CHECK_EQUAL(_cpol ? (uint32_t)sck::pins : 0ul, wires::odr & sck::pins);
+    wires::dev = &slave;
+    wires::stores = 0u;
+    spi::transfer(out, in, 4u);
+    for(unsigned i = 0; i < 4u; ++i)
+      {
+        CHECK_EQUAL((unsigned)resp[i], (unsigned)in[i]);
+        CHECK_EQUAL((unsigned)out[i], (unsigned)slave.received[i]);
+      }
+    CHECK_EQUAL(0u, slave.violations);
+    /* one IDR load per bit, one BSRR store per edge */
+    CHECK_EQUAL(32u, wires::loads);
+    CHECK_EQUAL(4u * (16u + (_cpha == 0u ? 1u : 0u)), wires::stores);
+    CHECK_EQUAL(_cpol ? (uint32_t)sck::pins : 0ul, wires::odr & sck::pins);
+    /* edges half a period apart within each byte */
+    CHECK_EQUAL(64u, slave.edges.size());
+    for(unsigned i = 1; i < slave.edges.size(); ++i)
+      if(i & 15u)
+        {
+          CHECK(slave.edges[i] - slave.edges[i - 1] >= half);
+          CHECK(slave.edges[i] - slave.edges[i - 1] <= half + 2u);
+        }
+  }
+};
+
+TEST(stm32xx__gpio__bitbang, pin_number)
+{
+  using stm32xx::gpio::bitbang::detail::pin_number;
+  static_assert(pin_number(0x0001u) == 0, "");
+  static_assert(pin_number(0x0080u) == 7, "");
+  static_assert(pin_number(0x8000u) == 15, "");
+}
+
+TEST(stm32xx__gpio__bitbang, drive)
+{
+  using stm32xx::gpio::bitbang::detail::drive;
+  CHECK_EQUAL(0x00002000ul, drive(0x2000ul, 1ul));
+  CHECK_EQUAL(0x20000000ul, drive(0x2000ul, 0ul));
+  CHECK_EQUAL(0x00002000ul, drive(0x2000ul, 0xFFul));
+  CHECK_EQUAL(0x20000000ul, drive(0x2000ul, 0xFEul));
+}
+
+TEST(stm32xx__gpio__bitbang, spi__mode0)
+{
+  check_spi_transfer<0, 0>();
+}
+
+TEST(stm32xx__gpio__bitbang, spi__mode1)
+{
+  check_spi_transfer<0, 1>();
+}
+
+TEST(stm32xx__gpio__bitbang, spi__mode2)
+{
+  check_spi_transfer<1, 0>();
+}
+
+TEST(stm32xx__gpio__bitbang, spi__mode3)
+{
+  check_spi_transfer<1, 1>();
+}
+
+TEST(stm32xx__gpio__bitbang, spi__mosi_setup_time)
+{
+  /* mode 0: MOSI is valid half a period before each rising SCK edge */
+  typedef stm32xx::gpio::bitbang::spi<GPIOB_BASE, sck, mosi, miso,
+                                      0, 0, delay, wires> spi;
+  const uint8_t resp[1] = { 0x00 };
+  spi_slave slave(0, 0, resp, 1u);
+  wires::reset(&slave);
+  spi::init();
+  spi::transfer(0xA5);
+  uint32_t mosi_changed = 0ul;
+  for(unsigned i = 1; i < wires::log.size(); ++i)
+    {
+      const uint32_t diff = wires::log[i].second ^ wires::log[i - 1].second;
+      if(diff & mosi::pins)
+        mosi_changed = wires::log[i].first;
+      if((diff & sck::pins) && (wires::log[i].second & sck::pins))
+        CHECK(wires::log[i].first - mosi_changed >= half);
+    }
+}
+
+TEST(stm32xx__gpio__bitbang, spi__no_delay)
+{
+  typedef stm32xx::gpio::bitbang::spi<GPIOB_BASE, sck, mosi, miso,
+                                      0, 1, stm32xx::gpio::bitbang::no_delay,
+                                      wires> spi;
+  const uint8_t resp[1] = { 0x3C };
+  spi_slave slave(0, 1, resp, 1u);
+  wires::reset(&slave);
+  CHECK_EQUAL(0x3Cu, spi::transfer(0x81));
+  CHECK_EQUAL(0x81u, slave.received[0]);
+  /* no clock reads, only the accesses */
+  CHECK_EQUAL(1000u + 8u + 16u, wires::time);
+}
+
+TEST(stm32xx__gpio__bitbang, i2c__write)
+{
+  typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda, delay, wires> i2c;
+  i2c_slave slave;
+  wires::reset(&slave);
+  i2c::init();
+  const uint8_t data[3] = { 0x02, 0x5A, 0xC3 };
+  CHECK(i2c::write(0x50, data, 3u));
+  CHECK_EQUAL(1u, slave.starts);
+  CHECK_EQUAL(1u, slave.stops);
+  CHECK_EQUAL(0x02u, slave.mem[0]);
+  CHECK_EQUAL(0x5Au, slave.mem[1]);
+  CHECK_EQUAL(0xC3u, slave.mem[2]);
+  CHECK_EQUAL(3u, slave.ptr);
+  /* bus released */
+  CHECK_EQUAL((uint32_t)(scl::pins | sda::pins), slave.lines(wires::odr));
+}
+
+TEST(stm32xx__gpio__bitbang, i2c__address_nack)
+{
+  typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda, delay, wires> i2c;
+  i2c_slave slave;
+  wires::reset(&slave);
+  i2c::init();
+  const uint8_t data[1] = { 0xFF };
+  CHECK(!i2c::write(0x51, data, 1u));
+  CHECK_EQUAL(0u, slave.ptr);
+  CHECK_EQUAL(1u, slave.stops);
+}
+
+TEST(stm32xx__gpio__bitbang, i2c__read)
+{
+  typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda, delay, wires> i2c;
+  i2c_slave slave;
+  wires::reset(&slave);
+  i2c::init();
+  uint8_t data[3] = { 0, 0, 0 };
+  CHECK(i2c::read(0x50, data, 3u));
+  CHECK_EQUAL(0xA0u, data[0]);
+  CHECK_EQUAL(0xA1u, data[1]);
+  CHECK_EQUAL(0xA2u, data[2]);
+  /* last byte not acknowledged, slave released SDA for the STOP */
+  CHECK_EQUAL(1u, slave.stops);
+  CHECK_EQUAL(i2c_slave::idle, slave.state);
+}
+
+TEST(stm32xx__gpio__bitbang, i2c__clock_stretching_and_timing)
+{
+  typedef stm32xx::gpio::bitbang::i2c<GPIOB_BASE, scl, sda, delay, wires> i2c;
+  i2c_slave slave(5u);
+  wires::reset(&slave);
+  i2c::init();
+  i2c::start();
+  CHECK(i2c::write(0xA0));
+  const unsigned loads = wires::loads;
+  CHECK(i2c::write(0x07));
+  /* 9 bits sampled with a load each, SCL held low for 4 more loads */
+  CHECK_EQUAL(9u + 4u, wires::loads - loads);
+  i2c::stop();
+  CHECK_EQUAL(0x07u, slave.mem[0]);
+  /* SCL high and low for at least half a period, measured on the line */
+  uint32_t last = 0ul;
+  for(unsigned i = 1; i < wires::log.size(); ++i)
+    if((wires::log[i].second ^ wires::log[i - 1].second) & scl::pins)
+      {
+        if(last)
+          CHECK(wires::log[i].first - last >= half);
+        last = wires::log[i].first;
+      }
+}
+
+TEST(stm32xx__gpio__bitbang, uart_tx)
+{
+  typedef stm32xx::gpio::bitbang::uart_tx<GPIOB_BASE, tx, delay, wires> uart;
+  line wire;
+  wires::reset(&wire);
+  uart::init();
+  CHECK_EQUAL((uint32_t)tx::pins, wires::odr);
+  const uint32_t t0 = wires::time;
+  uart::write(0x4B);
+  CHECK_EQUAL(1u + 10u, wires::stores);
+  /* sample each bit in the middle of its period */
+  uint32_t frame = 0ul;
+  for(unsigned b = 0; b < 10u; ++b)
+    {
+      const uint32_t t = t0 + 2u + b * half + half / 2u;
+      uint32_t level = tx::pins;
+      for(auto const& e : wires::log)
+        if(e.first <= t)
+          level = e.second & tx::pins;
+      frame |= (level ? 1ul : 0ul) << b;
+    }
+  CHECK_EQUAL(((uint32_t)0x4B << 1) | 0x200ul, frame);
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,190 @@
+#include <stm32xx/gpio_board.hpp>
+#include <CppUTest/TestHarness.h>
+#include <map>
+
+namespace {
+/* Memory access policy recording values and accesses per address */
+struct board_memory
+{
+  static std::map<uint32_t, uint32_t> mem;
+  static std::map<uint32_t, unsigned> reads;
+  static std::map<uint32_t, unsigned> writes;
+  static uint32_t read(uint32_t addr) { ++reads[addr]; return mem[addr]; }
+  static void write(uint32_t addr, uint32_t v) { ++writes[addr]; mem[addr] = v; }
+  static unsigned total(const std::map<uint32_t, unsigned>& counts)
+  {
+    unsigned n = 0u;
+    for(const auto& c : counts)
+      n += c.second;
+    return n;
+  }
+  static void clear()
+  {
+    mem.clear();
+    reads.clear();
+    writes.clear();
+  }
+};
+std::map<uint32_t, uint32_t> board_memory::mem;
+std::map<uint32_t, unsigned> board_memory::reads;
+std::map<uint32_t, unsigned> board_memory::writes;
+
+using stm32xx::gpio::ct::board;
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::pin_conf_on_port;
+using stm32xx::gpio::detail::gpio_clock_enable_address;
+using stm32xx::gpio::detail::gpio_clock_enable_bit;
+}
+
+TEST_GROUP(stm32xx__gpio__board)
+{
+  void setup()
+  {
+    board_memory::clear();
+  }
+};
+
+TEST(stm32xx__gpio__board, gpio_clock_enable_bit)
+{
+  CHECK_EQUAL(gpio_clock_enable_bit(GPIOA_BASE) << 1, gpio_clock_enable_bit(GPIOB_BASE));
+  CHECK_EQUAL(gpio_clock_enable_bit(GPIOA_BASE) << 3, gpio_clock_enable_bit(GPIOD_BASE));
+}
+
+#if defined STM32_FAMILY_STM32F10X
+namespace {
+typedef pin_conf_on_port<GPIOC_BASE, pin_conf<GPIO_Pin_13, GPIO_Mode_Out_PP, GPIO_Speed_2MHz> > led;
+typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> > usart_tx;
+typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_10, GPIO_Mode_IN_FLOATING> > usart_rx;
+typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_5|GPIO_Pin_7, GPIO_Mode_AF_PP, GPIO_Speed_50MHz> > spi_out;
+typedef pin_conf_on_port<GPIOB_BASE, pin_conf<GPIO_Pin_0, GPIO_Mode_IPU> > button;
+}
+
+TEST(stm32xx__gpio__board, clocks)
+{
+  CHECK_EQUAL(0ul + RCC_APB2Periph_GPIOC, board<led>::clocks);
+  CHECK_EQUAL(0ul + (RCC_APB2Periph_GPIOA|RCC_APB2Periph_GPIOB|RCC_APB2Periph_GPIOC),
+              (board<usart_tx, led, usart_rx, button, spi_out>::clocks));
+  CHECK_EQUAL(RCC_BASE + 0x18ul, gpio_clock_enable_address);
+}
+
+TEST(stm32xx__gpio__board, port_count)
+{
+  CHECK_EQUAL(1u, board<led>::port_count);
+  CHECK_EQUAL(1u, (board<usart_tx, usart_rx, spi_out>::port_count));
+  CHECK_EQUAL(3u, (board<usart_tx, led, usart_rx, button, spi_out>::port_count));
+}
+
+TEST(stm32xx__gpio__board, init)
+{
+  typedef board<usart_tx, led, usart_rx, button, spi_out> b;
+  board_memory::mem[GPIOA_BASE] = 0x44444444ul;
+  board_memory::mem[GPIOA_BASE + 4] = 0x44444444ul;
+  board_memory::mem[GPIOC_BASE + 4] = 0x44444444ul;
+  board_memory::mem[GPIOB_BASE] = 0x44444444ul;
+  board_memory::mem[RCC_BASE + 0x18] = RCC_APB2Periph_AFIO;
+  b::init<board_memory>();
+  CHECK_EQUAL(RCC_APB2Periph_AFIO | b::clocks, board_memory::mem[RCC_BASE + 0x18]);
+  CHECK_EQUAL(0xB4B44444ul, board_memory::mem[GPIOA_BASE]);
+  CHECK_EQUAL(0x444444B4ul, board_memory::mem[GPIOA_BASE + 4]);
+  CHECK_EQUAL(0x44244444ul, board_memory::mem[GPIOC_BASE + 4]);
+  CHECK_EQUAL(0x44444448ul, board_memory::mem[GPIOB_BASE]);
+}
+
+#include <sim/mcu.hpp>
+
+TEST(stm32xx__gpio__board, init__touches_each_register_once)
+{
+  typedef board<usart_tx, led, usart_rx, button, spi_out> b;
+  sim::mcu& m = sim::instance();
+  m.reset();
+  sim::access::clear();
+  b::init<sim::access>();
+  /* RCC_APB2ENR, GPIOA_CRL, GPIOA_CRH, GPIOB_CRL, GPIOC_CRH */
+  CHECK_EQUAL(5u, m.reads());
+  CHECK_EQUAL(5u, m.writes());
+  CHECK_EQUAL(1u, m.rcc.APB2ENR.reads);
+  CHECK_EQUAL(1u, m.rcc.APB2ENR.writes);
+  CHECK_EQUAL(b::clocks, m.rcc.APB2ENR.value);
+  CHECK_EQUAL(0u, m.gpiob.CRH.reads + m.gpiob.CRH.writes);
+  CHECK_EQUAL(0u, m.gpioc.CRL.reads + m.gpioc.CRL.writes);
+}
+
+TEST(stm32xx__gpio__board, init__same_as_port_conf)
+{
+  using stm32xx::gpio::ct::port_conf;
+  sim::mcu& m = sim::instance();
+  m.reset();
+  port_conf<usart_tx::conf, usart_rx::conf, spi_out::conf>::in(m.gpioa);
+  port_conf<button::conf>::in(m.gpiob);
+  port_conf<led::conf>::in(m.gpioc);
+  const uint32_t expected[] = {
+    m.gpioa.CRL.value, m.gpioa.CRH.value, m.gpiob.CRL.value,
+    m.gpiob.CRH.value, m.gpioc.CRL.value, m.gpioc.CRH.value
+  };
+  m.reset();
+  board<usart_tx, led, usart_rx, button, spi_out>::init<sim::access>();
+  const uint32_t actual[] = {
+    m.gpioa.CRL.value, m.gpioa.CRH.value, m.gpiob.CRL.value,
+    m.gpiob.CRH.value, m.gpioc.CRL.value, m.gpioc.CRH.value
+  };
+  for(unsigned i = 0; i < 6; ++i)
+    CHECK_EQUAL(expected[i], actual[i]);
+}
+
+TEST(stm32xx__gpio__board, init__one_port_enables_clock_through_bitband)
+{
+  sim::mcu& m = sim::instance();
+  m.reset();
+  sim::access::clear();
+  board<led>::init<sim::access>();
+  CHECK_EQUAL(0ul + RCC_APB2Periph_GPIOC, m.rcc.APB2ENR.value);
+  CHECK_EQUAL(0u, m.rcc.APB2ENR.reads + m.rcc.APB2ENR.writes);
+  CHECK_EQUAL(1u, sim::access::alias_writes());
+  CHECK_EQUAL(1u, m.reads());
+  CHECK_EQUAL(1u, m.writes());
+}
+#endif /* STM32_FAMILY_STM32F10X */
+
+#if defined STM32_FAMILY_STM32F4XX
+namespace {
+typedef pin_conf_on_port<GPIOD_BASE, pin_conf<GPIO_Pin_12|GPIO_Pin_13, GPIO_Mode_OUT> > leds;
+typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_0, GPIO_Mode_IN, GPIO_OType_PP,
+                                              GPIO_Speed_2MHz, GPIO_PuPd_DOWN> > button;
+typedef pin_conf_on_port<GPIOA_BASE, pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF, GPIO_OType_PP,
+                                              GPIO_Speed_50MHz, GPIO_PuPd_UP, GPIO_AF_USART1> > usart;
+}
+
+TEST(stm32xx__gpio__board, clocks)
+{
+  CHECK_EQUAL(RCC_AHB1ENR_GPIODEN, board<leds>::clocks);
+  CHECK_EQUAL(RCC_AHB1ENR_GPIOAEN|RCC_AHB1ENR_GPIODEN, (board<button, leds, usart>::clocks));
+  CHECK_EQUAL(RCC_BASE + 0x30ul, gpio_clock_enable_address);
+}
+
+TEST(stm32xx__gpio__board, init)
+{
+  typedef board<button, leds, usart> b;
+  const uint32_t enr = gpio_clock_enable_address;
+  board_memory::mem[enr] = RCC_AHB1ENR_GPIOCEN;
+  b::init<board_memory>();
+  CHECK_EQUAL(RCC_AHB1ENR_GPIOAEN|RCC_AHB1ENR_GPIOCEN|RCC_AHB1ENR_GPIODEN,
+              board_memory::mem[enr]);
+  /* read-modify-write, then read back */
+  CHECK_EQUAL(2u, board_memory::reads[enr]);
+  CHECK_EQUAL(1u, board_memory::writes[enr]);
+  /* GPIOA: MODER, OTYPER, OSPEEDR, PUPDR, AFRH (AFRL untouched) */
+  CHECK_EQUAL(0x00280000ul, board_memory::mem[GPIOA_BASE + 0x00]);
+  CHECK_EQUAL(0x00280000ul, board_memory::mem[GPIOA_BASE + 0x08]);
+  CHECK_EQUAL(0x00140002ul, board_memory::mem[GPIOA_BASE + 0x0C]);
+  CHECK_EQUAL(0x00000770ul, board_memory::mem[GPIOA_BASE + 0x24]);
+  CHECK_EQUAL(0u, board_memory::writes.count(GPIOA_BASE + 0x20));
+  /* GPIOD: MODER, OTYPER, OSPEEDR, PUPDR */
+  CHECK_EQUAL(0x05000000ul, board_memory::mem[GPIOD_BASE + 0x00]);
+  CHECK_EQUAL(1u + 5u + 4u, board_memory::total(board_memory::writes));
+  for(const auto& r : board_memory::writes)
+    CHECK_EQUAL(1u, r.second);
+}
+#endif /* STM32_FAMILY_STM32F4XX */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,267 @@
+#include <stm32xx/gpio_bus.hpp>
+#include <CppUTest/TestHarness.h>
+
+namespace {
+/* Words at any address, indexed by the 14 least significant address bits
+ * (enough to tell GPIO ports A to D apart on all families) */
+struct bus_memory
+{
+  static uint32_t mem[0x1000];
+  static unsigned reads;
+  static unsigned writes;
+  static uint32_t& at(uint32_t addr) { return mem[(addr & 0x3FFFul) >> 2]; }
+  static uint32_t read(uint32_t addr) { ++reads; return at(addr); }
+  static void write(uint32_t addr, uint32_t v) { ++writes; at(addr) = v; }
+  static void clear()
+  {
+    for(uint32_t& x : mem)
+      x = 0ul;
+    reads = writes = 0;
+  }
+};
+uint32_t bus_memory::mem[0x1000];
+unsigned bus_memory::reads = 0;
+unsigned bus_memory::writes = 0;
+
+using stm32xx::gpio::ct::bus;
+
+typedef bus<GPIOB_BASE, 0, 1, 2, 3, 4, 5, 6, 7> low8;
+typedef bus<GPIOB_BASE, 8, 9, 10, 11, 12, 13, 14, 15> high8;
+typedef bus<GPIOB_BASE, 0, 1, 2, 5, 6, 7, 10, 11> lcd8;
+typedef bus<GPIOC_BASE, 7, 6, 5, 4, 3, 2, 1, 0> reversed8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+typedef bus<GPIOA_BASE, 13> single;
+
+using stm32xx::gpio::ct::multi_bus;
+
+/* D0..D5 on PA8..PA13, D6..D9 on PC6..PC9, D10..D11 on PA1..PA0 */
+typedef multi_bus< bus<GPIOA_BASE, 8, 9, 10, 11, 12, 13>,
+                   bus<GPIOC_BASE, 6, 7, 8, 9>,
+                   bus<GPIOA_BASE, 1, 0> > two_ports12;
+/* D0..D15 alternate between ports B and D, D16 on PC15 */
+typedef multi_bus< bus<GPIOB_BASE, 0>, bus<GPIOD_BASE, 0>,
+                   bus<GPIOB_BASE, 1>, bus<GPIOD_BASE, 1>,
+                   bus<GPIOB_BASE, 2>, bus<GPIOD_BASE, 2>,
+                   bus<GPIOB_BASE, 3>, bus<GPIOD_BASE, 3>,
+                   bus<GPIOB_BASE, 12, 13, 14, 15>,
+                   bus<GPIOD_BASE, 12, 13, 14, 15>,
+                   bus<GPIOC_BASE, 15> > three_ports17;
+}
+
+TEST_GROUP(stm32xx__gpio__bus)
+{
+  /* Per-bit reference */
+  template <typename _Bus>
+  static uint32_t
+  reference_bsrr(uint32_t value)
+  {
+    uint32_t set = 0, reset = 0;
+    for(unsigned i = 0; i < _Bus::width; ++i)
+      {
+        if(value & (1ul << i))
+          set |= 1ul << _Bus::map::pins[i];
+        else
+          reset |= 1ul << _Bus::map::pins[i];
+      }
+    return set | (reset << 16);
+  }
+
+  /* Per-bit reference */
+  template <typename _Bus>
+  static uint32_t
+  reference_gather(uint32_t idr)
+  {
+    uint32_t value = 0;
+    for(unsigned i = 0; i < _Bus::width; ++i)
+      if(idr & (1ul << _Bus::map::pins[i]))
+        value |= 1ul << i;
+    return value;
+  }
+
+  template <typename _Bus>
+  static void
+  check_all_values()
+  {
+    for(uint32_t value = 0; value < (1ul << _Bus::width); ++value)
+      CHECK_EQUAL(reference_bsrr<_Bus>(value), _Bus::bsrr(value));
+  }
+
+  template <typename _Bus>
+  static void
+  check_all_idrs()
+  {
+    for(uint32_t idr = 0; idr <= 0xFFFFul; ++idr)
+      CHECK_EQUAL(reference_gather<_Bus>(idr), _Bus::gather(idr));
+  }
+
+  void setup()
+  {
+    bus_memory::clear();
+  }
+};
+
+TEST(stm32xx__gpio__bus, width_and_pins)
+{
+  CHECK_EQUAL(8u,      low8::width);
+  CHECK_EQUAL(0x00FFu, low8::pins);
+  CHECK_EQUAL(0xFF00u, high8::pins);
+  CHECK_EQUAL(0x0CE7u, lcd8::pins);
+  CHECK_EQUAL(0x00FFu, reversed8::pins);
+  CHECK_EQUAL(16u,     shuffled16::width);
+  CHECK_EQUAL(0xFFFFu, shuffled16::pins);
+  CHECK_EQUAL(1u,      single::width);
+  CHECK_EQUAL(0x2000u, single::pins);
+  CHECK_EQUAL(GPIOC_BASE, reversed8::port);
+}
+
+TEST(stm32xx__gpio__bus, steps)
+{
+  CHECK_EQUAL(1u, low8::steps);
+  CHECK_EQUAL(1u, high8::steps);
+  CHECK_EQUAL(3u, lcd8::steps);
+  CHECK_EQUAL(8u, reversed8::steps);
+  CHECK_EQUAL(1u, single::steps);
+  /* pins 4, 5 and 7 are all 4 above their bits, so they share a step */
+  CHECK_EQUAL(2u, (bus<GPIOA_BASE, 4, 5, 14, 7>::steps));
+}
+
+TEST(stm32xx__gpio__bus, bsrr__is_constexpr)
+{
+  static_assert(lcd8::bsrr(0xA5) == 0x04620885ul, "");
+  static_assert(low8::scatter(0x1FF) == 0x00FFul, "");
+  CHECK_EQUAL(0x04620885ul, lcd8::bsrr(0xA5));
+}
+
+TEST(stm32xx__gpio__bus, bsrr__ignores_bits_above_width)
+{
+  CHECK_EQUAL(low8::bsrr(0x5A), low8::bsrr(0xFFFFFF5Aul));
+  CHECK_EQUAL(single::bsrr(0), single::bsrr(0xFFFFFFFEul));
+}
+
+TEST(stm32xx__gpio__bus, bsrr__matches_reference)
+{
+  check_all_values<low8>();
+  check_all_values<high8>();
+  check_all_values<lcd8>();
+  check_all_values<reversed8>();
+  check_all_values<shuffled16>();
+  check_all_values<single>();
+}
+
+TEST(stm32xx__gpio__bus, write__stores_bsrr_once)
+{
+  using stm32xx::gpio::detail::bsrr_offset;
+  lcd8::write<bus_memory>(0x3C);
+  CHECK_EQUAL(0u, bus_memory::reads);
+  CHECK_EQUAL(1u, bus_memory::writes);
+  CHECK_EQUAL(reference_bsrr<lcd8>(0x3C), bus_memory::at(GPIOB_BASE + bsrr_offset));
+}
+
+TEST(stm32xx__gpio__bus, gather__is_constexpr)
+{
+  static_assert(lcd8::gather(0x0885) == 0xA5ul, "");
+  static_assert(lcd8::gather(0xF37A) == 0x1Aul, "");
+  CHECK_EQUAL(0xA5ul, lcd8::gather(0x0885));
+}
+
+TEST(stm32xx__gpio__bus, gather__matches_reference)
+{
+  check_all_idrs<low8>();
+  check_all_idrs<high8>();
+  check_all_idrs<lcd8>();
+  check_all_idrs<reversed8>();
+  check_all_idrs<shuffled16>();
+  check_all_idrs<single>();
+}
+
+TEST(stm32xx__gpio__bus, read__loads_idr_once)
+{
+  using stm32xx::gpio::detail::idr_offset;
+  bus_memory::at(GPIOB_BASE + idr_offset) = 0xF37Aul;
+  CHECK_EQUAL(0x1Aul, lcd8::read<bus_memory>());
+  CHECK_EQUAL(1u, bus_memory::reads);
+  CHECK_EQUAL(0u, bus_memory::writes);
+}
+
+TEST(stm32xx__gpio__bus, multi_bus__width)
+{
+  CHECK_EQUAL(12u, two_ports12::width);
+  CHECK_EQUAL(17u, three_ports17::width);
+}
+
+TEST(stm32xx__gpio__bus, multi_bus__read_matches_reference)
+{
+  using stm32xx::gpio::detail::idr_offset;
+  /* all values, with noise on the other pins */
+  for(uint32_t value = 0; value < (1ul << 12); ++value)
+    {
+      bus_memory::at(GPIOA_BASE + idr_offset) = 0xC0FCul & (value * 0x9E3779B9ul);
+      bus_memory::at(GPIOC_BASE + idr_offset) = 0xFC3Ful & (value * 0x7F4A7C15ul);
+      bus_memory::at(GPIOA_BASE + idr_offset) |= ((value & 0x3Ful) << 8)
+                                              | ((value >> 11) & 1ul)
+                                              | (((value >> 10) & 1ul) << 1);
+      bus_memory::at(GPIOC_BASE + idr_offset) |= ((value >> 6) & 0x0Ful) << 6;
+      CHECK_EQUAL(value, two_ports12::read<bus_memory>());
+    }
+}
+
+TEST(stm32xx__gpio__bus, multi_bus__read_loads_each_port_once)
+{
+  two_ports12::read<bus_memory>();
+  CHECK_EQUAL(2u, bus_memory::reads);
+  bus_memory::clear();
+  three_ports17::read<bus_memory>();
+  CHECK_EQUAL(3u, bus_memory::reads);
+}
+
+TEST(stm32xx__gpio__bus, multi_bus__write_read_roundtrip)
+{
+  using stm32xx::gpio::detail::idr_offset;
+  using stm32xx::gpio::detail::bsrr_offset;
+  const uint32_t ports[] = { GPIOB_BASE, GPIOC_BASE, GPIOD_BASE };
+  for(uint32_t value = 0; value < (1ul << 17); value += 7)
+    {
+      bus_memory::clear();
+      three_ports17::write<bus_memory>(value);
+      CHECK_EQUAL(3u, bus_memory::writes);
+      /* apply BSRR to ODR and loop outputs back to inputs */
+      for(uint32_t port : ports)
+        {
+          const uint32_t bsrr = bus_memory::at(port + bsrr_offset);
+          CHECK_EQUAL(0ul, (bsrr & (bsrr >> 16)) & 0xFFFFul);
+          bus_memory::at(port + idr_offset) = bsrr & 0xFFFFul;
+        }
+      CHECK_EQUAL(value, three_ports17::read<bus_memory>());
+    }
+}
+
+TEST(stm32xx__gpio__bus, multi_bus__write_stores_each_port_once)
+{
+  using stm32xx::gpio::detail::bsrr_offset;
+  two_ports12::write<bus_memory>(0xFFFul);
+  CHECK_EQUAL(0u, bus_memory::reads);
+  CHECK_EQUAL(2u, bus_memory::writes);
+  CHECK_EQUAL(0x00003F03ul, bus_memory::at(GPIOA_BASE + bsrr_offset));
+  CHECK_EQUAL(0x000003C0ul, bus_memory::at(GPIOC_BASE + bsrr_offset));
+  two_ports12::write<bus_memory>(0ul);
+  CHECK_EQUAL(0x3F030000ul, bus_memory::at(GPIOA_BASE + bsrr_offset));
+  CHECK_EQUAL(0x03C00000ul, bus_memory::at(GPIOC_BASE + bsrr_offset));
+}
+
+#if defined STM32_FAMILY_STM32F10X
+#include <sim/mcu.hpp>
+
+TEST(stm32xx__gpio__bus, write__on_sim_drives_odr)
+{
+  sim::mcu& m = sim::instance();
+  m.reset();
+  m.gpiob.ODR.store(0xF318ul);
+  lcd8::write<sim::access>(0xA5);
+  CHECK_EQUAL(0xFB9Dul, m.gpiob.ODR.load());
+  CHECK_EQUAL(0u, m.gpiob.reads());
+  CHECK_EQUAL(1u, m.gpiob.BSRR.writes);
+}
+#endif /* STM32_FAMILY_STM32F10X */
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,210 @@
+#include <stm32xx/gpio_debounce.hpp>
+#include <CppUTest/TestHarness.h>
+#include <map>
+
+namespace {
+/* Input levels of GPIO ports, read from GPIOx_IDR */
+struct trace_input
+{
+  static std::map<uint32_t, uint32_t> idr;
+  static unsigned reads;
+  static uint32_t read(uint32_t addr)
+  {
+    ++reads;
+    return idr[addr - stm32xx::gpio::detail::idr_offset];
+  }
+  static void write(uint32_t, uint32_t) { }
+};
+std::map<uint32_t, uint32_t> trace_input::idr;
+unsigned trace_input::reads = 0u;
+
+/* Per-pin debouncer, the reference: state flips after 4 consecutive
+ * samples which differ from it */
+struct reference_pin
+{
+  bool state;
+  unsigned count;
+  bool pressed;
+  bool released;
+
+  reference_pin() : state(false), count(0u), pressed(false), released(false) {}
+
+  void update(bool sample)
+  {
+    pressed = released = false;
+    if(sample == state)
+      {
+        count = 0u;
+        return;
+      }
+    if(++count < 4u)
+      return;
+    count = 0u;
+    state = sample;
+    pressed = state;
+    released = !state;
+  }
+};
+
+/* Mask of pins for which f(pin) is true */
+template <typename F>
+uint32_t
+pin_mask(const reference_pin* pins, F f)
+{
+  uint32_t mask = 0ul;
+  for(unsigned n = 0; n < 16u; ++n)
+    if(f(pins[n]))
+      mask |= 1ul << n;
+  return mask;
+}
+
+/* Pseudo-random bounce trace: each pin holds its level for a random number
+ * of ticks, short for bounces and long for presses */
+struct bounce_trace
+{
+  uint32_t seed;
+  uint32_t level;
+  unsigned hold[16];
+
+  explicit bounce_trace(uint32_t s) : seed(s), level(0ul)
+  {
+    for(unsigned n = 0; n < 16u; ++n)
+      hold[n] = 0u;
+  }
+  uint32_t random()
+  {
+    seed = seed * 1664525ul + 1013904223ul;
+    return seed >> 16;
+  }
+  uint32_t next()
+  {
+    for(unsigned n = 0; n < 16u; ++n)
+      if(hold[n] == 0u)
+        {
+          level ^= 1ul << n;
+          const uint32_t r = random();
+          hold[n] = (r & 1ul) ? 1u + (r >> 1) % 5u : 1u + (r >> 1) % 30u;
+        }
+      else
+        --hold[n];
+    return level;
+  }
+};
+
+using stm32xx::gpio::debounce;
+using stm32xx::gpio::ct::pin_conf;
+using stm32xx::gpio::ct::pin_conf_on_port;
+
+#if defined STM32_FAMILY_STM32F10X
+typedef pin_conf<GPIO_Pin_All, GPIO_Mode_IPD> all_high;
+typedef pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_IPU> keys_low;
+typedef pin_conf<GPIO_Pin_5, GPIO_Mode_IN_FLOATING> limit_high;
+#elif defined STM32_FAMILY_STM32F4XX
+typedef pin_conf<GPIO_Pin_All, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_DOWN> all_high;
+typedef pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP> keys_low;
+typedef pin_conf<GPIO_Pin_5, GPIO_Mode_IN> limit_high;
+#endif
+typedef pin_conf_on_port<GPIOA_BASE, keys_low> keys;
+typedef pin_conf_on_port<GPIOA_BASE, limit_high> limit;
+typedef pin_conf_on_port<GPIOC_BASE, all_high> port_c;
+}
+
+TEST_GROUP(stm32xx__gpio__debounce)
+{
+  void setup()
+  {
+    trace_input::idr.clear();
+    trace_input::reads = 0u;
+  }
+};
+
+TEST(stm32xx__gpio__debounce, port_count)
+{
+  CHECK_EQUAL(1u, debounce<keys>::port_count);
+  CHECK_EQUAL(1u, (debounce<keys, limit>::port_count));
+  CHECK_EQUAL(2u, (debounce<keys, port_c, limit>::port_count));
+}
+
+TEST(stm32xx__gpio__debounce, one_idr_load_per_port)
+{
+  debounce<keys, port_c, limit> d;
+  d.tick<trace_input>();
+  CHECK_EQUAL(2u, trace_input::reads);
+}
+
+TEST(stm32xx__gpio__debounce, four_stable_samples_change_state)
+{
+  debounce<limit> d;
+  trace_input::idr[GPIOA_BASE] = GPIO_Pin_5;
+  for(unsigned n = 0; n < 3u; ++n)
+    {
+      d.tick<trace_input>();
+      CHECK_EQUAL(0u, d.state<limit>());
+      CHECK_EQUAL(0u, d.pressed<limit>());
+    }
+  d.tick<trace_input>();
+  CHECK_EQUAL(GPIO_Pin_5, d.state<limit>());
+  CHECK_EQUAL(GPIO_Pin_5, d.pressed<limit>());
+  d.tick<trace_input>();
+  CHECK_EQUAL(GPIO_Pin_5, d.state<limit>());
+  CHECK_EQUAL(0u, d.pressed<limit>());
+}
+
+TEST(stm32xx__gpio__debounce, bounce_restarts_count)
+{
+  debounce<limit> d;
+  const uint32_t trace[] = { 1, 1, 1, 0, 1, 1, 1, 1 };
+  for(unsigned n = 0; n < 8u; ++n)
+    {
+      trace_input::idr[GPIOA_BASE] = trace[n] ? GPIO_Pin_5 : 0ul;
+      d.tick<trace_input>();
+      CHECK_EQUAL((n == 7u) ? GPIO_Pin_5 : 0u, d.pressed<limit>());
+    }
+}
+
+TEST(stm32xx__gpio__debounce, active_low_pins)
+{
+  debounce<keys, limit> d;
+  /* pull-ups: keys released when high */
+  trace_input::idr[GPIOA_BASE] = GPIO_Pin_0|GPIO_Pin_1;
+  for(unsigned n = 0; n < 8u; ++n)
+    d.tick<trace_input>();
+  CHECK_EQUAL(0u, d.state<keys>());
+  trace_input::idr[GPIOA_BASE] = GPIO_Pin_0|GPIO_Pin_5;
+  for(unsigned n = 0; n < 4u; ++n)
+    d.tick<trace_input>();
+  CHECK_EQUAL(GPIO_Pin_1, d.state<keys>());
+  CHECK_EQUAL(GPIO_Pin_1, d.pressed<keys>());
+  CHECK_EQUAL(GPIO_Pin_5, d.state<limit>());
+  CHECK_EQUAL(GPIO_Pin_5, d.pressed<limit>());
+  trace_input::idr[GPIOA_BASE] = GPIO_Pin_0|GPIO_Pin_1;
+  for(unsigned n = 0; n < 4u; ++n)
+    d.tick<trace_input>();
+  CHECK_EQUAL(GPIO_Pin_1, d.released<keys>());
+  CHECK_EQUAL(GPIO_Pin_5, d.released<limit>());
+  CHECK_EQUAL(0u, d.pressed<keys>());
+}
+
+TEST(stm32xx__gpio__debounce, same_as_per_pin_reference)
+{
+  debounce<port_c> d;
+  reference_pin ref[16];
+  bounce_trace trace(12345ul);
+  for(unsigned t = 0; t < 2000u; ++t)
+    {
+      const uint32_t level = trace.next();
+      trace_input::idr[GPIOC_BASE] = level;
+      d.tick<trace_input>();
+      for(unsigned n = 0; n < 16u; ++n)
+        ref[n].update(((level >> n) & 1ul) != 0ul);
+      CHECK_EQUAL(pin_mask(ref, [](const reference_pin& p) { return p.state; }),
+                  d.state<port_c>());
+      CHECK_EQUAL(pin_mask(ref, [](const reference_pin& p) { return p.pressed; }),
+                  d.pressed<port_c>());
+      CHECK_EQUAL(pin_mask(ref, [](const reference_pin& p) { return p.released; }),
+                  d.released<port_c>());
+    }
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
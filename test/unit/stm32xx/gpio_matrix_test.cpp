@@ -0,0 +1,255 @@
+#include <stm32xx/gpio_matrix.hpp>
+#include <CppUTest/TestHarness.h>
+#include <map>
+#include <vector>
+
+namespace {
+/* Pin on a port */
+struct pin_at
+{
+  uint32_t port;
+  unsigned pin;
+};
+
+/* Key matrix without diodes, wired to GPIO pins: the level of a column is
+ * low if it is connected to a row driven low, through pressed keys and
+ * rows or columns which are not driven (the cause of ghosting) */
+struct keypad_sim
+{
+  static std::vector<pin_at> row_pins;
+  static std::vector<pin_at> col_pins;
+  static bool down[8][8];
+  static std::map<uint32_t, uint32_t> odr;
+  static unsigned loads;
+  static unsigned stores;
+
+  static void reset(const std::vector<pin_at>& r, const std::vector<pin_at>& c)
+  {
+    row_pins = r;
+    col_pins = c;
+    for(unsigned i = 0; i < 8u; ++i)
+      for(unsigned j = 0; j < 8u; ++j)
+        down[i][j] = false;
+    odr.clear();
+    loads = stores = 0u;
+  }
+
+  static bool driven_low(unsigned r)
+  {
+    const pin_at& p = row_pins[r];
+    return odr.count(p.port) && ((odr[p.port] >> p.pin) & 1ul) == 0ul;
+  }
+
+  static uint32_t read(uint32_t addr)
+  {
+    using stm32xx::gpio::detail::idr_offset;
+    ++loads;
+    const uint32_t port = addr - idr_offset;
+    bool row_low[8] = { false };
+    bool col_low[8] = { false };
+    for(unsigned r = 0; r < row_pins.size(); ++r)
+      row_low[r] = driven_low(r);
+    for(bool changed = true; changed; )
+      {
+        changed = false;
+        for(unsigned r = 0; r < row_pins.size(); ++r)
+          for(unsigned c = 0; c < col_pins.size(); ++c)
+            if(down[r][c] && row_low[r] != col_low[c])
+              row_low[r] = col_low[c] = changed = true;
+      }
+    uint32_t idr = 0xFFFFul;
+    for(unsigned c = 0; c < col_pins.size(); ++c)
+      if(col_pins[c].port == port && col_low[c])
+        idr &= ~(1ul << col_pins[c].pin);
+    return idr;
+  }
+
+  static void write(uint32_t addr, uint32_t value)
+  {
+    using stm32xx::gpio::detail::bsrr_offset;
+    ++stores;
+    uint32_t& o = odr.insert(std::make_pair(addr - bsrr_offset, 0xFFFFul)).first->second;
+    o = (o & ~(value >> 16)) | (value & 0xFFFFul);
+  }
+};
+std::vector<pin_at> keypad_sim::row_pins;
+std::vector<pin_at> keypad_sim::col_pins;
+bool keypad_sim::down[8][8];
+std::map<uint32_t, uint32_t> keypad_sim::odr;
+unsigned keypad_sim::loads = 0u;
+unsigned keypad_sim::stores = 0u;
+
+using stm32xx::gpio::matrix;
+using stm32xx::gpio::ct::bus;
+using stm32xx::gpio::ct::multi_bus;
+
+/* 8x8 keyboard: rows on PB8..PB15, columns on PA0..PA3 and PC10..PC13 */
+typedef bus<GPIOB_BASE, 8, 9, 10, 11, 12, 13, 14, 15> rows8;
+typedef multi_bus< bus<GPIOA_BASE, 0, 1, 2, 3>,
+                   bus<GPIOC_BASE, 10, 11, 12, 13> > cols8;
+typedef matrix<rows8, cols8> keyboard;
+
+/* 4x3 keypad on a single port: rows on PA4..PA7, columns on PA0..PA2 */
+typedef matrix< bus<GPIOA_BASE, 4, 5, 6, 7>, bus<GPIOA_BASE, 0, 1, 2> > keypad;
+
+void
+use_keyboard()
+{
+  std::vector<pin_at> r, c;
+  for(unsigned n = 0; n < 8u; ++n)
+    r.push_back(pin_at{ GPIOB_BASE, 8u + n });
+  for(unsigned n = 0; n < 4u; ++n)
+    c.push_back(pin_at{ GPIOA_BASE, n });
+  for(unsigned n = 0; n < 4u; ++n)
+    c.push_back(pin_at{ GPIOC_BASE, 10u + n });
+  keypad_sim::reset(r, c);
+}
+
+void
+use_keypad()
+{
+  std::vector<pin_at> r, c;
+  for(unsigned n = 0; n < 4u; ++n)
+    r.push_back(pin_at{ GPIOA_BASE, 4u + n });
+  for(unsigned n = 0; n < 3u; ++n)
+    c.push_back(pin_at{ GPIOA_BASE, n });
+  keypad_sim::reset(r, c);
+}
+}
+
+TEST_GROUP(stm32xx__gpio__matrix)
+{
+  void setup()
+  {
+    use_keyboard();
+  }
+};
+
+TEST(stm32xx__gpio__matrix, dimensions)
+{
+  CHECK_EQUAL(8u, keyboard::rows);
+  CHECK_EQUAL(8u, keyboard::cols);
+  CHECK(~0ull == keyboard::keys);
+  CHECK_EQUAL(4u, keypad::rows);
+  CHECK_EQUAL(3u, keypad::cols);
+  CHECK(0xFFFull == keypad::keys);
+  CHECK(keypad::key(0, 0) == 1ull);
+  CHECK(keypad::key(2, 1) == (1ull << 7));
+  CHECK(keyboard::key(7, 7) == (1ull << 63));
+}
+
+TEST(stm32xx__gpio__matrix, sample__no_keys)
+{
+  CHECK(0ull == keyboard::sample<keypad_sim>());
+}
+
+TEST(stm32xx__gpio__matrix, sample__accesses)
+{
+  keyboard::sample<keypad_sim>();
+  /* one store per row, one to release the rows, one load per column port
+   * and row */
+  CHECK_EQUAL(9u, keypad_sim::stores);
+  CHECK_EQUAL(16u, keypad_sim::loads);
+  CHECK_EQUAL(0xFFFFul, keypad_sim::odr[GPIOB_BASE]);
+}
+
+TEST(stm32xx__gpio__matrix, sample__keys)
+{
+  keypad_sim::down[0][0] = true;
+  keypad_sim::down[3][5] = true;
+  keypad_sim::down[7][7] = true;
+  CHECK(keyboard::sample<keypad_sim>() ==
+        (keyboard::key(0, 0) | keyboard::key(3, 5) | keyboard::key(7, 7)));
+}
+
+TEST(stm32xx__gpio__matrix, sample__single_port)
+{
+  use_keypad();
+  keypad_sim::down[1][2] = true;
+  keypad_sim::down[3][0] = true;
+  CHECK(keypad::sample<keypad_sim>() == (keypad::key(1, 2) | keypad::key(3, 0)));
+  CHECK_EQUAL(5u, keypad_sim::stores);
+  CHECK_EQUAL(4u, keypad_sim::loads);
+  CHECK_EQUAL(0xFFFFul, keypad_sim::odr[GPIOA_BASE]);
+}
+
+TEST(stm32xx__gpio__matrix, is_ghosting)
+{
+  CHECK(!keyboard::is_ghosting(0ull));
+  /* a full row, and a full column */
+  CHECK(!keyboard::is_ghosting(0xFFull << 8));
+  CHECK(!keyboard::is_ghosting(0x0101010101010101ull));
+  /* two rows sharing one column */
+  CHECK(!keyboard::is_ghosting(keyboard::key(1, 2) | keyboard::key(1, 3) | keyboard::key(6, 3)));
+  /* rectangles */
+  CHECK(keyboard::is_ghosting(keyboard::key(1, 2) | keyboard::key(1, 6) |
+                              keyboard::key(5, 2) | keyboard::key(5, 6)));
+  CHECK(keyboard::is_ghosting(keyboard::key(0, 0) | keyboard::key(0, 7) |
+                              keyboard::key(7, 0) | keyboard::key(7, 7)));
+  CHECK(keypad::is_ghosting(keypad::key(0, 1) | keypad::key(0, 2) |
+                            keypad::key(3, 1) | keypad::key(3, 2)));
+}
+
+TEST(stm32xx__gpio__matrix, scan__debounces)
+{
+  keyboard kb;
+  keypad_sim::down[2][6] = true;
+  for(unsigned n = 0; n < 3u; ++n)
+    {
+      kb.scan<keypad_sim>();
+      CHECK(0ull == kb.state());
+    }
+  kb.scan<keypad_sim>();
+  CHECK(keyboard::key(2, 6) == kb.state());
+  CHECK(keyboard::key(2, 6) == kb.pressed());
+  kb.scan<keypad_sim>();
+  CHECK(0ull == kb.pressed());
+  keypad_sim::down[2][6] = false;
+  for(unsigned n = 0; n < 4u; ++n)
+    kb.scan<keypad_sim>();
+  CHECK(0ull == kb.state());
+  CHECK(keyboard::key(2, 6) == kb.released());
+}
+
+TEST(stm32xx__gpio__matrix, scan__bounce_restarts_count)
+{
+  keyboard kb;
+  const bool trace[] = { true, true, true, false, true, true, true, true };
+  for(unsigned n = 0; n < 8u; ++n)
+    {
+      keypad_sim::down[4][1] = trace[n];
+      kb.scan<keypad_sim>();
+      CHECK(((n == 7u) ? keyboard::key(4, 1) : 0ull) == kb.pressed());
+    }
+}
+
+TEST(stm32xx__gpio__matrix, scan__ghosting)
+{
+  keyboard kb;
+  keypad_sim::down[1][2] = true;
+  keypad_sim::down[1][5] = true;
+  for(unsigned n = 0; n < 4u; ++n)
+    kb.scan<keypad_sim>();
+  CHECK(!kb.ghosting());
+  const uint64_t two = keyboard::key(1, 2) | keyboard::key(1, 5);
+  CHECK(two == kb.state());
+  /* third corner: the fourth one (6, 5) reads pressed too */
+  keypad_sim::down[6][2] = true;
+  CHECK(keyboard::sample<keypad_sim>() == (two | keyboard::key(6, 2) | keyboard::key(6, 5)));
+  for(unsigned n = 0; n < 8u; ++n)
+    {
+      kb.scan<keypad_sim>();
+      CHECK(kb.ghosting());
+      CHECK(two == kb.state());
+      CHECK(0ull == kb.pressed());
+    }
+  /* the first key released: no more ghost */
+  keypad_sim::down[1][2] = false;
+  for(unsigned n = 0; n < 4u; ++n)
+    kb.scan<keypad_sim>();
+  CHECK(!kb.ghosting());
+  CHECK((keyboard::key(1, 5) | keyboard::key(6, 2)) == kb.state());
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -18,10 +18,12 @@
 #endif
 
 #if defined STM32_FAMILY_STM32F4XX
+# define _HAVE_GPIO_MODER_REGISTER
 #endif
 
 TEST_GROUP(stm32xx__gpio__ct)
 {
+#if defined _HAVE_GPIO_CRL_REGISTER && defined _HAVE_GPIO_CRH_REGISTER
   template <GPIOMode_TypeDef _mode> 
   struct check_crl_cnf_bits
   {
@@ -304,6 +306,7 @@ TEST_GROUP(stm32xx__gpio__ct)
       CHECK_EQUAL((0x0Ful << 0x18), (crh_mask<GPIO_Pin_14>::value));
       CHECK_EQUAL((0x0Ful << 0x1C), (crh_mask<GPIO_Pin_15>::value));
   }
+#endif /* _HAVE_GPIO_CRL_REGISTER && _HAVE_GPIO_CRH_REGISTER */
 };
 
 /*
@@ -652,3 +655,934 @@ TEST(stm32xx__gpio__ct, crh_mode_bits__gpio_speed_50MHz)
 }
 # endif
 #endif /* _HAVE_GPIO_CRH_REGISTER */
+
+/*
+ * crl_masked, crh_masked, port_conf
+ */
+#if defined _HAVE_GPIO_CRL_REGISTER && defined _HAVE_GPIO_CRH_REGISTER
+# if defined _HAVE_GPIO_MODE_Out_PP && defined _HAVE_GPIO_SPEED_2MHz
+TEST(stm32xx__gpio__ct, crl_masked__gpio_mode_out_pp__speed_2MHz)
+{
+  using namespace stm32xx::gpio::ct;
+  using m = crl_masked<GPIO_Pin_1|GPIO_Pin_8, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  CHECK_EQUAL(0x00000020ul, m::bits);
+  CHECK_EQUAL(0x000000F0ul, m::mask);
+}
+
+TEST(stm32xx__gpio__ct, crh_masked__gpio_mode_out_pp__speed_2MHz)
+{
+  using namespace stm32xx::gpio::ct;
+  using m = crh_masked<GPIO_Pin_1|GPIO_Pin_8, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  CHECK_EQUAL(0x00000002ul, m::bits);
+  CHECK_EQUAL(0x0000000Ful, m::mask);
+}
+# endif
+
+# if defined _HAVE_GPIO_MODE_Out_PP && defined _HAVE_GPIO_MODE_IPU && \
+     defined _HAVE_GPIO_MODE_AF_PP && defined _HAVE_GPIO_SPEED_2MHz && \
+     defined _HAVE_GPIO_SPEED_50MHz
+TEST(stm32xx__gpio__ct, port_conf__mixes_pin_confs)
+{
+  using namespace stm32xx::gpio::ct;
+  using leds    = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using buttons = pin_conf<GPIO_Pin_7|GPIO_Pin_8, GPIO_Mode_IPU>;
+  using usart   = pin_conf<GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  using conf = port_conf<leds, buttons, usart>;
+  CHECK_EQUAL(0x80000022ul, conf::crl::bits);
+  CHECK_EQUAL(0xF00000FFul, conf::crl::mask);
+  CHECK_EQUAL(0x00000B08ul, conf::crh::bits);
+  CHECK_EQUAL(0x00000F0Ful, conf::crh::mask);
+}
+
+TEST(stm32xx__gpio__ct, port_conf__in)
+{
+  using namespace stm32xx::gpio::ct;
+  using leds    = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using buttons = pin_conf<GPIO_Pin_7|GPIO_Pin_8, GPIO_Mode_IPU>;
+  using usart   = pin_conf<GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  GPIO_TypeDef port;
+  port.CRL = 0x44444444ul;
+  port.CRH = 0x44444444ul;
+  port_conf<leds, buttons, usart>::in(port);
+  CHECK_EQUAL(0x84444422ul, port.CRL);
+  CHECK_EQUAL(0x44444B48ul, port.CRH);
+}
+# endif
+
+TEST(stm32xx__gpio__ct, port_conf__with_no_args)
+{
+  using namespace stm32xx::gpio::ct;
+  GPIO_TypeDef port;
+  port.CRL = 0x44444444ul;
+  port.CRH = 0x44444444ul;
+  port_conf<>::in(port);
+  CHECK_EQUAL(0x44444444ul, port.CRL);
+  CHECK_EQUAL(0x44444444ul, port.CRH);
+}
+#endif /* _HAVE_GPIO_CRL_REGISTER && _HAVE_GPIO_CRH_REGISTER */
+
+TEST_GROUP(stm32xx__gpio__rt)
+{
+#if defined _HAVE_GPIO_CRL_REGISTER && defined _HAVE_GPIO_CRH_REGISTER
+  /* Per-pin reference, as in StdPeriph's GPIO_Init(), with the BRR/BSRR
+   * writes of GPIO_Mode_IPD/GPIO_Mode_IPU applied to ODR */
+  static void
+  reference_configure(GPIO_TypeDef* port, stm32xx::gpio::pins_t pins,
+                      GPIOMode_TypeDef mode, GPIOSpeed_TypeDef speed)
+  {
+    uint32_t cm = (mode & 0x0Cul)
+                | (((mode & 0x10ul) != 0) ? (speed & 0x03ul) : 0ul);
+    for(unsigned pin = 0; pin < 16; ++pin)
+      {
+        if(pins & (1ul << pin))
+          {
+            volatile uint32_t& reg = (pin < 8) ? port->CRL : port->CRH;
+            unsigned shift = (pin & 0x07) << 2;
+            reg = (reg & ~(0x0Ful << shift)) | (cm << shift);
+            if(mode == GPIO_Mode_IPD)
+              port->ODR &= ~(1ul << pin);
+            else if(mode == GPIO_Mode_IPU)
+              port->ODR |= (1ul << pin);
+          }
+      }
+  }
+
+  /* ODR after the (plain memory) BSRR of port was written */
+  static uint32_t
+  odr_after_bsrr(GPIO_TypeDef const& port)
+  {
+    return (port.ODR & ~(port.BSRR >> 16)) | (port.BSRR & 0xFFFFul);
+  }
+#endif /* _HAVE_GPIO_CRL_REGISTER && _HAVE_GPIO_CRH_REGISTER */
+};
+
+#if defined _HAVE_GPIO_CRL_REGISTER && defined _HAVE_GPIO_CRH_REGISTER
+
+TEST(stm32xx__gpio__rt, configure__matches_reference)
+{
+  using namespace stm32xx::gpio;
+  const GPIOMode_TypeDef modes[] = {
+    GPIO_Mode_AIN, GPIO_Mode_IN_FLOATING, GPIO_Mode_IPD, GPIO_Mode_IPU,
+    GPIO_Mode_Out_OD, GPIO_Mode_Out_PP, GPIO_Mode_AF_OD, GPIO_Mode_AF_PP
+  };
+  const GPIOSpeed_TypeDef speeds[] = {
+    GPIO_Speed_10MHz, GPIO_Speed_2MHz, GPIO_Speed_50MHz
+  };
+  for(uint32_t pins = 0; pins <= 0xFFFFul; ++pins)
+    for(GPIOMode_TypeDef mode : modes)
+      for(GPIOSpeed_TypeDef speed : speeds)
+        {
+          GPIO_TypeDef port, ref;
+          port.CRL = ref.CRL = 0x12345678ul;
+          port.CRH = ref.CRH = 0x9ABCDEF0ul;
+          port.ODR = ref.ODR = 0x00005A5Aul;
+          port.BSRR = 0ul;
+          rt::configure(&port, pins, mode, speed);
+          reference_configure(&ref, pins, mode, speed);
+          CHECK_EQUAL(ref.CRL, port.CRL);
+          CHECK_EQUAL(ref.CRH, port.CRH);
+          CHECK_EQUAL(ref.ODR, odr_after_bsrr(port));
+        }
+}
+
+# if defined _HAVE_GPIO_MODE_Out_PP && defined _HAVE_GPIO_MODE_IPU && \
+     defined _HAVE_GPIO_SPEED_2MHz
+TEST(stm32xx__gpio__rt, configure__agrees_with_ct)
+{
+  using namespace stm32xx::gpio;
+  using leds    = ct::pin_conf<GPIO_Pin_0|GPIO_Pin_9, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using buttons = ct::pin_conf<GPIO_Pin_7|GPIO_Pin_8, GPIO_Mode_IPU>;
+  GPIO_TypeDef port, ref;
+  port.CRL = ref.CRL = 0x44444444ul;
+  port.CRH = ref.CRH = 0x44444444ul;
+  rt::configure(&port, leds::pins, leds::mode, leds::speed);
+  rt::configure(&port, buttons::pins, buttons::mode);
+  ct::port_conf<leds, buttons>::in(ref);
+  CHECK_EQUAL(ref.CRL, port.CRL);
+  CHECK_EQUAL(ref.CRH, port.CRH);
+}
+# endif
+#endif /* _HAVE_GPIO_CRL_REGISTER && _HAVE_GPIO_CRH_REGISTER */
+
+#if defined _HAVE_GPIO_CRL_REGISTER && defined _HAVE_GPIO_CRH_REGISTER
+TEST_GROUP(stm32xx__gpio__detail)
+{
+  /* Per-pin reference for the (cnf|mode)_(bits|mask) functions */
+  static uint32_t
+  reference(uint32_t pins, uint32_t field)
+  {
+    uint32_t result = 0;
+    for(unsigned pin = 0; pin < 8; ++pin)
+      if(pins & (1ul << pin))
+        result |= field << (pin << 2);
+    return result;
+  }
+};
+
+TEST(stm32xx__gpio__detail, all_pin_masks)
+{
+  using namespace stm32xx::gpio::detail;
+  const GPIOMode_TypeDef mode = GPIO_Mode_AF_OD;
+  const GPIOSpeed_TypeDef speed = GPIO_Speed_50MHz;
+  for(uint32_t pins = 0; pins <= 0xFFFFul; ++pins)
+    {
+      const uint32_t lo = pins & 0xFF, hi = pins >> 8;
+      CHECK_EQUAL(reference(lo, mode & 0x0Cul),  crl_cnf_bits(pins, mode));
+      CHECK_EQUAL(reference(lo, 0x0Cul),         crl_cnf_mask(pins));
+      CHECK_EQUAL(reference(lo, speed & 0x03ul), crl_mode_bits(pins, speed));
+      CHECK_EQUAL(reference(lo, 0x03ul),         crl_mode_mask(pins));
+      CHECK_EQUAL(reference(hi, mode & 0x0Cul),  crh_cnf_bits(pins, mode));
+      CHECK_EQUAL(reference(hi, 0x0Cul),         crh_cnf_mask(pins));
+      CHECK_EQUAL(reference(hi, speed & 0x03ul), crh_mode_bits(pins, speed));
+      CHECK_EQUAL(reference(hi, 0x03ul),         crh_mode_mask(pins));
+    }
+}
+#endif /* _HAVE_GPIO_CRL_REGISTER && _HAVE_GPIO_CRH_REGISTER */
+
+#if defined _HAVE_GPIO_MODER_REGISTER
+/*
+ * STM32F4xx: MODER, OTYPER, OSPEEDR, PUPDR, AFRL, AFRH
+ */
+TEST_GROUP(stm32xx__gpio__f4)
+{
+  /* Per-pin reference, as in StdPeriph's GPIO_Init() and GPIO_PinAFConfig() */
+  static void
+  reference_configure(GPIO_TypeDef* port, uint32_t pins, GPIOMode_TypeDef mode,
+                      GPIOOType_TypeDef otype, GPIOSpeed_TypeDef speed,
+                      GPIOPuPd_TypeDef pupd, uint8_t af)
+  {
+    for(unsigned pin = 0; pin < 16; ++pin)
+      {
+        if(!(pins & (1ul << pin)))
+          continue;
+        const unsigned shift2 = pin << 1, shift4 = (pin & 0x07) << 2;
+        port->MODER = (port->MODER & ~(0x03ul << shift2)) | (mode << shift2);
+        if(mode == GPIO_Mode_OUT || mode == GPIO_Mode_AF)
+          {
+            port->OSPEEDR = (port->OSPEEDR & ~(0x03ul << shift2)) | (speed << shift2);
+            port->OTYPER = (port->OTYPER & ~(0x01ul << pin)) | (otype << pin);
+          }
+        port->PUPDR = (port->PUPDR & ~(0x03ul << shift2)) | (pupd << shift2);
+        if(mode == GPIO_Mode_AF)
+          port->AFR[pin >> 3] = (port->AFR[pin >> 3] & ~(0x0Ful << shift4))
+                              | ((uint32_t)af << shift4);
+      }
+  }
+
+  static void
+  fill(GPIO_TypeDef& port)
+  {
+    port.MODER   = 0x12345678ul;
+    port.OTYPER  = 0x00009ABCul;
+    port.OSPEEDR = 0xDEF01234ul;
+    port.PUPDR   = 0x56789ABCul;
+    port.AFR[0]  = 0xDEF01234ul;
+    port.AFR[1]  = 0x56789ABCul;
+  }
+
+  static void
+  check_equal(GPIO_TypeDef const& expected, GPIO_TypeDef const& actual)
+  {
+    CHECK_EQUAL(expected.MODER,   actual.MODER);
+    CHECK_EQUAL(expected.OTYPER,  actual.OTYPER);
+    CHECK_EQUAL(expected.OSPEEDR, actual.OSPEEDR);
+    CHECK_EQUAL(expected.PUPDR,   actual.PUPDR);
+    CHECK_EQUAL(expected.AFR[0],  actual.AFR[0]);
+    CHECK_EQUAL(expected.AFR[1],  actual.AFR[1]);
+  }
+};
+
+TEST(stm32xx__gpio__f4, detail__is_output)
+{
+  using namespace stm32xx::gpio::detail;
+  CHECK_EQUAL(0ul, is_output(GPIO_Mode_IN));
+  CHECK_EQUAL(1ul, is_output(GPIO_Mode_OUT));
+  CHECK_EQUAL(1ul, is_output(GPIO_Mode_AF));
+  CHECK_EQUAL(0ul, is_output(GPIO_Mode_AN));
+}
+
+TEST(stm32xx__gpio__f4, detail__is_af)
+{
+  using namespace stm32xx::gpio::detail;
+  CHECK_EQUAL(0ul, is_af(GPIO_Mode_IN));
+  CHECK_EQUAL(0ul, is_af(GPIO_Mode_OUT));
+  CHECK_EQUAL(1ul, is_af(GPIO_Mode_AF));
+  CHECK_EQUAL(0ul, is_af(GPIO_Mode_AN));
+}
+
+TEST(stm32xx__gpio__f4, detail__all_pin_masks)
+{
+  using namespace stm32xx::gpio::detail;
+  for(uint32_t pins = 0; pins <= 0xFFFFul; ++pins)
+    {
+      uint32_t pairs = 0, afrl = 0, afrh = 0;
+      for(unsigned pin = 0; pin < 16; ++pin)
+        if(pins & (1ul << pin))
+          {
+            pairs |= 0x03ul << (pin << 1);
+            if(pin < 8)
+              afrl |= 0x0Ful << (pin << 2);
+            else
+              afrh |= 0x0Ful << ((pin - 8) << 2);
+          }
+      CHECK_EQUAL(pairs,  moder_mask(pins));
+      CHECK_EQUAL(pairs,  pupdr_mask(pins));
+      CHECK_EQUAL(pairs,  ospeedr_mask(pins, GPIO_Mode_OUT));
+      CHECK_EQUAL(pins,   otyper_mask(pins, GPIO_Mode_AF));
+      CHECK_EQUAL(afrl,   afrl_mask(pins, GPIO_Mode_AF));
+      CHECK_EQUAL(afrh,   afrh_mask(pins, GPIO_Mode_AF));
+      CHECK_EQUAL(pairs & 0x55555555ul, moder_bits(pins, GPIO_Mode_OUT));
+      CHECK_EQUAL(pairs & 0xAAAAAAAAul, pupdr_bits(pins, GPIO_PuPd_DOWN));
+      CHECK_EQUAL(pairs,  ospeedr_bits(pins, GPIO_Mode_AF, GPIO_Speed_100MHz));
+      CHECK_EQUAL(pins,   otyper_bits(pins, GPIO_Mode_OUT, GPIO_OType_OD));
+      CHECK_EQUAL(afrl & 0x77777777ul, afrl_bits(pins, GPIO_Mode_AF, GPIO_AF_USART1));
+      CHECK_EQUAL(afrh & 0x77777777ul, afrh_bits(pins, GPIO_Mode_AF, GPIO_AF_USART1));
+    }
+}
+
+TEST(stm32xx__gpio__f4, detail__input_masks_are_empty)
+{
+  using namespace stm32xx::gpio::detail;
+  CHECK_EQUAL(0ul, otyper_mask(0xFFFFul, GPIO_Mode_IN));
+  CHECK_EQUAL(0ul, ospeedr_mask(0xFFFFul, GPIO_Mode_AN));
+  CHECK_EQUAL(0ul, afrl_mask(0xFFFFul, GPIO_Mode_OUT));
+  CHECK_EQUAL(0ul, afrh_mask(0xFFFFul, GPIO_Mode_IN));
+  CHECK_EQUAL(0ul, otyper_bits(0xFFFFul, GPIO_Mode_IN, GPIO_OType_OD));
+  CHECK_EQUAL(0ul, ospeedr_bits(0xFFFFul, GPIO_Mode_AN, GPIO_Speed_100MHz));
+  CHECK_EQUAL(0ul, afrl_bits(0xFFFFul, GPIO_Mode_OUT, 0x0F));
+  CHECK_EQUAL(0ul, afrh_bits(0xFFFFul, GPIO_Mode_IN, 0x0F));
+}
+
+TEST(stm32xx__gpio__f4, ct__pin_conf__defaults)
+{
+  using namespace stm32xx::gpio::ct;
+  typedef pin_conf<GPIO_Pin_3, GPIO_Mode_IN> conf;
+  CHECK_EQUAL(GPIO_Pin_3, conf::pins);
+  CHECK_EQUAL(GPIO_Mode_IN, conf::mode);
+  CHECK_EQUAL(GPIO_OType_PP, conf::otype);
+  CHECK_EQUAL(GPIO_Speed_2MHz, conf::speed);
+  CHECK_EQUAL(GPIO_PuPd_NOPULL, conf::pupd);
+  CHECK_EQUAL(0, conf::af);
+}
+
+TEST(stm32xx__gpio__f4, ct__masked)
+{
+  using namespace stm32xx::gpio::ct;
+  const uint32_t pins = GPIO_Pin_1 | GPIO_Pin_9;
+  CHECK_EQUAL(0x00080008ul, (moder_masked<pins, GPIO_Mode_AF>::bits));
+  CHECK_EQUAL(0x000C000Cul, (moder_masked<pins, GPIO_Mode_AF>::mask));
+  CHECK_EQUAL(0x00000202ul, (otyper_masked<pins, GPIO_Mode_AF, GPIO_OType_OD>::bits));
+  CHECK_EQUAL(0x00000202ul, (otyper_masked<pins, GPIO_Mode_AF, GPIO_OType_OD>::mask));
+  CHECK_EQUAL(0x00040004ul, (ospeedr_masked<pins, GPIO_Mode_OUT, GPIO_Speed_25MHz>::bits));
+  CHECK_EQUAL(0x000C000Cul, (ospeedr_masked<pins, GPIO_Mode_OUT, GPIO_Speed_25MHz>::mask));
+  CHECK_EQUAL(0x00040004ul, (pupdr_masked<pins, GPIO_PuPd_UP>::bits));
+  CHECK_EQUAL(0x000C000Cul, (pupdr_masked<pins, GPIO_PuPd_UP>::mask));
+  CHECK_EQUAL(0x00000070ul, (afrl_masked<pins, GPIO_Mode_AF, GPIO_AF_USART1>::bits));
+  CHECK_EQUAL(0x000000F0ul, (afrl_masked<pins, GPIO_Mode_AF, GPIO_AF_USART1>::mask));
+  CHECK_EQUAL(0x00000070ul, (afrh_masked<pins, GPIO_Mode_AF, GPIO_AF_USART1>::bits));
+  CHECK_EQUAL(0x000000F0ul, (afrh_masked<pins, GPIO_Mode_AF, GPIO_AF_USART1>::mask));
+  CHECK_EQUAL(0ul, (otyper_masked<pins, GPIO_Mode_IN, GPIO_OType_PP>::mask));
+  CHECK_EQUAL(0ul, (ospeedr_masked<pins, GPIO_Mode_AN, GPIO_Speed_2MHz>::mask));
+  CHECK_EQUAL(0ul, (afrl_masked<pins, GPIO_Mode_OUT, 0>::mask));
+  CHECK_EQUAL(0ul, (afrh_masked<pins, GPIO_Mode_OUT, 0>::mask));
+}
+
+TEST(stm32xx__gpio__f4, ct__port_conf__in)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_0|GPIO_Pin_12, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_50MHz> leds;
+  typedef ct::pin_conf<GPIO_Pin_4, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_UP> btns;
+  typedef ct::pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_100MHz,
+                       GPIO_PuPd_NOPULL, GPIO_AF_USART1> usart;
+  GPIO_TypeDef port, ref;
+  fill(port);
+  fill(ref);
+  ct::port_conf<leds, btns, usart>::in(port);
+  reference_configure(&ref, leds::pins, leds::mode, leds::otype, leds::speed, leds::pupd, leds::af);
+  reference_configure(&ref, btns::pins, btns::mode, btns::otype, btns::speed, btns::pupd, btns::af);
+  reference_configure(&ref, usart::pins, usart::mode, usart::otype, usart::speed, usart::pupd, usart::af);
+  check_equal(ref, port);
+}
+
+TEST(stm32xx__gpio__f4, ct__port_conf__inputs_only)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_All, GPIO_Mode_AN> analog;
+  typedef ct::port_conf<analog> conf;
+  CHECK_EQUAL(0xFFFFFFFFul, conf::moder::mask);
+  CHECK_EQUAL(0ul, conf::otyper::mask);
+  CHECK_EQUAL(0ul, conf::ospeedr::mask);
+  CHECK_EQUAL(0ul, conf::afrl::mask);
+  CHECK_EQUAL(0ul, conf::afrh::mask);
+  GPIO_TypeDef port, ref;
+  fill(port);
+  fill(ref);
+  conf::in(port);
+  ref.MODER = 0xFFFFFFFFul;
+  ref.PUPDR = 0ul;
+  check_equal(ref, port);
+}
+
+TEST(stm32xx__gpio__f4, ct__port_conf__with_no_args)
+{
+  using namespace stm32xx::gpio;
+  GPIO_TypeDef port, ref;
+  fill(port);
+  fill(ref);
+  ct::port_conf<>::in(port);
+  check_equal(ref, port);
+}
+
+TEST(stm32xx__gpio__f4, rt__configure__matches_reference)
+{
+  using namespace stm32xx::gpio;
+  const GPIOMode_TypeDef modes[] = {
+    GPIO_Mode_IN, GPIO_Mode_OUT, GPIO_Mode_AF, GPIO_Mode_AN
+  };
+  const GPIOPuPd_TypeDef pupds[] = {
+    GPIO_PuPd_NOPULL, GPIO_PuPd_UP, GPIO_PuPd_DOWN
+  };
+  for(uint32_t pins = 0; pins <= 0xFFFFul; ++pins)
+    for(GPIOMode_TypeDef mode : modes)
+      {
+        /* walk through the remaining parameters along with pins */
+        const GPIOOType_TypeDef otype = (GPIOOType_TypeDef)(pins & 0x01);
+        const GPIOSpeed_TypeDef speed = (GPIOSpeed_TypeDef)((pins >> 1) & 0x03);
+        const GPIOPuPd_TypeDef pupd = pupds[(pins >> 3) % 3];
+        const uint8_t af = (pins >> 5) & 0x0F;
+        GPIO_TypeDef port, ref;
+        fill(port);
+        fill(ref);
+        rt::configure(&port, pins, mode, otype, speed, pupd, af);
+        reference_configure(&ref, pins, mode, otype, speed, pupd, af);
+        check_equal(ref, port);
+      }
+}
+
+TEST(stm32xx__gpio__f4, rt__configure__agrees_with_ct)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_5, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_25MHz> led;
+  typedef ct::pin_conf<GPIO_Pin_13, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz, GPIO_PuPd_DOWN> btn;
+  typedef ct::pin_conf<GPIO_Pin_2|GPIO_Pin_3, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP, GPIO_AF_USART2> usart;
+  GPIO_TypeDef port, ref;
+  fill(port);
+  fill(ref);
+  rt::configure(&port, led::pins, led::mode, led::otype, led::speed);
+  rt::configure(&port, btn::pins, btn::mode, btn::otype, btn::speed, btn::pupd);
+  rt::configure(&port, usart::pins, usart::mode, usart::otype, usart::speed, usart::pupd, usart::af);
+  ct::port_conf<led, btn, usart>::in(ref);
+  check_equal(ref, port);
+}
+
+TEST(stm32xx__gpio__f4, ct__transition__same_as_port_conf)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP, GPIO_AF_USART2> tx;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP> gpio;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_AN> analog;
+  typedef ct::pin_conf<GPIO_Pin_9, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_2MHz> led;
+  typedef ct::port_conf<tx, led> from;
+  typedef ct::port_conf<gpio, led> to;
+  GPIO_TypeDef port, ref;
+  fill(port);
+  from::in(port);
+  ref = port;
+  ct::transition<from, to>::in(port);
+  to::in(ref);
+  check_equal(ref, port);
+  ct::transition<to, analog>::in(port);
+  ct::port_conf<analog>::in(ref);
+  check_equal(ref, port);
+  ct::transition<analog, from>::in(port);
+  from::in(ref);
+  check_equal(ref, port);
+}
+
+TEST(stm32xx__gpio__f4, ct__transition__skips_unchanged_registers)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP, GPIO_AF_USART2> tx;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_OUT, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP> gpio;
+  typedef ct::transition<tx, gpio> t;
+  CHECK_EQUAL(0x00000030ul, t::moder::mask);
+  CHECK_EQUAL(0x00000010ul, t::moder::bits);
+  CHECK_EQUAL(0ul, t::otyper::mask);
+  CHECK_EQUAL(0ul, t::ospeedr::mask);
+  CHECK_EQUAL(0ul, t::pupdr::mask);
+  CHECK_EQUAL(0ul, t::afrl::mask);
+  CHECK_EQUAL(0ul, t::afrh::mask);
+  CHECK_EQUAL(0ul, t::bsrr::mask);
+  typedef ct::transition<gpio, tx> back;
+  CHECK_EQUAL(0x00000030ul, back::moder::mask);
+  CHECK_EQUAL(0x00000F00ul, back::afrl::mask);
+  CHECK_EQUAL(0ul, back::otyper::mask | back::ospeedr::mask | back::pupdr::mask);
+}
+
+TEST(stm32xx__gpio__f4, ct__transition__pulled_input_to_output)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_3, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz,
+                       GPIO_PuPd_UP> listen;
+  typedef ct::pin_conf<GPIO_Pin_4, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz,
+                       GPIO_PuPd_DOWN> sense;
+  typedef ct::pin_conf<GPIO_Pin_3|GPIO_Pin_4, GPIO_Mode_OUT, GPIO_OType_OD,
+                       GPIO_Speed_2MHz, GPIO_PuPd_UP> drive;
+  typedef ct::transition<ct::port_conf<listen, sense>, drive> t;
+  CHECK_EQUAL(0ul + GPIO_Pin_3, t::set);
+  CHECK_EQUAL(0ul + GPIO_Pin_4, t::reset);
+  CHECK_EQUAL(0x00100008ul, t::bsrr::bits);
+  CHECK_EQUAL(0ul, (ct::transition<drive, listen>::bsrr::mask));
+  GPIO_TypeDef port;
+  fill(port);
+  port.BSRRL = port.BSRRH = 0;
+  ct::port_conf<listen, sense>::in(port);
+  t::in(port);
+  CHECK_EQUAL(GPIO_Pin_3, port.BSRRL);
+  CHECK_EQUAL(GPIO_Pin_4, port.BSRRH);
+}
+
+TEST(stm32xx__gpio__f4, ct__config_set__same_as_port_conf)
+{
+  using namespace stm32xx::gpio;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_AF, GPIO_OType_PP, GPIO_Speed_50MHz,
+                       GPIO_PuPd_UP, GPIO_AF_USART2> usart;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_OUT, GPIO_OType_OD, GPIO_Speed_2MHz> gpio;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_IN> hiz;
+  typedef ct::pin_conf<GPIO_Pin_2, GPIO_Mode_IN, GPIO_OType_PP, GPIO_Speed_2MHz,
+                       GPIO_PuPd_DOWN> down;
+  typedef ct::config_set<usart, gpio, hiz, down> roles;
+  CHECK_EQUAL(4u, roles::size);
+  const unsigned order[] = { 2, 0, 3, 1, 2 };
+  GPIO_TypeDef port, ref;
+  fill(port);
+  fill(ref);
+  for(unsigned i : order)
+    {
+      roles::in(port, i);
+      switch(i)
+        {
+          case 0: ct::port_conf<usart>::in(ref); break;
+          case 1: ct::port_conf<gpio>::in(ref); break;
+          case 2: ct::port_conf<hiz>::in(ref); break;
+          default: ct::port_conf<down>::in(ref); break;
+        }
+      check_equal(ref, port);
+    }
+}
+
+TEST(stm32xx__gpio__f4, bsrr__is_bsrrl_and_bsrrh)
+{
+  GPIO_TypeDef port;
+  port.BSRRL = 0;
+  port.BSRRH = 0;
+  stm32xx::gpio::rt::write(&port, GPIO_Pin_1, GPIO_Pin_2);
+  CHECK_EQUAL(GPIO_Pin_1, port.BSRRL);
+  CHECK_EQUAL(GPIO_Pin_2, port.BSRRH);
+}
+#endif /* _HAVE_GPIO_MODER_REGISTER */
+
+/*
+ * write, set, reset, toggle
+ */
+TEST(stm32xx__gpio__ct, bsrr_masked)
+{
+  using namespace stm32xx::gpio::ct;
+  using m = bsrr_masked<GPIO_Pin_0|GPIO_Pin_15, GPIO_Pin_1>;
+  CHECK_EQUAL(0x00028001ul, m::bits);
+  CHECK_EQUAL(0xFFFFFFFFul, m::mask);
+}
+
+/* GPIOx_BSRR as a 32-bit register, on any STM32 family */
+static volatile uint32_t&
+port_bsrr(GPIO_TypeDef& port)
+{
+  return stm32xx::gpio::detail::bsrr(port);
+}
+
+TEST(stm32xx__gpio__ct, write__stores_bsrr)
+{
+  using namespace stm32xx::gpio::ct;
+  GPIO_TypeDef port;
+  port_bsrr(port) = 0;
+  write<GPIO_Pin_0|GPIO_Pin_15, GPIO_Pin_1>::in(port);
+  CHECK_EQUAL(0x00028001ul, port_bsrr(port));
+}
+
+TEST(stm32xx__gpio__ct, set__stores_bsrr)
+{
+  using namespace stm32xx::gpio::ct;
+  GPIO_TypeDef port;
+  port_bsrr(port) = 0;
+  set<GPIO_Pin_3|GPIO_Pin_8>::in(port);
+  CHECK_EQUAL(0x00000108ul, port_bsrr(port));
+}
+
+TEST(stm32xx__gpio__ct, reset__stores_bsrr)
+{
+  using namespace stm32xx::gpio::ct;
+  GPIO_TypeDef port;
+  port_bsrr(port) = 0;
+  reset<GPIO_Pin_3|GPIO_Pin_8>::in(port);
+  CHECK_EQUAL(0x01080000ul, port_bsrr(port));
+}
+
+TEST(stm32xx__gpio__ct, toggle__stores_bsrr)
+{
+  using namespace stm32xx::gpio::ct;
+  GPIO_TypeDef port;
+  port.ODR = GPIO_Pin_0|GPIO_Pin_2;
+  port_bsrr(port) = 0;
+  toggle<GPIO_Pin_0|GPIO_Pin_1>::in(port);
+  CHECK_EQUAL(0x00010002ul, port_bsrr(port));
+}
+
+TEST(stm32xx__gpio__rt, write__stores_bsrr)
+{
+  using namespace stm32xx::gpio;
+  GPIO_TypeDef port;
+  port_bsrr(port) = 0;
+  rt::write(&port, GPIO_Pin_0|GPIO_Pin_15, GPIO_Pin_1);
+  CHECK_EQUAL(0x00028001ul, port_bsrr(port));
+  rt::set(&port, GPIO_Pin_3|GPIO_Pin_8);
+  CHECK_EQUAL(0x00000108ul, port_bsrr(port));
+  rt::reset(&port, GPIO_Pin_3|GPIO_Pin_8);
+  CHECK_EQUAL(0x01080000ul, port_bsrr(port));
+}
+
+TEST(stm32xx__gpio__rt, toggle__stores_bsrr)
+{
+  using namespace stm32xx::gpio;
+  GPIO_TypeDef port;
+  port.ODR = GPIO_Pin_0|GPIO_Pin_2;
+  port_bsrr(port) = 0;
+  rt::toggle(&port, GPIO_Pin_0|GPIO_Pin_1);
+  CHECK_EQUAL(0x00010002ul, port_bsrr(port));
+}
+
+/*
+ * Bus access counts, measured on simulated registers
+ */
+#if defined STM32_FAMILY_STM32F10X
+#include <sim/mcu.hpp>
+#include <vector>
+
+namespace {
+/* sim::access, logging the addresses written */
+struct logged_access
+{
+  static std::vector<uint32_t> writes;
+  static uint32_t read(uint32_t addr) { return sim::access::read(addr); }
+  static void write(uint32_t addr, uint32_t value)
+  {
+    writes.push_back(addr);
+    sim::access::write(addr, value);
+  }
+};
+std::vector<uint32_t> logged_access::writes;
+}
+
+TEST_GROUP(stm32xx__gpio__accesses)
+{
+  void setup()
+  {
+    sim::instance().reset();
+    sim::access::clear();
+  }
+};
+
+TEST(stm32xx__gpio__accesses, port_conf__costs_2_reads_and_2_writes)
+{
+  using namespace stm32xx::gpio::ct;
+  using leds    = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using buttons = pin_conf<GPIO_Pin_7|GPIO_Pin_8, GPIO_Mode_IPU>;
+  using usart   = pin_conf<GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  sim::mcu& m = sim::instance();
+  port_conf<leds, buttons, usart>::in(m.gpiob);
+  CHECK_EQUAL(0x84444422ul, m.gpiob.CRL.value);
+  CHECK_EQUAL(0x44444B48ul, m.gpiob.CRH.value);
+  CHECK_EQUAL(2u, m.gpiob.reads());
+  CHECK_EQUAL(2u, m.gpiob.writes());
+  CHECK_EQUAL(2u, m.reads());
+  CHECK_EQUAL(2u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, port_conf__on_crl_only_costs_1_read_and_1_write)
+{
+  using namespace stm32xx::gpio::ct;
+  using leds = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  sim::mcu& m = sim::instance();
+  port_conf<leds>::in(m.gpioc);
+  CHECK_EQUAL(1u, m.gpioc.CRL.reads);
+  CHECK_EQUAL(1u, m.gpioc.CRL.writes);
+  CHECK_EQUAL(0u, m.gpioc.CRH.reads + m.gpioc.CRH.writes);
+}
+
+TEST(stm32xx__gpio__accesses, rt_configure__costs_2_reads_and_2_writes)
+{
+  using namespace stm32xx::gpio;
+  sim::mcu& m = sim::instance();
+  rt::configure(&m.gpioa, GPIO_Pin_5|GPIO_Pin_9, GPIO_Mode_Out_OD, GPIO_Speed_10MHz);
+  CHECK_EQUAL(0x44544444ul, m.gpioa.CRL.value);
+  CHECK_EQUAL(0x44444454ul, m.gpioa.CRH.value);
+  CHECK_EQUAL(2u, m.reads());
+  CHECK_EQUAL(2u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, rt_configure__on_crh_only_costs_1_read_and_1_write)
+{
+  using namespace stm32xx::gpio;
+  sim::mcu& m = sim::instance();
+  rt::configure(&m.gpiob, GPIO_Pin_12, GPIO_Mode_Out_PP, GPIO_Speed_2MHz);
+  CHECK_EQUAL(0x44424444ul, m.gpiob.CRH.value);
+  CHECK_EQUAL(0u, m.gpiob.CRL.reads + m.gpiob.CRL.writes);
+  CHECK_EQUAL(1u, m.reads());
+  CHECK_EQUAL(1u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, rt_configure__selects_pull_in_odr)
+{
+  using namespace stm32xx::gpio;
+  sim::mcu& m = sim::instance();
+  m.gpioc.ODR.value = GPIO_Pin_1;
+  rt::configure(&m.gpioc, GPIO_Pin_0|GPIO_Pin_9, GPIO_Mode_IPU);
+  CHECK_EQUAL(0ul + (GPIO_Pin_0|GPIO_Pin_1|GPIO_Pin_9), m.gpioc.ODR.value);
+  rt::configure(&m.gpioc, GPIO_Pin_1|GPIO_Pin_9, GPIO_Mode_IPD);
+  CHECK_EQUAL(0ul + GPIO_Pin_0, m.gpioc.ODR.value);
+  CHECK_EQUAL(0x44444488ul, m.gpioc.CRL.value);
+  CHECK_EQUAL(0x44444484ul, m.gpioc.CRH.value);
+  CHECK_EQUAL(2u, m.gpioc.BSRR.writes);
+}
+
+TEST(stm32xx__gpio__accesses, write__costs_1_write)
+{
+  using namespace stm32xx::gpio;
+  sim::mcu& m = sim::instance();
+  ct::write<GPIO_Pin_0|GPIO_Pin_1, GPIO_Pin_2>::in(m.gpiob);
+  rt::write(&m.gpiob, GPIO_Pin_2, GPIO_Pin_1);
+  CHECK_EQUAL(0ul + (GPIO_Pin_0|GPIO_Pin_2), m.gpiob.ODR.value);
+  CHECK_EQUAL(0u, m.reads());
+  CHECK_EQUAL(2u, m.writes());
+  CHECK_EQUAL(2u, m.gpiob.BSRR.writes);
+}
+
+TEST(stm32xx__gpio__accesses, toggle__costs_1_read_and_1_write)
+{
+  using namespace stm32xx::gpio;
+  sim::mcu& m = sim::instance();
+  m.gpiob.ODR.value = GPIO_Pin_0;
+  ct::toggle<GPIO_Pin_0|GPIO_Pin_1>::in(m.gpiob);
+  CHECK_EQUAL(0ul + GPIO_Pin_1, m.gpiob.ODR.value);
+  CHECK_EQUAL(1u, m.gpiob.ODR.reads);
+  CHECK_EQUAL(1u, m.gpiob.BSRR.writes);
+  CHECK_EQUAL(1u, m.reads());
+  CHECK_EQUAL(1u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, rcc_enable__through_bitband_costs_no_read)
+{
+  using namespace stm32xx::bits::ct;
+  sim::mcu& m = sim::instance();
+  using iopb = masked<RCC_APB2Periph_GPIOB, RCC_APB2Periph_GPIOB>;
+  modify<iopb>::at<RCC_BASE + 0x18, sim::access>();
+  CHECK_EQUAL(RCC_APB2Periph_GPIOB, m.rcc.APB2ENR.value);
+  CHECK_EQUAL(0u, m.reads() + m.writes());
+  CHECK_EQUAL(1u, sim::access::alias_writes());
+}
+
+TEST(stm32xx__gpio__accesses, rcc_enable__many_bits_costs_1_read_and_1_write)
+{
+  using namespace stm32xx::bits::ct;
+  sim::mcu& m = sim::instance();
+  using iop = masked<RCC_APB2Periph_GPIOA|RCC_APB2Periph_GPIOB,
+                     RCC_APB2Periph_GPIOA|RCC_APB2Periph_GPIOB>;
+  modify<iop>::at<RCC_BASE + 0x18, sim::access>();
+  CHECK_EQUAL(RCC_APB2Periph_GPIOA|RCC_APB2Periph_GPIOB, m.rcc.APB2ENR.value);
+  CHECK_EQUAL(1u, m.rcc.APB2ENR.reads);
+  CHECK_EQUAL(1u, m.rcc.APB2ENR.writes);
+}
+
+TEST(stm32xx__gpio__accesses, transition__writes_only_changed_bits)
+{
+  using namespace stm32xx::gpio::ct;
+  using leds  = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using usart = pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  using gpio  = pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_Out_PP, GPIO_Speed_50MHz>;
+  using t = transition< port_conf<leds, usart>, port_conf<leds, gpio> >;
+  CHECK_EQUAL(0ul, t::crl::mask);
+  CHECK_EQUAL(0x00000880ul, t::crh::mask);
+  CHECK_EQUAL(0ul, t::bsrr::mask);
+  sim::mcu& m = sim::instance();
+  port_conf<leds, usart>::in(m.gpiob);
+  m.clear();
+  t::in(m.gpiob);
+  CHECK_EQUAL(0x44444422ul, m.gpiob.CRL.value);
+  CHECK_EQUAL(0x44444334ul, m.gpiob.CRH.value);
+  CHECK_EQUAL(0u, m.gpiob.CRL.reads + m.gpiob.CRL.writes);
+  CHECK_EQUAL(1u, m.gpiob.CRH.reads);
+  CHECK_EQUAL(1u, m.gpiob.CRH.writes);
+  CHECK_EQUAL(1u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, transition__same_conf_costs_nothing)
+{
+  using namespace stm32xx::gpio::ct;
+  using usart = pin_conf<GPIO_Pin_9|GPIO_Pin_10, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  transition<usart, usart>::in(sim::instance().gpioa);
+  transition<usart, usart>::at<GPIOA_BASE, sim::access>();
+  CHECK_EQUAL(0u, sim::instance().reads() + sim::instance().writes());
+}
+
+TEST(stm32xx__gpio__accesses, transition__unknown_pins_are_written)
+{
+  using namespace stm32xx::gpio::ct;
+  using one = pin_conf<GPIO_Pin_0, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using two = pin_conf<GPIO_Pin_0|GPIO_Pin_1, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using t = transition<one, two>;
+  CHECK_EQUAL(0x000000F0ul, t::crl::mask);
+  CHECK_EQUAL(0x00000020ul, t::crl::bits);
+  CHECK_EQUAL(0ul, t::crh::mask);
+}
+
+TEST(stm32xx__gpio__accesses, transition__pull_up_set_before_mode_change)
+{
+  using namespace stm32xx::gpio::ct;
+  using tx   = pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  using idle = pin_conf<GPIO_Pin_9, GPIO_Mode_IPU>;
+  using down = pin_conf<GPIO_Pin_9, GPIO_Mode_IPD>;
+  sim::mcu& m = sim::instance();
+  port_conf<tx>::in(m.gpioa);
+  m.clear();
+  logged_access::writes.clear();
+  transition<tx, idle>::at<GPIOA_BASE, logged_access>();
+  CHECK_EQUAL(0x44444484ul, m.gpioa.CRH.value);
+  CHECK_EQUAL(0ul + GPIO_Pin_9, m.gpioa.ODR.value);
+  CHECK_EQUAL(2u, logged_access::writes.size());
+  CHECK_EQUAL(GPIOA_BASE + offsetof(GPIO_TypeDef, BSRR), logged_access::writes[0]);
+  CHECK_EQUAL(GPIOA_BASE + offsetof(GPIO_TypeDef, CRH), logged_access::writes[1]);
+  /* already pulled up: only the mode changes back */
+  m.clear();
+  transition<idle, tx>::in(m.gpioa);
+  CHECK_EQUAL(0x444444B4ul, m.gpioa.CRH.value);
+  CHECK_EQUAL(0u, m.gpioa.BSRR.writes);
+  /* pull-up to pull-down: ODR only */
+  m.clear();
+  transition<idle, down>::in(m.gpioa);
+  CHECK_EQUAL(0ul, m.gpioa.ODR.value);
+  CHECK_EQUAL(1u, m.gpioa.BSRR.writes);
+  CHECK_EQUAL(1u, m.writes());
+}
+
+TEST(stm32xx__gpio__accesses, transition__pull_rewritten_for_unchanged_input)
+{
+  using namespace stm32xx::gpio::ct;
+  using btn  = pin_conf<GPIO_Pin_3, GPIO_Mode_IPU>;
+  using led  = pin_conf<GPIO_Pin_4, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using t = transition< btn, port_conf<btn, led> >;
+  CHECK_EQUAL(0ul + GPIO_Pin_3, t::set);
+  CHECK_EQUAL(0xFFFFFFFFul, t::bsrr::mask);
+  sim::mcu& m = sim::instance();
+  port_conf<btn>::in(m.gpioc);
+  /* port_conf does not select the pull, nor does anything else here */
+  CHECK_EQUAL(0ul, m.gpioc.ODR.value);
+  t::in(m.gpioc);
+  CHECK_EQUAL(0ul + GPIO_Pin_3, m.gpioc.ODR.value);
+  CHECK_EQUAL(0x44428444ul, m.gpioc.CRL.value);
+}
+
+TEST(stm32xx__gpio__accesses, config_set__same_as_port_conf)
+{
+  using namespace stm32xx::gpio::ct;
+  using usart = pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  using gpio  = pin_conf<GPIO_Pin_9, GPIO_Mode_Out_PP, GPIO_Speed_2MHz>;
+  using hiz   = pin_conf<GPIO_Pin_9, GPIO_Mode_IN_FLOATING>;
+  using led   = pin_conf<GPIO_Pin_0, GPIO_Mode_Out_OD, GPIO_Speed_10MHz>;
+  using btn   = pin_conf<GPIO_Pin_0, GPIO_Mode_IPU>;
+  using roles = config_set< port_conf<led, usart>, port_conf<led, gpio>,
+                            port_conf<btn, hiz>, port_conf<btn, gpio> >;
+  CHECK_EQUAL(4u, roles::size);
+  CHECK_EQUAL(0x000000B0ul, roles::table[0].crh_bits);
+  CHECK_EQUAL(0x000000F0ul, roles::table[0].crh_mask);
+  CHECK_EQUAL(0x0000000Ful, roles::table[2].crl_mask);
+  CHECK_EQUAL(0ul, roles::table[0].bsrr);
+  CHECK_EQUAL(0ul + GPIO_Pin_0, roles::table[3].bsrr);
+  sim::mcu& m = sim::instance();
+  const unsigned order[] = { 2, 0, 3, 1, 2 };
+  for(unsigned i : order)
+    {
+      m.clear();
+      roles::in(m.gpioa, i);
+      CHECK_EQUAL(1u, m.gpioa.BSRR.writes);
+      CHECK_EQUAL(1u, m.gpioa.CRL.reads);
+      CHECK_EQUAL(1u, m.gpioa.CRH.reads);
+      CHECK_EQUAL(3u, m.writes());
+      const uint32_t crl = m.gpioa.CRL.value, crh = m.gpioa.CRH.value;
+      switch(i)
+        {
+          case 0: port_conf<led, usart>::in(m.gpiob); break;
+          case 1: port_conf<led, gpio>::in(m.gpiob); break;
+          case 2: port_conf<btn, hiz>::in(m.gpiob); break;
+          default: port_conf<btn, gpio>::in(m.gpiob); break;
+        }
+      CHECK_EQUAL(m.gpiob.CRL.value, crl);
+      CHECK_EQUAL(m.gpiob.CRH.value, crh);
+      if(i >= 2) /* btn is pulled up */
+        {
+          CHECK_EQUAL(0ul + GPIO_Pin_0, m.gpioa.ODR.value & GPIO_Pin_0);
+        }
+    }
+}
+
+TEST(stm32xx__gpio__accesses, config_set__selects_pull_in_odr)
+{
+  using namespace stm32xx::gpio::ct;
+  using up    = pin_conf<GPIO_Pin_9, GPIO_Mode_IPU>;
+  using down  = pin_conf<GPIO_Pin_9, GPIO_Mode_IPD>;
+  using hiz   = pin_conf<GPIO_Pin_9, GPIO_Mode_IN_FLOATING>;
+  using roles = config_set<up, down, hiz>;
+  CHECK_EQUAL(0ul + GPIO_Pin_9, roles::table[0].bsrr);
+  CHECK_EQUAL((uint32_t)GPIO_Pin_9 << 16, roles::table[1].bsrr);
+  CHECK_EQUAL(0ul, roles::table[2].bsrr);
+  sim::mcu& m = sim::instance();
+  roles::in(m.gpioa, 0);
+  CHECK_EQUAL(0ul + GPIO_Pin_9, m.gpioa.ODR.value);
+  CHECK_EQUAL(0x44444484ul, m.gpioa.CRH.value);
+  roles::in(m.gpioa, 2);
+  CHECK_EQUAL(0ul + GPIO_Pin_9, m.gpioa.ODR.value);
+  roles::in(m.gpioa, 1);
+  CHECK_EQUAL(0ul, m.gpioa.ODR.value);
+  CHECK_EQUAL(0x44444484ul, m.gpioa.CRH.value);
+  CHECK_EQUAL(3u, m.gpioa.BSRR.writes);
+  CHECK_EQUAL(0u, m.gpioa.CRL.reads + m.gpioa.CRL.writes);
+}
+
+TEST(stm32xx__gpio__accesses, config_set__skips_untouched_registers)
+{
+  using namespace stm32xx::gpio::ct;
+  using usart = pin_conf<GPIO_Pin_9, GPIO_Mode_AF_PP, GPIO_Speed_50MHz>;
+  using hiz   = pin_conf<GPIO_Pin_9, GPIO_Mode_IN_FLOATING>;
+  sim::mcu& m = sim::instance();
+  config_set<usart, hiz>::in(m.gpioa, 0);
+  CHECK_EQUAL(0x444444B4ul, m.gpioa.CRH.value);
+  config_set<usart, hiz>::in(m.gpioa, 1);
+  CHECK_EQUAL(0x44444444ul, m.gpioa.CRH.value);
+  CHECK_EQUAL(0u, m.gpioa.CRL.reads + m.gpioa.CRL.writes);
+  CHECK_EQUAL(2u, m.gpioa.CRH.reads);
+  CHECK_EQUAL(2u, m.gpioa.CRH.writes);
+}
+
+TEST(stm32xx__gpio__accesses, reset_values)
+{
+  sim::mcu& m = sim::instance();
+  CHECK_EQUAL(0x44444444ul, m.gpioe.CRL.value);
+  CHECK_EQUAL(0x44444444ul, m.gpioe.CRH.value);
+  CHECK_EQUAL(0x00000000ul, m.gpioe.ODR.value);
+  CHECK_EQUAL(0x00000014ul, m.rcc.AHBENR.value);
+  CHECK_EQUAL(0x0C000000ul, m.rcc.CSR.value);
+}
+#endif /* STM32_FAMILY_STM32F10X */
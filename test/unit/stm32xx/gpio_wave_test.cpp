@@ -0,0 +1,259 @@
+#include <stm32xx/gpio_wave.hpp>
+#include <CppUTest/TestHarness.h>
+
+namespace {
+using stm32xx::gpio::ct::bus;
+
+typedef bus<GPIOB_BASE, 12, 13, 14, 15> steppers;
+typedef bus<GPIOC_BASE, 7, 6, 5, 4, 3, 2, 1, 0> reversed8;
+typedef bus<GPIOA_BASE, 3, 0, 9, 4, 15, 1, 12, 8, 2, 14, 6, 11, 5, 13, 7, 10> shuffled16;
+
+/* Pseudo-random bytes */
+uint8_t
+random_byte(uint32_t& x)
+{
+  x = x * 1103515245ul + 12345ul;
+  return (uint8_t)(x >> 16);
+}
+
+/* Simulated DMA consumer: moves words from the circular buffer of a
+ * wave::stream to GPIOx_BSRR, one per timer update, and calls the
+ * stream's interrupt handlers as the DMA controller would. */
+template <typename _Stream>
+struct dma_consumer
+{
+  _Stream& stream;
+  std::size_t pos;
+  uint32_t odr;
+
+  explicit dma_consumer(_Stream& s) : stream(s), pos(0u), odr(0ul) {}
+
+  /* one timer update event */
+  void update()
+  {
+    const uint32_t bsrr = stream.buffer()[pos];
+    odr = (odr & ~(bsrr >> 16)) | (bsrr & 0xFFFFul);
+    if(++pos == _Stream::half_size)
+      stream.half_transfer();
+    else if(pos == _Stream::size)
+      {
+        pos = 0u;
+        stream.transfer_complete();
+      }
+  }
+};
+}
+
+TEST_GROUP(stm32xx__gpio__wave)
+{
+  /* Per-bit reference: BSRR word for sample k of the channels */
+  template <typename _Bus>
+  static uint32_t
+  reference_word(const uint8_t* bytes, unsigned k)
+  {
+    uint32_t set = 0ul, reset = 0ul;
+    for(unsigned c = 0; c < _Bus::width; ++c)
+      {
+        const uint32_t pin = 1ul << _Bus::map::pins[c];
+        if((bytes[c] >> k) & 1u)
+          set |= pin;
+        else
+          reset |= pin;
+      }
+    return set | (reset << 16);
+  }
+
+  template <typename _Bus>
+  static void
+  check_encode8(uint32_t seed)
+  {
+    using stm32xx::gpio::wave::encoder;
+    for(unsigned n = 0; n < 1000; ++n)
+      {
+        uint8_t bytes[_Bus::width];
+        uint32_t words[8];
+        for(uint8_t& b : bytes)
+          b = random_byte(seed);
+        encoder<_Bus>::encode8(bytes, words);
+        for(unsigned k = 0; k < 8; ++k)
+          CHECK_EQUAL(reference_word<_Bus>(bytes, k), words[k]);
+      }
+  }
+};
+
+TEST(stm32xx__gpio__wave, nibble_table)
+{
+  using stm32xx::gpio::wave::detail::tables;
+  CHECK_EQUAL(0x00000000ul, tables<>::spread[0x0]);
+  CHECK_EQUAL(0x00000001ul, tables<>::spread[0x1]);
+  CHECK_EQUAL(0x00010100ul, tables<>::spread[0x6]);
+  CHECK_EQUAL(0x01000000ul, tables<>::spread[0x8]);
+  CHECK_EQUAL(0x01010101ul, tables<>::spread[0xF]);
+}
+
+TEST(stm32xx__gpio__wave, encode8__every_byte_of_one_channel)
+{
+  using stm32xx::gpio::wave::encoder;
+  for(unsigned c = 0; c < reversed8::width; ++c)
+    for(unsigned b = 0; b < 256; ++b)
+      {
+        uint8_t bytes[reversed8::width] = { 0 };
+        uint32_t words[8];
+        bytes[c] = (uint8_t)b;
+        encoder<reversed8>::encode8(bytes, words);
+        for(unsigned k = 0; k < 8; ++k)
+          CHECK_EQUAL(reference_word<reversed8>(bytes, k), words[k]);
+      }
+}
+
+TEST(stm32xx__gpio__wave, encode8__matches_reference)
+{
+  check_encode8<steppers>(1u);
+  check_encode8<reversed8>(2u);
+  check_encode8<shuffled16>(3u);
+}
+
+TEST(stm32xx__gpio__wave, stream__plays_all_samples)
+{
+  using namespace stm32xx::gpio::wave;
+  /* 13 bytes per channel: not a multiple of the half-buffer (4 bytes) */
+  enum { bytes = 13 };
+  uint8_t data[steppers::width][bytes];
+  const uint8_t* streams[steppers::width];
+  uint32_t seed = 7u;
+  for(unsigned c = 0; c < steppers::width; ++c)
+    {
+      for(uint8_t& b : data[c])
+        b = random_byte(seed);
+      streams[c] = data[c];
+    }
+  array_source<steppers::width> source(streams, bytes);
+  typedef stream<steppers, 32> stream_t;
+  stream_t s(source);
+  s.start();
+  dma_consumer<stream_t> dma(s);
+  for(unsigned n = 0; n < 8u * bytes; ++n)
+    {
+      CHECK(!s.finished());
+      dma.update();
+      for(unsigned c = 0; c < steppers::width; ++c)
+        {
+          const unsigned expected = (data[c][n >> 3] >> (n & 7u)) & 1u;
+          CHECK_EQUAL(expected, (dma.odr >> steppers::map::pins[c]) & 1u);
+        }
+      CHECK_EQUAL(0ul, dma.odr & ~(uint32_t)steppers::pins);
+    }
+  /* the pins keep their last levels until the end of the buffer */
+  const uint32_t last = dma.odr;
+  while(!s.finished())
+    {
+      dma.update();
+      CHECK_EQUAL(last, dma.odr);
+    }
+  /* the last sample (104) was in the last quarter of the 2nd cycle */
+  CHECK_EQUAL(0u, dma.pos);
+}
+
+TEST(stm32xx__gpio__wave, stream__finished_polled)
+{
+  using namespace stm32xx::gpio::wave;
+  enum { bytes = 64 };
+  uint8_t data[steppers::width][bytes] = { };
+  const uint8_t* streams[steppers::width];
+  for(unsigned c = 0; c < steppers::width; ++c)
+    streams[c] = data[c];
+  array_source<steppers::width> source(streams, bytes);
+  typedef stream<steppers, 32> stream_t;
+  stream_t s(source);
+  s.start();
+  dma_consumer<stream_t> dma(s);
+  /* wait for the end, with the DMA and its interrupt handlers running
+   * between two polls */
+  unsigned n = 0u;
+  while(!s.finished() && n < 4u * 8u * bytes)
+    {
+      dma.update();
+      ++n;
+    }
+  CHECK(s.finished());
+  /* 16 halves of samples, then the two refills which found none */
+  CHECK_EQUAL(8u * bytes, n);
+}
+
+TEST(stm32xx__gpio__wave, stream__empty_source)
+{
+  using namespace stm32xx::gpio::wave;
+  array_source<reversed8::width> source(nullptr, 0u);
+  stream<reversed8, 8> s(source);
+  s.start();
+  CHECK(s.finished());
+  for(std::size_t i = 0; i < s.size; ++i)
+    CHECK_EQUAL(0ul, s.buffer()[i]);
+}
+
+TEST(stm32xx__gpio__wave, stream__bsrr_address)
+{
+  using namespace stm32xx::gpio;
+  CHECK_EQUAL(GPIOB_BASE + detail::bsrr_offset, (wave::stream<steppers, 8>::bsrr_address));
+}
+
+#if defined STM32_FAMILY_STM32F10X
+TEST(stm32xx__gpio__wave, dma_start)
+{
+  using namespace stm32xx::gpio;
+  static const uint32_t buffer[16] = { 0 };
+  DMA_Channel_TypeDef channel;
+  channel.CCR = DMA_CCR1_PINC | DMA_CCR1_EN;
+  channel.CNDTR = channel.CPAR = channel.CMAR = 0ul;
+  wave::dma_start(channel, GPIOB_BASE + 0x10, buffer, 16);
+  /* DMA_CCR1_* are 16-bit (int after promotion) in the F1 headers */
+  CHECK_EQUAL((uint32_t)(DMA_CCR1_DIR | DMA_CCR1_CIRC | DMA_CCR1_MINC |
+                         DMA_CCR1_PSIZE_1 | DMA_CCR1_MSIZE_1 | DMA_CCR1_PL |
+                         DMA_CCR1_HTIE | DMA_CCR1_TCIE | DMA_CCR1_EN),
+              channel.CCR);
+  CHECK_EQUAL(16ul, channel.CNDTR);
+  CHECK_EQUAL(GPIOB_BASE + 0x10, channel.CPAR);
+  CHECK_EQUAL((uint32_t)reinterpret_cast<uintptr_t>(buffer), channel.CMAR);
+  wave::dma_stop(channel);
+  CHECK_EQUAL(0ul, channel.CCR & (uint32_t)DMA_CCR1_EN);
+}
+#endif /* STM32_FAMILY_STM32F10X */
+
+#if defined STM32_FAMILY_STM32F4XX
+TEST(stm32xx__gpio__wave, dma_start)
+{
+  using namespace stm32xx::gpio;
+  static const uint32_t buffer[16] = { 0 };
+  DMA_Stream_TypeDef stream;
+  stream.CR = DMA_SxCR_PINC | DMA_SxCR_DBM;
+  stream.NDTR = stream.PAR = stream.M0AR = stream.M1AR = stream.FCR = 0ul;
+  wave::dma_start<DMA_Channel_6>(stream, GPIOB_BASE + 0x18, buffer, 16);
+  CHECK_EQUAL(DMA_Channel_6 | DMA_SxCR_DIR_0 | DMA_SxCR_CIRC | DMA_SxCR_MINC |
+              DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1 | DMA_SxCR_PL |
+              DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_EN, stream.CR);
+  CHECK_EQUAL(16ul, stream.NDTR);
+  CHECK_EQUAL(GPIOB_BASE + 0x18, stream.PAR);
+  CHECK_EQUAL((uint32_t)reinterpret_cast<uintptr_t>(buffer), stream.M0AR);
+  wave::dma_stop(stream);
+  CHECK_EQUAL(0ul, stream.CR & DMA_SxCR_EN);
+}
+#endif /* STM32_FAMILY_STM32F4XX */
+
+TEST(stm32xx__gpio__wave, timer_start)
+{
+  using namespace stm32xx::gpio;
+  TIM_TypeDef timer = TIM_TypeDef();
+  timer.CR1 = TIM_CR1_URS;
+  wave::timer_start(timer, 1, 35);
+  CHECK_EQUAL(1u, timer.PSC);
+  CHECK_EQUAL(35u, timer.ARR);
+  CHECK_EQUAL(TIM_EGR_UG, timer.EGR);
+  CHECK_EQUAL(TIM_DIER_UDE, timer.DIER);
+  CHECK_EQUAL(TIM_CR1_URS | TIM_CR1_ARPE | TIM_CR1_CEN, timer.CR1);
+  wave::timer_stop(timer);
+  CHECK_EQUAL(TIM_CR1_URS | TIM_CR1_ARPE, timer.CR1);
+  CHECK_EQUAL(0u, timer.DIER);
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,156 @@
+#define STM32XX_PROF
+#include <stm32xx/prof.hpp>
+#include <CppUTest/TestHarness.h>
+#include <string>
+
+namespace {
+/* Clock advanced by the tests */
+struct fake_clock
+{
+  static uint32_t t;
+  static uint32_t now() { return t; }
+};
+uint32_t fake_clock::t = 0ul;
+
+using stm32xx::prof::probe;
+using stm32xx::prof::stats;
+typedef stm32xx::prof::scoped_timer<fake_clock> fake_timer;
+
+STM32XX_PROF_PROBE(prof_test_first);
+STM32XX_PROF_PROBE(prof_test_second);
+
+void
+profiled()
+{
+  STM32XX_PROF_SCOPE(prof_test_second);
+}
+
+std::string
+line_of(const probe& p)
+{
+  char buf[128];
+  return std::string(buf, stm32xx::prof::format(p, buf, sizeof(buf)));
+}
+}
+
+TEST_GROUP(stm32xx__prof)
+{
+  void setup()
+  {
+    stm32xx::prof::clear();
+    fake_clock::t = 1000ul;
+  }
+};
+
+TEST(stm32xx__prof, stats__bin)
+{
+  CHECK_EQUAL(0u, stats::bin(0ul));
+  CHECK_EQUAL(1u, stats::bin(1ul));
+  CHECK_EQUAL(2u, stats::bin(2ul));
+  CHECK_EQUAL(2u, stats::bin(3ul));
+  CHECK_EQUAL(3u, stats::bin(4ul));
+  CHECK_EQUAL(14u, stats::bin(0x2000ul));
+  CHECK_EQUAL(15u, stats::bin(0x4000ul));
+  CHECK_EQUAL(15u, stats::bin(0xFFFFFFFFul));
+}
+
+TEST(stm32xx__prof, stats__add)
+{
+  stats s;
+  s.clear();
+  CHECK_EQUAL(0ul, s.mean());
+  s.add(10ul);
+  s.add(30ul);
+  s.add(3ul);
+  CHECK_EQUAL(3ul, s.count);
+  CHECK_EQUAL(3ul, s.min);
+  CHECK_EQUAL(30ul, s.max);
+  CHECK_EQUAL(14ul, s.mean());
+  CHECK_EQUAL(1ul, s.hist[2]);
+  CHECK_EQUAL(1ul, s.hist[4]);
+  CHECK_EQUAL(1ul, s.hist[5]);
+}
+
+TEST(stm32xx__prof, scoped_timer)
+{
+  probe& p = stm32xx_prof_probe_prof_test_first;
+  {
+    fake_timer timer(p);
+    fake_clock::t += 37ul;
+  }
+  {
+    fake_timer timer(p);
+    fake_clock::t += 5ul;
+  }
+  CHECK_EQUAL(2ul, p.data().count);
+  CHECK_EQUAL(5ul, p.data().min);
+  CHECK_EQUAL(37ul, p.data().max);
+  CHECK_EQUAL(21ul, p.data().mean());
+}
+
+TEST(stm32xx__prof, scoped_timer__clock_wraps_around)
+{
+  probe& p = stm32xx_prof_probe_prof_test_first;
+  fake_clock::t = 0xFFFFFFF0ul;
+  {
+    fake_timer timer(p);
+    fake_clock::t += 0x20ul;
+  }
+  CHECK_EQUAL(0x20ul, p.data().max);
+}
+
+TEST(stm32xx__prof, scope_macro)
+{
+  profiled();
+  profiled();
+  CHECK_EQUAL(2ul, stm32xx_prof_probe_prof_test_second.data().count);
+}
+
+TEST(stm32xx__prof, format)
+{
+  probe& p = stm32xx_prof_probe_prof_test_first;
+  CHECK_EQUAL(std::string("prof_test_first 0 0 0 0 0\n"), line_of(p));
+  p.add(41ul);
+  p.add(97ul);
+  p.add(44ul);
+  CHECK_EQUAL(std::string("prof_test_first 3 41 60 97 0,0,0,0,0,0,2,1\n"), line_of(p));
+  p.add(0xFFFFFFFFul);
+  CHECK_EQUAL(std::string("prof_test_first 4 41 1073741869 4294967295 "
+                          "0,0,0,0,0,0,2,1,0,0,0,0,0,0,0,1\n"), line_of(p));
+}
+
+TEST(stm32xx__prof, format__truncates)
+{
+  char buf[8] = { 'x', 'x', 'x', 'x', 'x', 'x', 'x', 'x' };
+  CHECK_EQUAL(6u, stm32xx::prof::format(stm32xx_prof_probe_prof_test_first, buf, 6u));
+  CHECK_EQUAL(std::string("prof_txx"), std::string(buf, 8u));
+}
+
+TEST(stm32xx__prof, dump)
+{
+  stm32xx_prof_probe_prof_test_first.add(7ul);
+  std::string out;
+  unsigned lines = 0u;
+  stm32xx::prof::dump([&](const char* line, std::size_t n) {
+    out.append(line, n);
+    ++lines;
+  });
+  /* the probes of this file, last defined first */
+  const std::size_t second = out.find("prof_test_second 0 0 0 0 0\n");
+  const std::size_t first = out.find("prof_test_first 1 7 7 7 0,0,0,1\n");
+  CHECK(second != std::string::npos);
+  CHECK(first != std::string::npos);
+  CHECK(second < first);
+  CHECK(lines >= 2u);
+}
+
+TEST(stm32xx__prof, clear)
+{
+  stm32xx_prof_probe_prof_test_first.add(7ul);
+  stm32xx::prof::clear();
+  CHECK_EQUAL(0ul, stm32xx_prof_probe_prof_test_first.data().count);
+  CHECK_EQUAL(0xFFFFFFFFul, stm32xx_prof_probe_prof_test_first.data().min);
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
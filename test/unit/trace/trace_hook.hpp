@@ -0,0 +1,36 @@
+/* Access hook of the trace test runner. SConscript force-includes this
+ * header (-include) into every translation unit of run_trace_tests and
+ * defines STM32XX_ACCESS_HOOK=trace_test::hook on the command line, so all
+ * of them see the same hook. */
+#ifndef TRACE_TEST_TRACE_HOOK_HPP_INCLUDED
+#define TRACE_TEST_TRACE_HOOK_HPP_INCLUDED
+
+#include <stm32xx/trace.hpp>
+
+namespace trace_test {
+/* Clock counting calls to now(); irq, when set, is called once from the
+ * next now(), as an interrupt firing inside ring::record() */
+struct test_clock
+{
+  static uint32_t ticks;
+  static void (*irq)();
+  static uint32_t now()
+  {
+    if(irq)
+      {
+        void (*f)() = irq;
+        irq = 0; /* interrupt fires once */
+        f();
+      }
+    return ++ticks;
+  }
+};
+
+typedef stm32xx::trace::ring<8, test_clock> test_ring_t;
+extern test_ring_t test_ring;
+typedef stm32xx::trace::hook<test_ring_t, test_ring> hook;
+} /* namespace trace_test */
+
+#endif /* TRACE_TEST_TRACE_HOOK_HPP_INCLUDED */
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4:
@@ -0,0 +1,186 @@
+/* Built into its own runner, run_trace_tests, with the access hook
+ * trace_test::hook (see trace_hook.hpp and SConscript). */
+#if !defined(STM32XX_ACCESS_HOOK)
+# error "STM32XX_ACCESS_HOOK must be defined on the command line"
+#endif
+#include <stm32xx/gpio.hpp>
+#include <CppUTest/TestHarness.h>
+
+using trace_test::test_clock;
+using trace_test::test_ring;
+
+uint32_t trace_test::test_clock::ticks = 0ul;
+void (*trace_test::test_clock::irq)() = 0;
+trace_test::test_ring_t trace_test::test_ring;
+
+namespace {
+struct traced_reg
+{
+  uint32_t v;
+  operator uint32_t() const { return v; }
+  traced_reg& operator=(uint32_t x) { v = x; return *this; }
+};
+
+struct traced_port
+{
+  traced_reg CRL, CRH, IDR, ODR, BSRR, BRR, LCKR;
+};
+
+/* Words at any address, indexed by the 8 least significant address bits */
+struct traced_access
+{
+  static uint32_t mem[64];
+  static uint32_t read(uint32_t addr) { return mem[(addr & 0xFFul) >> 2]; }
+  static void write(uint32_t addr, uint32_t v) { mem[(addr & 0xFFul) >> 2] = v; }
+};
+uint32_t traced_access::mem[64];
+
+stm32xx::trace::event
+get_event(uint32_t n)
+{
+  stm32xx::trace::event ev = stm32xx::trace::event();
+  test_ring.get(n, ev); /* leaves ev zeroed on failure */
+  return ev;
+}
+}
+
+TEST_GROUP(stm32xx__trace)
+{
+  void setup()
+  {
+    test_ring.clear();
+    test_clock::ticks = 0ul;
+    test_clock::irq = 0;
+  }
+};
+
+TEST(stm32xx__trace, ct_modify_in_records_modify)
+{
+  using namespace stm32xx::bits::ct;
+  traced_reg x = { 0xAAAA5555ul };
+  modify<masked<0x00001200ul, 0x0000FF00ul> >::in(x);
+  CHECK_EQUAL(x.v, 0xAAAA1255ul);
+  LONGS_EQUAL(1, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::modify);
+  CHECK_EQUAL(ev.addr, reinterpret_cast<uintptr_t>(&x));
+  CHECK_EQUAL(ev.old_value, 0xAAAA5555ul);
+  CHECK_EQUAL(ev.new_value, 0xAAAA1255ul);
+  CHECK_EQUAL(ev.stamp, 1ul);
+}
+
+TEST(stm32xx__trace, ct_modify_in_full_mask_records_store)
+{
+  using namespace stm32xx::bits::ct;
+  traced_reg x = { 0xAAAA5555ul };
+  modify<masked<0x12345678ul, 0xFFFFFFFFul> >::in(x);
+  LONGS_EQUAL(1, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::store);
+  CHECK_EQUAL(ev.new_value, 0x12345678ul);
+}
+
+TEST(stm32xx__trace, ct_modify_at_records_address)
+{
+  using namespace stm32xx::bits::ct;
+  traced_access::mem[1] = 0xFFFFFFFFul;
+  modify<masked<0x00000000ul, 0x000000F0ul> >::at<0x60000004ul, traced_access>();
+  modify<masked<0x00000004ul, 0x00000004ul> >::at<0x40021018ul, traced_access>();
+  LONGS_EQUAL(2, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::modify);
+  CHECK_EQUAL(ev.addr, 0x60000004ul);
+  CHECK_EQUAL(ev.old_value, 0xFFFFFFFFul);
+  CHECK_EQUAL(ev.new_value, 0xFFFFFF0Ful);
+  ev = get_event(1);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::store);
+  CHECK_EQUAL(ev.addr, stm32xx::bits::bitband_alias(0x40021018ul, 2));
+  CHECK_EQUAL(ev.new_value, 1ul);
+}
+
+TEST(stm32xx__trace, test_bit_records_load)
+{
+  using namespace stm32xx::bits::ct;
+  traced_reg x = { 0x00000008ul };
+  CHECK(test_bit<3>::in(x));
+  LONGS_EQUAL(1, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::load);
+  CHECK_EQUAL(ev.new_value, 0x00000008ul);
+}
+
+TEST(stm32xx__trace, rt_modify_records_modify)
+{
+  traced_reg x = { 0x0000FFFFul };
+  stm32xx::bits::rt::modify(x, 0x00000100ul, 0x00000F00ul);
+  LONGS_EQUAL(1, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::modify);
+  CHECK_EQUAL(ev.old_value, 0x0000FFFFul);
+  CHECK_EQUAL(ev.new_value, 0x0000F1FFul);
+}
+
+TEST(stm32xx__trace, gpio_helpers_record_accesses)
+{
+  using namespace stm32xx::gpio;
+  traced_port port = traced_port();
+  port.ODR.v = 0x0001ul;
+  ct::write<GPIO_Pin_2, GPIO_Pin_3>::in(port);
+  ct::toggle<GPIO_Pin_0|GPIO_Pin_1>::in(port);
+  rt::set(&port, GPIO_Pin_4);
+  LONGS_EQUAL(4, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::store);
+  CHECK_EQUAL(ev.addr, reinterpret_cast<uintptr_t>(&port.BSRR));
+  CHECK_EQUAL(ev.new_value, 0x00080004ul);
+  ev = get_event(1);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::load);
+  CHECK_EQUAL(ev.addr, reinterpret_cast<uintptr_t>(&port.ODR));
+  CHECK_EQUAL(ev.new_value, 0x0001ul);
+  ev = get_event(2);
+  CHECK_EQUAL(ev.kind, stm32xx::trace::event::store);
+  CHECK_EQUAL(ev.new_value, 0x00010002ul);
+  ev = get_event(3);
+  CHECK_EQUAL(ev.new_value, (uint32_t)GPIO_Pin_4);
+}
+
+TEST(stm32xx__trace, ring_overwrites_oldest)
+{
+  stm32xx::trace::event ev;
+  for(uint32_t i = 0ul; i < 11ul; ++i)
+    test_ring.record(stm32xx::trace::event::store, 0x100ul, 0ul, i);
+  LONGS_EQUAL(11, test_ring.count());
+  CHECK(!test_ring.get(2, ev));
+  CHECK(!test_ring.get(11, ev));
+  for(uint32_t i = 3ul; i < 11ul; ++i)
+    CHECK_EQUAL(get_event(i).new_value, i);
+  test_ring.clear();
+  LONGS_EQUAL(0, test_ring.count());
+  CHECK(!test_ring.get(10, ev));
+}
+
+static void
+record_from_isr()
+{
+  test_ring.record(stm32xx::trace::event::store, 0x200ul, 0ul, 0x1234ul);
+}
+
+TEST(stm32xx__trace, record_interrupted_by_record)
+{
+  /* The "interrupt" fires inside the first record(), after its slot was
+   * reserved. Both events must end up complete, in distinct slots. */
+  test_clock::irq = record_from_isr;
+  test_ring.record(stm32xx::trace::event::store, 0x100ul, 0ul, 0x5678ul);
+  LONGS_EQUAL(2, test_ring.count());
+  stm32xx::trace::event ev = get_event(0);
+  CHECK_EQUAL(ev.addr, 0x100ul);
+  CHECK_EQUAL(ev.new_value, 0x5678ul);
+  CHECK_EQUAL(ev.stamp, 2ul);
+  ev = get_event(1);
+  CHECK_EQUAL(ev.addr, 0x200ul);
+  CHECK_EQUAL(ev.new_value, 0x1234ul);
+  CHECK_EQUAL(ev.stamp, 1ul);
+}
+
+// vim: set expandtab tabstop=2 shiftwidth=2:
+// vim: set foldmethod=marker foldcolumn=4: